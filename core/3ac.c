@@ -96,6 +96,8 @@ static mc_3ac_operator_t mc_3ac_operators[] = {
     {OP_3AC_JBE, "jbe"}, // 无符号小于等于跳转
 
     {OP_3AC_DUMP, "core_dump"}, // 打印 IR 栈或核心数据
+    {OP_3AC_COUNT, "count"},    // 插桩编译时基本块的执行计数 +1
+    {OP_3AC_JMP_TABLE, "jmp_table"}, // switch 的查表跳转
     {OP_3AC_NOP, "nop"},        // 空操作 (No Operation)
     {OP_3AC_END, "end"},        // 程序结束
 
@@ -137,8 +139,8 @@ mc_3ac_operator_t *mc_3ac_find_operator(const int type) {
 
 // 分配一个三地址码操作数对象（mc_3ac_operand_t）
 mc_3ac_operand_t *mc_3ac_operand_alloc() {
-    // calloc 分配并清零内存
-    mc_3ac_operand_t *operand = calloc(1, sizeof(mc_3ac_operand_t));
+    // 从当前 arena 分配并清零内存
+    mc_3ac_operand_t *operand = arena_calloc(1, sizeof(mc_3ac_operand_t));
     assert(operand); // 确保分配成功
     return operand;
 }
@@ -146,15 +148,15 @@ mc_3ac_operand_t *mc_3ac_operand_alloc() {
 // 释放一个三地址码操作数对象
 void mc_3ac_operand_free(mc_3ac_operand_t *operand) {
     if (operand) {
-        free(operand);
+        arena_free(operand);
         operand = NULL; // 防止悬空指针
     }
 }
 
 // 分配一个三地址码指令对象（mc_3ac_code_t）
 mc_3ac_code_t *mc_3ac_code_alloc() {
-    // calloc 分配并清零内存
-    mc_3ac_code_t *c = calloc(1, sizeof(mc_3ac_code_t));
+    // 从当前 arena 分配并清零内存
+    mc_3ac_code_t *c = arena_calloc(1, sizeof(mc_3ac_code_t));
 
     return c;
 }
@@ -222,10 +224,60 @@ int mc_3ac_code_same(mc_3ac_code_t *c0, mc_3ac_code_t *c1) {
     return 1;
 }
 
+static void mc_3ac_jmp_table_free(mc_3ac_jmp_table_t *t) {
+    int i;
+
+    if (t) {
+        if (t->targets) {
+            for (i = 0; i < t->targets->size; i++)
+                mc_3ac_operand_free(t->targets->data[i]);
+            vector_free(t->targets);
+        }
+
+        if (t->var)
+            variable_free(t->var);
+
+        arena_free(t);
+    }
+}
+
+static mc_3ac_jmp_table_t *mc_3ac_jmp_table_alloc(variable_t *var, int n) {
+    mc_3ac_jmp_table_t *t;
+    mc_3ac_operand_t *dst;
+
+    t = arena_calloc(1, sizeof(mc_3ac_jmp_table_t));
+    if (!t)
+        return NULL;
+
+    t->targets = vector_alloc();
+    if (!t->targets) {
+        arena_free(t);
+        return NULL;
+    }
+
+    int i;
+    for (i = 0; i < n; i++) {
+        dst = mc_3ac_operand_alloc();
+        if (!dst) {
+            mc_3ac_jmp_table_free(t);
+            return NULL;
+        }
+
+        if (vector_add(t->targets, dst) < 0) {
+            mc_3ac_operand_free(dst);
+            mc_3ac_jmp_table_free(t);
+            return NULL;
+        }
+    }
+
+    t->var = variable_ref(var);
+    return t;
+}
+
 // 克隆一条三地址码（深拷贝操作数列表，浅拷贝 DAG 节点指针）
 // 注意：这里并没有深度复制 DAG，只是复制了操作数结构体
 mc_3ac_code_t *_3ac_code_clone(mc_3ac_code_t *c) {
-    mc_3ac_code_t *c2 = calloc(1, sizeof(mc_3ac_code_t));
+    mc_3ac_code_t *c2 = arena_calloc(1, sizeof(mc_3ac_code_t));
     if (!c2)
         return NULL;
 
@@ -293,6 +345,23 @@ mc_3ac_code_t *_3ac_code_clone(mc_3ac_code_t *c) {
         }
     }
 
+    if (c->jmp_table) {
+        c2->jmp_table = mc_3ac_jmp_table_alloc(c->jmp_table->var, c->jmp_table->targets->size);
+        if (!c2->jmp_table) {
+            _3ac_code_free(c2);
+            return NULL;
+        }
+
+        int i;
+        for (i = 0; i < c->jmp_table->targets->size; i++) {
+            mc_3ac_operand_t *dst = c->jmp_table->targets->data[i];
+            mc_3ac_operand_t *dst2 = c2->jmp_table->targets->data[i];
+
+            dst2->code = dst->code;
+            dst2->bb = dst->bb;
+        }
+    }
+
     // 拷贝 label 信息和 origin 指针
     c2->label = c->label;
 
@@ -318,6 +387,8 @@ void mc_3ac_code_free(mc_3ac_code_t *c) {
                 mc_3ac_operand_free(c->srcs->data[i]);
             vector_free(c->srcs);
         }
+        mc_3ac_jmp_table_free(c->jmp_table);
+
         // 释放活跃变量列表（通常用于 liveness analysis）
         if (c->active_vars) {
             int i;
@@ -326,7 +397,7 @@ void mc_3ac_code_free(mc_3ac_code_t *c) {
             vector_free(c->active_vars);
         }
         // 最终释放三地址码结构本身
-        free(c);
+        arena_free(c);
         c = NULL; // 防止悬空指针
     }
 }
@@ -445,6 +516,21 @@ mc_3ac_code_t *mc_3ac_jmp_code(int type, label_t *l, node_t *err) {
     return c;
 }
 
+// 生成一条查表跳转: 源操作数是下标，n 个目标的 code 由调用者填
+mc_3ac_code_t *mc_3ac_jmp_table_code(node_t *index, variable_t *table, int n) {
+    mc_3ac_code_t *c = mc_3ac_code_NN(OP_3AC_JMP_TABLE, NULL, 0, &index, 1);
+    if (!c)
+        return NULL;
+
+    c->jmp_table = mc_3ac_jmp_table_alloc(table, n);
+    if (!c->jmp_table) {
+        mc_3ac_code_free(c);
+        return NULL;
+    }
+
+    return c;
+}
+
 // 打印一个语法树节点 node_t
 static void mc_3ac_print_node(node_t *node) {
     if (type_is_var(node->type)) {
@@ -553,6 +639,15 @@ void mc_3ac_code_print(mc_3ac_code_t *c, list_t *sentinel) {
                 printf(", ");
         }
     }
+    // 查表跳转的目标
+    if (c->jmp_table) {
+        for (i = 0; i < c->jmp_table->targets->size; i++) {
+            dst = c->jmp_table->targets->data[i];
+
+            if (dst->bb)
+                printf(" [%d] bb: %d", i, dst->bb->index);
+        }
+    }
 
     printf("\n");
 }
@@ -567,7 +662,7 @@ void mc_3ac_code_print(mc_3ac_code_t *c, list_t *sentinel) {
 
     nb_operands0/1 限制 DAG 子节点数量，防止非法连接。
 */
-static int _3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, int nb_operands0, int nb_operands1) {
+static int _3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, dag_cons_t *cons, int nb_operands0, int nb_operands1) {
     mc_3ac_operand_t *dst;
     mc_3ac_operand_t *src;
     dag_node_t *dn;
@@ -583,7 +678,7 @@ static int _3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, int nb_operands0, int
             if (!dst || !dst->node)
                 continue;
 
-            ret = dag_get_node(dag, dst->node, &dst->dag_node); // 获取或创建 DAG 节点
+            ret = dag_get_node(dag, cons, dst->node, &dst->dag_node); // 获取或创建 DAG 节点
             if (ret < 0)
                 return ret;
         }
@@ -598,7 +693,7 @@ static int _3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, int nb_operands0, int
         if (!src || !src->node)
             continue;
 
-        ret = dag_get_node(dag, src->node, &src->dag_node);
+        ret = dag_get_node(dag, cons, src->node, &src->dag_node);
         if (ret < 0)
             return ret;
 
@@ -650,7 +745,7 @@ static int _3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, int nb_operands0, int
 
     对普通算术、函数调用等使用 _3ac_code_to_dag 通用方法。
 */
-int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
+int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag, dag_cons_t *cons) {
     mc_3ac_operand_t *src;
     mc_3ac_operand_t *dst;
 
@@ -661,11 +756,11 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         src = c->srcs->data[0];
         dst = c->dsts->data[0];
 
-        ret = dag_get_node(dag, src->node, &src->dag_node);
+        ret = dag_get_node(dag, cons, src->node, &src->dag_node);
         if (ret < 0)
             return ret;
 
-        ret = dag_get_node(dag, dst->node, &dst->dag_node);
+        ret = dag_get_node(dag, cons, dst->node, &dst->dag_node);
         if (ret < 0)
             return ret;
         // 避免 x = x 的冗余赋值
@@ -682,7 +777,9 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         // 创建赋值 DAG 节点
         dn_assign = dag_node_alloc(c->op->type, v_assign, NULL);
         // 添加到 DAG 列表
-        list_add_tail(dag, &dn_assign->list);
+        ret = dag_add_node(dag, cons, dn_assign);
+        if (ret < 0)
+            return ret;
 
         dn_src = src->dag_node;
         // 如果源节点有父节点且未动态分配，则使用父节点的右值
@@ -711,12 +808,14 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         assign = dag_node_alloc(c->op->type, NULL, NULL);
         if (!assign)
             return -ENOMEM;
-        list_add_tail(dag, &assign->list);
+        ret = dag_add_node(dag, cons, assign);
+        if (ret < 0)
+            return ret;
 
         for (i = 0; i < c->srcs->size; i++) {
             src = c->srcs->data[i];
 
-            ret = dag_get_node(dag, src->node, &src->dag_node);
+            ret = dag_get_node(dag, cons, src->node, &src->dag_node);
             if (ret < 0)
                 return ret;
 
@@ -727,14 +826,16 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
 
     } else if (OP_VLA_ALLOC == c->op->type) { // VLA 动态数组分配
         dst = c->dsts->data[0];
-        ret = dag_get_node(dag, dst->node, &dst->dag_node);
+        ret = dag_get_node(dag, cons, dst->node, &dst->dag_node);
         if (ret < 0)
             return ret;
 
         dag_node_t *alloc = dag_node_alloc(c->op->type, NULL, NULL);
         if (!alloc)
             return -ENOMEM;
-        list_add_tail(dag, &alloc->list);
+        ret = dag_add_node(dag, cons, alloc);
+        if (ret < 0)
+            return ret;
 
         ret = dag_node_add_child(alloc, dst->dag_node);
         if (ret < 0)
@@ -743,7 +844,7 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         for (i = 0; i < c->srcs->size; i++) {
             src = c->srcs->data[i];
 
-            ret = dag_get_node(dag, src->node, &src->dag_node);
+            ret = dag_get_node(dag, cons, src->node, &src->dag_node);
             if (ret < 0)
                 return ret;
 
@@ -753,17 +854,20 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         }
     } else if (OP_3AC_CMP == c->op->type
                || OP_3AC_TEQ == c->op->type
-               || OP_3AC_DUMP == c->op->type) { // 处理比较、打印等操作
+               || OP_3AC_DUMP == c->op->type
+               || OP_3AC_JMP_TABLE == c->op->type) { // 处理比较、打印、查表跳转等操作
         dag_node_t *dn_cmp = dag_node_alloc(c->op->type, NULL, NULL);
 
-        list_add_tail(dag, &dn_cmp->list);
+        ret = dag_add_node(dag, cons, dn_cmp);
+        if (ret < 0)
+            return ret;
 
         if (c->srcs) {
             int i;
             for (i = 0; i < c->srcs->size; i++) {
                 src = c->srcs->data[i];
 
-                ret = dag_get_node(dag, src->node, &src->dag_node);
+                ret = dag_get_node(dag, cons, src->node, &src->dag_node);
                 if (ret < 0)
                     return ret;
 
@@ -782,9 +886,11 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         dst = c->dsts->data[0];
 
         dag_node_t *dn_setcc = dag_node_alloc(c->op->type, NULL, NULL);
-        list_add_tail(dag, &dn_setcc->list);
+        ret = dag_add_node(dag, cons, dn_setcc);
+        if (ret < 0)
+            return ret;
 
-        ret = dag_get_node(dag, dst->node, &dst->dag_node);
+        ret = dag_get_node(dag, cons, dst->node, &dst->dag_node);
         if (ret < 0)
             return ret;
 
@@ -805,9 +911,11 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         variable_t *v_parent = _operand_get(src->node->parent);
         dag_node_t *dn_parent = dag_node_alloc(c->op->type, v_parent, NULL);
 
-        list_add_tail(dag, &dn_parent->list);
+        ret = dag_add_node(dag, cons, dn_parent);
+        if (ret < 0)
+            return ret;
 
-        ret = dag_get_node(dag, src->node, &src->dag_node);
+        ret = dag_get_node(dag, cons, src->node, &src->dag_node);
         if (ret < 0)
             return ret;
 
@@ -825,11 +933,11 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         src = c->srcs->data[0];
         dst = c->dsts->data[0];
 
-        ret = dag_get_node(dag, src->node, &src->dag_node);
+        ret = dag_get_node(dag, cons, src->node, &src->dag_node);
         if (ret < 0)
             return ret;
 
-        ret = dag_get_node(dag, dst->node, &dst->dag_node);
+        ret = dag_get_node(dag, cons, dst->node, &dst->dag_node);
         if (ret < 0)
             return ret;
 
@@ -843,12 +951,14 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
         if (c->srcs) {
             dag_node_t *dn = dag_node_alloc(c->op->type, NULL, NULL);
 
-            list_add_tail(dag, &dn->list);
+            ret = dag_add_node(dag, cons, dn);
+            if (ret < 0)
+                return ret;
 
             for (i = 0; i < c->srcs->size; i++) {
                 src = c->srcs->data[i];
 
-                ret = dag_get_node(dag, src->node, &src->dag_node);
+                ret = dag_get_node(dag, cons, src->node, &src->dag_node);
                 if (ret < 0)
                     return ret;
 
@@ -893,7 +1003,7 @@ int mc_3ac_code_to_dag(mc_3ac_code_t *c, list_t *dag) {
             };
         }
 
-        return _3ac_code_to_dag(c, dag, n_operands0, n_operands1);
+        return _3ac_code_to_dag(c, dag, cons, n_operands0, n_operands1);
     }
 
     return 0;
@@ -966,6 +1076,45 @@ static void mc_3ac_filter_jmp(list_t *h, mc_3ac_code_t *c) {
     c->basic_block_start = 1;
 }
 
+// 查表跳转的每个目标都和 GOTO 一样跳过 NOP 和后续的 GOTO，指令本身和下一条指令是基本块起点
+static void mc_3ac_filter_jmp_table(list_t *h, mc_3ac_code_t *c) {
+    mc_3ac_operand_t *dst;
+    mc_3ac_code_t *c2;
+    list_t *l2;
+    int i;
+
+    for (i = 0; i < c->jmp_table->targets->size; i++) {
+        dst = c->jmp_table->targets->data[i];
+
+        for (l2 = &dst->code->list; l2 != list_sentinel(h);) {
+            c2 = list_data(l2, mc_3ac_code_t, list);
+
+            if (OP_GOTO == c2->op->type) {
+                mc_3ac_operand_t *dst1 = c2->dsts->data[0];
+                l2 = &dst1->code->list;
+                continue;
+            }
+
+            if (OP_3AC_NOP == c2->op->type) {
+                l2 = list_next(l2);
+                continue;
+            }
+
+            dst->code = c2;
+            c2->basic_block_start = 1;
+            c2->jmp_dst_flag = 1;
+            break;
+        }
+    }
+
+    l2 = list_next(&c->list);
+    if (l2 != list_sentinel(h)) {
+        c2 = list_data(l2, mc_3ac_code_t, list);
+        c2->basic_block_start = 1;
+    }
+    c->basic_block_start = 1;
+}
+
 /*
 函数作用
     优化三地址码中 TEQ → SETCC → 条件跳转 链。
@@ -1459,7 +1608,11 @@ static int mc_3ac_find_basic_block_start(list_t *h) {
             }
 
             mc_3ac_filter_jmp(h, c);
+            continue;
         }
+
+        if (OP_3AC_JMP_TABLE == c->op->type)
+            mc_3ac_filter_jmp_table(h, c);
     }
 #if 1
     // 删除 NOP 和多余的 GOTO
@@ -1481,11 +1634,15 @@ static int mc_3ac_find_basic_block_start(list_t *h) {
             continue;
         }
 
-        if (OP_GOTO != c->op->type) {
+        if (OP_GOTO != c->op->type && OP_3AC_JMP_TABLE != c->op->type) {
             l = list_next(l);
             continue;
         }
-        assert(!c->jmp_dst_flag);
+
+        if (OP_3AC_JMP_TABLE == c->op->type) // 查表跳转和 GOTO 一样，后面到下一个跳转目标之前的代码都到不了
+            assert(c->basic_block_start);
+        else
+            assert(!c->jmp_dst_flag);
 
         for (l2 = list_next(&c->list); l2 != list_sentinel(h);) {
             c2 = list_data(l2, mc_3ac_code_t, list);
@@ -1501,6 +1658,10 @@ static int mc_3ac_find_basic_block_start(list_t *h) {
         }
 
         l = list_next(l);
+
+        if (OP_3AC_JMP_TABLE == c->op->type)
+            continue;
+
         dst0 = c->dsts->data[0];
 
         if (l == &dst0->code->list) {
@@ -1595,6 +1756,15 @@ static int mc_3ac_split_basic_blocks(list_t *h, function_t *f) {
                 bb->dump_flag = 1;
                 continue;
             }
+            // 查表跳转指令，单独占一个基本块
+            if (OP_3AC_JMP_TABLE == c->op->type) {
+                bb->jmp_table_flag = 1;
+
+                int ret = vector_add_unique(f->jmp_tables, c);
+                if (ret < 0)
+                    return ret;
+                continue;
+            }
             // 结束指令
             if (OP_3AC_END == c->op->type) {
                 bb->end_flag = 1;
@@ -1685,7 +1855,7 @@ static int mc_3ac_connect_basic_blocks(function_t *f) {
         if (l2 != sentinel) {
             prev_bb = list_data(l2, basic_block_t, list);
 
-            if (!prev_bb->jmp_flag) {
+            if (!prev_bb->jmp_flag && !prev_bb->jmp_table_flag) {
                 ret = basic_block_connect(prev_bb, current_bb);
                 if (ret < 0)
                     return ret;
@@ -1698,6 +1868,10 @@ static int mc_3ac_connect_basic_blocks(function_t *f) {
 
         next_bb = list_data(l2, basic_block_t, list);
 
+        // 查表跳转块不会顺序执行到下一个基本块
+        if (current_bb->jmp_table_flag)
+            continue;
+
         if (!next_bb->jmp_flag) {
             ret = basic_block_connect(current_bb, next_bb);
             if (ret < 0)
@@ -1723,6 +1897,11 @@ static int mc_3ac_connect_basic_blocks(function_t *f) {
         for (l = list_prev(&current_bb->list); l != sentinel; l = list_prev(l)) {
             prev_bb = list_data(l, basic_block_t, list);
 
+            if (prev_bb->jmp_table_flag) {
+                prev_bb = NULL;
+                break;
+            }
+
             if (!prev_bb->jmp_flag)
                 break;
 
@@ -1763,6 +1942,24 @@ static int mc_3ac_connect_basic_blocks(function_t *f) {
         }
     }
 
+    /* 第三步：查表跳转块连到它的每个目标 */
+    for (i = 0; i < f->jmp_tables->size; i++) {
+        mc_3ac_code_t *c = f->jmp_tables->data[i];
+        mc_3ac_operand_t *dst;
+        int j;
+
+        for (j = 0; j < c->jmp_table->targets->size; j++) {
+            dst = c->jmp_table->targets->data[j];
+
+            dst->bb = dst->code->basic_block;
+            dst->code = NULL;
+
+            ret = basic_block_connect(c->basic_block, dst->bb);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     return 0;
 }
 
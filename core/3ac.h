@@ -26,6 +26,12 @@ struct mc_3ac_operand_s {
     void *rabi;// 额外信息指针(可能和寄存器分配/ABI 有关)
 };
 
+// switch 的跳转表，下标 i 跳到 targets[i]，下标的范围在前面的 cmp + ja 里已经检查过
+typedef struct {
+    vector_t *targets; // 跳转目标(mc_3ac_operand_t)，和跳转指令的 dsts 一样，分基本块前用 code，之后用 bb
+    variable_t *var;   // 表在 .rodata 里的只读数组，每项是目标的绝对地址
+} mc_3ac_jmp_table_t;
+
 // 三地址码的指令结构体
 struct mc_3ac_code_s {
     list_t list; // 作为链表节点，连接在三地址码指令链表中
@@ -37,6 +43,8 @@ struct mc_3ac_code_s {
 
     label_t *label; // 用于跳转（goto）的标签，标记目标位置
 
+    mc_3ac_jmp_table_t *jmp_table; // OP_3AC_JMP_TABLE 的跳转表，目标不放在 dsts 里，免得被当成变量分析
+
     mc_3ac_code_t * origin;// 记录原始的指令（便于回溯）
 
     basic_block_t *basic_block;// 当前指令所属的基本块
@@ -84,12 +92,15 @@ void mc_3ac_list_print(list_t *h);
 // 生成一条跳转指令(例如 goto、if 条件跳转)
 mc_3ac_code_t * mc_3ac_jmp_code(int type, label_t *l, node_t *err);
 
+// 生成一条查表跳转，n 个目标先都为空，由调用者填
+mc_3ac_code_t * mc_3ac_jmp_table_code(node_t *index, variable_t *table, int n);
+
 // 根据操作符类型查找对应的操作符
 mc_3ac_operator_t * mc_3ac_find_operator(const int type);
 
 
 // 将三地址码转为 DAG 表示，用于优化
-int mc_3ac_code_to_dag(mc_3ac_code_t * c, list_t *dag);
+int mc_3ac_code_to_dag(mc_3ac_code_t * c, list_t *dag, dag_cons_t *cons);
 
 // 根据源操作数创建一条三地址码指令
 mc_3ac_code_t * mc_3ac_alloc_by_src(int op_type, dag_node_t *src);
@@ -21,6 +21,9 @@ int ast_open(ast_t **past) {
     // 标记该 block 为根节点
     ast->root_block->node.root_flag = 1;
 
+    // 根 block 的作用域把全局符号同时登记到 ast->globals
+    ast->root_block->scope->globals = &ast->globals;
+
     // 分配全局常量表
     ast->global_consts = vector_alloc();
     if (!ast->global_consts)
@@ -42,6 +45,10 @@ int ast_close(ast_t *ast) {
         // 这里只释放了 ast 本身
         // 没有释放 root_block、global_consts、global_relas
         // 所以可能会造成内存泄漏
+        hash_clear(&ast->globals.functions);
+        hash_clear(&ast->globals.variables);
+        hash_clear(&ast->globals.types);
+
         free(ast);
         ast = NULL;
     }
@@ -63,8 +70,7 @@ int ast_add_base_type(ast_t *ast, base_type_t *base_type) {
     }
 
     // 向根块范围中打入类型 t
-    scope_push_type(ast->root_block->scope, t);
-    return 0;
+    return scope_push_type(ast->root_block->scope, t);
 }
 
 // 向抽象语法书添加文件块
@@ -84,6 +90,9 @@ int ast_add_file_block(ast_t *ast, const char *path) {
     // 标记文件块的标志为 1
     file_block->node.file_flag = 1;
 
+    // 文件块的全局符号也登记到 ast->globals
+    file_block->scope->globals = &ast->globals;
+
     // 节点添加儿子
     node_add_child((node_t *)ast->root_block, (node_t *)file_block);
     // 设置当前节点为文件块
@@ -125,52 +134,6 @@ string_t *variable_type_name(ast_t *ast, variable_t *v) {
     return s;
 }
 
-// 通过名字寻找函数 node
-static int _find_function_by_name(node_t *node, void *arg, vector_t *vec) {
-    if (node->class_flag)
-        return 1;
-
-    if (FUNCTION == node->type) {
-        // 定义一个函数对象
-        function_t *f = (function_t *)node;
-
-        assert(!f->member_flag);
-
-        if (f->static_flag)
-            return 0;
-
-        //
-        if (!strcmp(f->node.w->text->data, arg)) {
-            int ret = vector_add(vec, f);
-            if (ret < 0)
-                return ret;
-        }
-        return 1;
-    }
-
-    return 0;
-}
-
-// 通过名字寻找类型 node
-static int _find_type_by_name(node_t *node, void *arg, vector_t *vec) {
-    if (FUNCTION == node->type)
-        return 1;
-
-    if (node->type >= STRUCT && node->class_flag) {
-        type_t *t = (type_t *)node;
-
-        if (!strcmp(t->name->data, arg)) {
-            int ret = vector_add(vec, t);
-            if (ret < 0)
-                return ret;
-        }
-
-        return 1;
-    }
-
-    return 0;
-}
-
 // 根据类型寻找类型
 static int _find_type_by_type(node_t *node, void *arg, vector_t *vec) {
     if (FUNCTION == node->type)
@@ -192,120 +155,75 @@ static int _find_type_by_type(node_t *node, void *arg, vector_t *vec) {
     return 0;
 }
 
-// 根据名字寻找变量
-static int _find_var_by_name(node_t *node, void *arg, vector_t *vec) {
-    if (FUNCTION == node->type)
-        return 1;
-
-    if (node->class_flag)
-        return 1;
-
-    // 如果是块
-    if (OP_BLOCK == node->type) {
-        // 先定义一个块
-        block_t *b = (block_t *)node;
-
-        if (!b->scope)
-            return 0;
-
-        // 范围内寻找变量
-        variable_t *v = scope_find_variable(b->scope, arg);
-        if (!v)
-            return 0;
-
-        assert(!v->local_flag && !v->member_flag);
-
-        if (v->static_flag)
-            return 0;
-
-        return vector_add(vec, v);
-    }
-    return 0;
-}
-
-/* 在抽象语法树中查找全局函数 */
+/* 在抽象语法树中查找全局函数，直接查 ast->globals 索引 */
 int ast_find_global_function(function_t **pf, ast_t *ast, char *fname) {
-    // 分配结果向量用于存储找到的函数
-    vector_t *vec = vector_alloc();
-    if (!vec)
-        return -ENOMEM; // 内存分配失败
-
-    // 使用广度优先搜索(BFS)在AST中查找函数
-    // _find_function_by_name 是回调函数，用于匹配函数名
-    int ret = node_search_bfs((node_t *)ast->root_block, fname, vec, -1, _find_function_by_name);
-    if (ret < 0) {
-        vector_free(vec); // 搜索失败，清理内存
-        return ret;
-    }
-    // 如果没有找到任何函数
-    if (0 == vec->size) {
-        *pf = NULL;       // 设置输出参数为NULL
-        vector_free(vec); // 释放向量
-        return 0;         // 成功返回（未找到不是错误）
+    string_t *id = string_intern_find_cstr(fname);
+    if (!id) {
+        *pf = NULL; // 名字没驻留过，不会有这个名字的符号
+        return 0;
     }
 
-    // 默认取第一个找到的函数
-    function_t *f2 = vec->data[0];
+    uint32_t hash = string_intern_hash(id);
+    function_t *f2 = NULL;
     function_t *f;
     int n = 0; // 计数器：实际定义的函数数量（非声明）
-    int i;
-    // 遍历所有找到的函数，寻找实际定义的函数（而非仅仅是声明的）
-    for (i = 0; i < vec->size; i++) {
-        f = vec->data[i];
-        // 如果函数有定义（不仅仅是声明）
+    int pos = -1;
+
+    // 遍历所有同名的全局函数，默认取第一个，有定义（不仅仅是声明）的话取定义
+    while ((f = hash_next(&ast->globals.functions, id, hash, &pos))) {
+        assert(!f->member_flag);
+
+        if (f->static_flag)
+            continue;
+
+        if (!f2)
+            f2 = f;
+
         if (f->node.define_flag) {
             f2 = f; // 更新为当前找到的定义
             n++;    // 增加定义计数
         }
     }
+
     // 如果找到多个定义，报告多重定义错误
     if (n > 1) {
-        for (i = 0; i < vec->size; i++) {
-            f = vec->data[i];
+        pos = -1;
+        while ((f = hash_next(&ast->globals.functions, id, hash, &pos))) {
             // 为每个重复定义输出错误信息
-            if (f->node.define_flag)
+            if (!f->static_flag && f->node.define_flag)
                 loge("multi-define: '%s' in file: %s, line: %d\n", fname, f->node.w->file->data, f->node.w->line);
         }
-
-        vector_free(vec);
         return -1; // 返回错误
     }
 
-    *pf = f2; // 设置输出参数
-
-    vector_free(vec); // 释放临时向量
-    return 0;         // 成功返回
+    *pf = f2; // 设置输出参数，没找到时为 NULL（未找到不是错误）
+    return 0;
 }
 
 /* 在抽象语法树中查找全局变量 */
 int ast_find_global_variable(variable_t **pv, ast_t *ast, char *name) {
-    // 分配结果向量
-    vector_t *vec = vector_alloc();
-    if (!vec)
-        return -ENOMEM;
-    // 使用BFS搜索变量，_find_var_by_name是匹配变量名的回调函数
-    int ret = node_search_bfs((node_t *)ast->root_block, name, vec, -1, _find_var_by_name);
-    if (ret < 0) {
-        vector_free(vec);
-        return ret;
-    }
-    // 没有找到变量
-    if (0 == vec->size) {
-        *pv = NULL;
-        vector_free(vec);
+    string_t *id = string_intern_find_cstr(name);
+    if (!id) {
+        *pv = NULL; // 名字没驻留过，不会有这个名字的符号
         return 0;
     }
-    // 默认取第一个变量
-    variable_t *v2 = vec->data[0];
+
+    uint32_t hash = string_intern_hash(id);
+    variable_t *v2 = NULL;
     variable_t *v;
-    // 非extern变量的计数（实际定义的变量）
-    int n = 0;
-    int i;
+    int n = 0; // 非extern变量的计数（实际定义的变量）
+    int pos = -1;
+
+    // 遍历所有同名的全局变量，默认取第一个，非extern声明（即实际定义）优先
+    while ((v = hash_next(&ast->globals.variables, id, hash, &pos))) {
+        assert(!v->local_flag && !v->member_flag);
+
+        if (v->static_flag)
+            continue;
+
+        if (!v2)
+            v2 = v;
 
-    // 遍历所有找到的变量
-    for (i = 0; i < vec->size; i++) {
-        v = vec->data[i];
-        // 如果不是extern声明（即实际定义）
         if (!v->extern_flag) {
             v2 = v; // 更新为当前找到的定义
             n++;    // 增加定义计数
@@ -314,20 +232,17 @@ int ast_find_global_variable(variable_t **pv, ast_t *ast, char *name) {
 
     // 检查多重定义
     if (n > 1) {
-        for (i = 0; i < vec->size; i++) {
-            v = vec->data[i];
+        pos = -1;
+        while ((v = hash_next(&ast->globals.variables, id, hash, &pos))) {
             // 为每个重复定义输出错误信息
-            if (!v->extern_flag)
+            if (!v->static_flag && !v->extern_flag)
                 loge("multi-define: '%s' in file: %s, line: %d\n", name, v->w->file->data, v->w->line);
         }
-
-        vector_free(vec);
         return -1; // 多重定义错误
     }
+
     // 设置输出参数
     *pv = v2;
-
-    vector_free(vec);
     return 0;
 }
 
@@ -364,27 +279,46 @@ static int _type_check(type_t **pt, vector_t *vec) {
     return 0;
 }
 
-/* 按名称查找全局类型 */
+/* 按名称查找全局类型，只有 class 类型才是全局可见的 */
 int ast_find_global_type(type_t **pt, ast_t *ast, char *name) {
-    vector_t *vec = vector_alloc();
-    if (!vec)
-        return -ENOMEM;
-    // 使用BFS搜索类型，_find_type_by_name是匹配类型名的回调函数
-    int ret = node_search_bfs((node_t *)ast->root_block, name, vec, -1, _find_type_by_name);
-    if (ret < 0) {
-        vector_free(vec);
-        return ret;
+    string_t *id = string_intern_find_cstr(name);
+    if (!id) {
+        *pt = NULL; // 名字没驻留过，不会有这个名字的符号
+        return 0;
     }
-    // 处理搜索结果
-    if (0 == vec->size) {
-        *pt = NULL; // 未找到类型
-        ret = 0;    // 这不是错误
-    } else
-        // 调用类型检查函数处理可能的重复定义
-        ret = _type_check(pt, vec);
 
-    vector_free(vec);
-    return ret;
+    uint32_t hash = string_intern_hash(id);
+    type_t *t2 = NULL;
+    type_t *t;
+    int n = 0; // 实际定义的类型计数
+    int pos = -1;
+
+    while ((t = hash_next(&ast->globals.types, id, hash, &pos))) {
+        if (t->node.type < STRUCT || !t->node.class_flag)
+            continue;
+
+        if (!t2)
+            t2 = t;
+
+        if (t->node.define_flag) {
+            t2 = t; // 更新为当前定义
+            n++;    // 增加定义计数
+        }
+    }
+
+    // 检查类型重定义
+    if (n > 1) {
+        pos = -1;
+        while ((t = hash_next(&ast->globals.types, id, hash, &pos))) {
+            // 为每个重复定义输出错误信息
+            if (t->node.type >= STRUCT && t->node.class_flag && t->node.define_flag)
+                loge("multi-define: '%s' in file: %s, line: %d\n", t->name->data, t->node.w->file->data, t->node.w->line);
+        }
+        return -1;
+    }
+
+    *pt = t2; // 未找到类型时为 NULL，这不是错误
+    return 0;
 }
 
 /* 按类型标识查找全局类型 */
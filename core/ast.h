@@ -55,6 +55,11 @@ struct ast_s {
     vector_t *global_consts;// 全局常量集合
     vector_t *global_relas;// 全局引用集合
 
+    symbol_index_t globals;// 全局函数/变量/类型的名字索引，根块和文件块的作用域 push 时同步更新
+
+    int instrument;// 插桩编译，见 optimizer_instrument.c
+    int inline_growth;// 内联使整个程序的三地址码增长的上限(百分比)，<= 0 时用默认值
+
     Eboard *board;// 可能用于错误记录/编译状态管理的上下文
 };
 
@@ -5,7 +5,7 @@
 
  basic_block_t*  basic_block_alloc()
 {
-	 basic_block_t* bb = calloc(1, sizeof( basic_block_t));
+	 basic_block_t* bb = arena_calloc(1, sizeof( basic_block_t));
 	if (!bb)
 		return NULL;
 
@@ -129,7 +129,7 @@ error_entry_delivery:
 error_nexts:
 	 vector_free(bb->prevs);
 error_prevs:
-	free(bb);
+	arena_free(bb);
 	return NULL;
 }
 
@@ -170,6 +170,7 @@ void  basic_block_free( basic_block_t* bb)
 	if (bb) {
 		// this bb's DAG nodes freed here
 		 list_clear(&bb->dag_list_head,  dag_node_t, list,  dag_node_free);
+		 dag_cons_clear(&bb->dag_cons);
 
 		 list_clear(&bb->code_list_head,  _3ac_code_t, list,  _3ac_code_free);
 		 list_clear(&bb->save_list_head,  _3ac_code_t, list,  _3ac_code_free);
@@ -183,6 +184,11 @@ void  basic_block_free( basic_block_t* bb)
 
 		if (bb->nexts)
 			 vector_free(bb->nexts);
+
+		 bitset_clear(&bb->entry_dn_delivery_set);
+		 bitset_clear(&bb->entry_dn_inactives_set);
+		 bitset_clear(&bb->entry_dn_actives_set);
+		 bitset_clear(&bb->exit_dn_actives_set);
 	}
 }
 
@@ -466,6 +472,50 @@ void  basic_block_print_list( list_t* h)
 	}
 }
 
+// 把 vec 里已有的节点登记到位集合 set 里
+static int _dn_set_init( bitset_t* set,  vector_t* vec)
+{
+	 dag_node_t* dn;
+	int i;
+
+	int ret =  bitset_reset(set, 0);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < vec->size; i++) {
+		dn =        vec->data[i];
+
+		if (dn->index >= 0) {
+			ret =  bitset_add(set, dn->index);
+			if (ret < 0)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+// 用位集合 set 判重后加入 vec，还没编号的节点退回线性查找
+static int _dn_add_unique( vector_t* vec,  bitset_t* set,  dag_node_t* dn)
+{
+	if (dn->index < 0)
+		return  vector_add_unique(vec, dn);
+
+	int ret =  bitset_add(set, dn->index);
+	if (ret <= 0)
+		return ret;
+
+	return  vector_add(vec, dn);
+}
+
+static int _dn_find( vector_t* vec,  bitset_t* set,  dag_node_t* dn)
+{
+	if (dn->index < 0)
+		return !! vector_find(vec, dn);
+
+	return  bitset_test(set, dn->index);
+}
+
+// active_vars 总是刚清空的，dag_nodes 里也没有重复的节点，不用再查找
 static int _copy_to_active_vars( vector_t* active_vars,  vector_t* dag_nodes)
 {
 	 dag_node_t*   dn;
@@ -475,18 +525,14 @@ static int _copy_to_active_vars( vector_t* active_vars,  vector_t* dag_nodes)
 	for (i = 0; i < dag_nodes->size; i++) {
 		dn        = dag_nodes->data[i];
 
-		ds =  vector_find_cmp(active_vars, dn,  dn_status_cmp);
-
-		if (!ds) {
-			ds =  dn_status_alloc(dn);
-			if (!ds)
-				return -ENOMEM;
+		ds =  dn_status_alloc(dn);
+		if (!ds)
+			return -ENOMEM;
 
-			int ret =  vector_add(active_vars, ds);
-			if (ret < 0) {
-				 dn_status_free(ds);
-				return ret;
-			}
+		int ret =  vector_add(active_vars, ds);
+		if (ret < 0) {
+			 dn_status_free(ds);
+			return ret;
 		}
 #if 0
 		ds->alias   = dn->alias;
@@ -501,7 +547,7 @@ static int _copy_to_active_vars( vector_t* active_vars,  vector_t* dag_nodes)
 	return 0;
 }
 
-static int _copy_vars_by_active( vector_t* dn_vec,  vector_t* ds_vars, int active)
+static int _copy_vars_by_active( vector_t* dn_vec,  bitset_t* dn_set,  vector_t* ds_vars, int active)
 {
 	if (!dn_vec)
 		return -EINVAL;
@@ -520,7 +566,7 @@ static int _copy_vars_by_active( vector_t* dn_vec,  vector_t* ds_vars, int activ
 
 		if (active == ds->active &&  dn_through_bb(dn)) {
 
-			int ret =  vector_add_unique(dn_vec, dn);
+			int ret = _dn_add_unique(dn_vec, dn_set, dn);
 			if (ret < 0)
 				return ret;
 		}
@@ -528,7 +574,7 @@ static int _copy_vars_by_active( vector_t* dn_vec,  vector_t* ds_vars, int activ
 	return 0;
 }
 
-static int _copy_updated_vars( vector_t* dn_vec,  vector_t* ds_vars)
+static int _copy_updated_vars( vector_t* dn_vec,  bitset_t* dn_set,  vector_t* ds_vars)
 {
 	if (!dn_vec)
 		return -EINVAL;
@@ -552,7 +598,7 @@ static int _copy_updated_vars( vector_t* dn_vec,  vector_t* ds_vars)
 			continue;
 
 		if ( dn_through_bb(dn)) {
-			int ret =  vector_add_unique(dn_vec, dn);
+			int ret = _dn_add_unique(dn_vec, dn_set, dn);
 			if (ret < 0)
 				return ret;
 		}
@@ -566,6 +612,8 @@ static int _bb_vars( basic_block_t* bb)
 	 dag_node_t* dn;
 	 list_t*     l;
 
+	bitset_t    set;
+
 	int ret = 0;
 
 	if (!bb->var_dag_nodes) {
@@ -575,6 +623,9 @@ static int _bb_vars( basic_block_t* bb)
 	} else
 		 vector_clear(bb->var_dag_nodes, NULL);
 
+	// var_dag_nodes 刚清空，用位集合判重
+	 bitset_init(&set);
+
 	for (l =  list_tail(&bb->code_list_head); l !=  list_sentinel(&bb->code_list_head); l =  list_prev(l)) {
 
 		c  =  list_data(l,  _3ac_code_t, list);
@@ -597,9 +648,9 @@ static int _bb_vars( basic_block_t* bb)
 				dn  = dst->dag_node;
 
 				if ( dn_through_bb(dn)) {
-					ret =  vector_add_unique(bb->var_dag_nodes, dn);
+					ret = _dn_add_unique(bb->var_dag_nodes, &set, dn);
 					if (ret < 0)
-						return ret;
+						goto end;
 				}
 			}
 		}
@@ -619,18 +670,21 @@ static int _bb_vars( basic_block_t* bb)
 						|| (v->nb_dimentions > 0 && ( OP_ARRAY_INDEX == c->op->type ||  type_is_assign_array_index(c->op->type)))
 						) {
 
-					ret =  vector_add_unique(bb->var_dag_nodes, dn);
+					ret = _dn_add_unique(bb->var_dag_nodes, &set, dn);
 					if (ret < 0)
-						return ret;
+						goto end;
 				}
 			}
 		}
 	}
 
-	return 0;
+	ret = 0;
+end:
+	 bitset_clear(&set);
+	return ret;
 }
 
-int  basic_block_dag( basic_block_t* bb,  list_t* dag_list_head)
+int  basic_block_dag( basic_block_t* bb,  list_t* dag_list_head, dag_cons_t* dag_cons)
 {
 	 list_t*     l;
 	 _3ac_code_t* c;
@@ -638,7 +692,7 @@ int  basic_block_dag( basic_block_t* bb,  list_t* dag_list_head)
 	for (l =  list_head(&bb->code_list_head); l !=  list_sentinel(&bb->code_list_head); l =  list_next(l)) {
 		c  =  list_data(l,  _3ac_code_t, list);
 
-		int ret =  _3ac_code_to_dag(c, dag_list_head);
+		int ret =  _3ac_code_to_dag(c, dag_list_head, dag_cons);
 		if (ret < 0)
 			return ret;
 	}
@@ -1135,36 +1189,54 @@ int  basic_block_active_vars( basic_block_t* bb)
 	 vector_clear(bb->entry_dn_actives, NULL);
 	 vector_clear(bb->dn_updateds,      NULL);
 
-	if (! list_empty(&bb->code_list_head)) {
+	if ( list_empty(&bb->code_list_head))
+		return 0;
 
-		l =  list_head(&bb->code_list_head);
-		c =  list_data(l,  _3ac_code_t, list);
+	// 判重用的位集合，entry_dn_inactives 和 exit_dn_actives 不清空，先登记已有的节点
+	bitset_t sets[4];
 
-		ret = _copy_vars_by_active(bb->entry_dn_actives, c->active_vars, 1);
-		if (ret < 0)
-			return ret;
+	for (i = 0; i < 4; i++)
+		 bitset_init(&sets[i]);
 
-		ret = _copy_vars_by_active(bb->entry_dn_inactives, c->active_vars, 0);
-		if (ret < 0)
-			return ret;
+	l =  list_head(&bb->code_list_head);
+	c =  list_data(l,  _3ac_code_t, list);
 
-		ret = _copy_updated_vars(bb->dn_updateds, c->active_vars);
-		if (ret < 0)
-			return ret;
+	ret = _copy_vars_by_active(bb->entry_dn_actives, &sets[0], c->active_vars, 1);
+	if (ret < 0)
+		goto end;
 
-		for (i = 0; i < bb->dn_updateds->size; i++) {
-			dn =        bb->dn_updateds->data[i];
+	ret = _dn_set_init(&sets[1], bb->entry_dn_inactives);
+	if (ret < 0)
+		goto end;
 
-			if (!dn->var->global_flag)
-				continue;
+	ret = _copy_vars_by_active(bb->entry_dn_inactives, &sets[1], c->active_vars, 0);
+	if (ret < 0)
+		goto end;
 
-			ret =  vector_add_unique(bb->exit_dn_actives, dn);
-			if (ret < 0)
-				return ret;
-		}
+	ret = _copy_updated_vars(bb->dn_updateds, &sets[2], c->active_vars);
+	if (ret < 0)
+		goto end;
+
+	ret = _dn_set_init(&sets[3], bb->exit_dn_actives);
+	if (ret < 0)
+		goto end;
+
+	for (i = 0; i < bb->dn_updateds->size; i++) {
+		dn =        bb->dn_updateds->data[i];
+
+		if (!dn->var->global_flag)
+			continue;
+
+		ret = _dn_add_unique(bb->exit_dn_actives, &sets[3], dn);
+		if (ret < 0)
+			goto end;
 	}
 
-	return 0;
+	ret = 0;
+end:
+	for (i = 0; i < 4; i++)
+		 bitset_clear(&sets[i]);
+	return ret;
 }
 
 int  basic_block_split( basic_block_t* bb_parent,  basic_block_t** pbb_child)
@@ -1311,63 +1383,220 @@ int  basic_block_search_dfs_prev( basic_block_t* root,  basic_block_dfs_pt find,
 	return 0;
 }
 
+// Cooper-Harvey-Kennedy 求直接支配者: 求交时沿 idom 往上走，dfo 大的一方先走
+static  basic_block_t* _bb_idom_intersect( basic_block_t* b0,  basic_block_t* b1, int reverse)
+{
+	while (b0 != b1) {
+
+		while (b0->dfo > b1->dfo)
+			b0 = reverse ? b0->ipdom : b0->idom;
+
+		while (b1->dfo > b0->dfo)
+			b1 = reverse ? b1->ipdom : b1->idom;
+	}
+
+	return b0;
+}
+
+// rpo 是按 dfo 从小到大排好的可达基本块，rpo->data[0] 是入口(reverse 时是出口)，
+// reverse 为 0 时沿 prevs 求直接支配者 idom，否则沿 nexts 求直接后支配者 ipdom
+int  basic_block_dominator_tree( vector_t* rpo, int reverse)
+{
+	 basic_block_t* bb;
+	 basic_block_t* prev;
+	 basic_block_t* idom;
+	 vector_t*      prevs;
+
+	int changed;
+	int i;
+	int j;
+
+	if (!rpo)
+		return -EINVAL;
+
+	if (0 == rpo->size)
+		return 0;
+
+	for (i = 0; i < rpo->size; i++) {
+		bb =        rpo->data[i];
+
+		if (reverse)
+			bb->ipdom = NULL;
+		else
+			bb->idom  = NULL;
+	}
+
+	bb = rpo->data[0];
+	if (reverse)
+		bb->ipdom = bb;
+	else
+		bb->idom  = bb;
+
+	do {
+		changed = 0;
+
+		for (i = 1; i < rpo->size; i++) {
+			bb    =     rpo->data[i];
+			prevs = reverse ? bb->nexts : bb->prevs;
+			idom  = NULL;
+
+			for (j = 0; j < prevs->size; j++) {
+				prev =      prevs->data[j];
+
+				// 还没处理过或不可达的前驱跳过
+				if (!(reverse ? prev->ipdom : prev->idom))
+					continue;
+
+				if (!idom)
+					idom = prev;
+				else
+					idom = _bb_idom_intersect(prev, idom, reverse);
+			}
+
+			if (reverse) {
+				if (bb->ipdom != idom) {
+					bb->ipdom = idom;
+					changed++;
+				}
+			} else if (bb->idom != idom) {
+				bb->idom = idom;
+				changed++;
+			}
+		}
+	} while (changed > 0);
+
+	return 0;
+}
+
+// dom 是否支配 bb，沿支配树往上走，O(深度)
+int  basic_block_dominates( basic_block_t* dom,  basic_block_t* bb)
+{
+	while (bb) {
+		if (bb == dom)
+			return 1;
+
+		if (bb->idom == bb)
+			break;
+		bb = bb->idom;
+	}
+
+	return 0;
+}
+
+// pdom 是否后支配 bb
+int  basic_block_post_dominates( basic_block_t* pdom,  basic_block_t* bb)
+{
+	while (bb) {
+		if (bb == pdom)
+			return 1;
+
+		if (bb->ipdom == bb)
+			break;
+		bb = bb->ipdom;
+	}
+
+	return 0;
+}
+
+// 加载、保存的判断都是集合运算，先把用到的集合转成以 dag_node_t 的 index 为下标的位集合
+enum {
+	BB_SET_ENTRY_ALIASES,
+	BB_SET_EXIT_ALIASES,
+	BB_SET_UPDATEDS,
+	BB_SET_LOADS,
+	BB_SET_SAVES,
+	BB_SET_RELOADS,
+	BB_SET_RESAVES,
+	BB_SET_N,
+};
+
 int  basic_block_loads_saves( basic_block_t* bb,  list_t* bb_list_head)
 {
 	 dag_node_t* dn;
 	 list_t*     l = &bb->list;
 
-	int ret;
+	 vector_t*   vecs[BB_SET_N] = {
+		bb->entry_dn_aliases,
+		bb->exit_dn_aliases,
+		bb->dn_updateds,
+		bb->dn_loads,
+		bb->dn_saves,
+		bb->dn_reloads,
+		bb->dn_resaves,
+	};
+	bitset_t    sets[BB_SET_N];
+
+	int ret = 0;
 	int i;
 
+	for (i = 0; i < BB_SET_N; i++)
+		 bitset_init(&sets[i]);
+
+	for (i = 0; i < BB_SET_N; i++) {
+		ret = _dn_set_init(&sets[i], vecs[i]);
+		if (ret < 0)
+			goto end;
+	}
+
+#define BB_FIND(k, dn)       _dn_find(vecs[k], &sets[k], dn)
+#define BB_ADD_UNIQUE(k, dn) _dn_add_unique(vecs[k], &sets[k], dn)
+
 	for (i = 0; i < bb->entry_dn_actives->size; i++) {
 		dn =        bb->entry_dn_actives->data[i];
 
 		if (dn->var->extra_flag)
 			continue;
 
-		if ( vector_find(bb->entry_dn_aliases, dn)
+		if (BB_FIND(BB_SET_ENTRY_ALIASES, dn)
 				|| dn->var->tmp_flag)
-			ret =  vector_add_unique(bb->dn_reloads, dn);
+			ret = BB_ADD_UNIQUE(BB_SET_RELOADS, dn);
 		else
-			ret =  vector_add_unique(bb->dn_loads, dn);
+			ret = BB_ADD_UNIQUE(BB_SET_LOADS, dn);
 		if (ret < 0)
-			return ret;
+			goto end;
 	}
 
 	for (i = 0; i < bb->exit_dn_actives->size; i++) {
 		dn =        bb->exit_dn_actives->data[i];
 
-		if (! vector_find(bb->dn_updateds, dn)) {
+		if (!BB_FIND(BB_SET_UPDATEDS, dn)) {
 
 			if (l !=  list_head(bb_list_head) || !dn->var->arg_flag)
 				continue;
 		}
 
-		if ( vector_find(bb->exit_dn_aliases, dn)
+		if (BB_FIND(BB_SET_EXIT_ALIASES, dn)
 				|| dn->var->tmp_flag)
-			ret =  vector_add_unique(bb->dn_resaves, dn);
+			ret = BB_ADD_UNIQUE(BB_SET_RESAVES, dn);
 		else
-			ret =  vector_add_unique(bb->dn_saves, dn);
+			ret = BB_ADD_UNIQUE(BB_SET_SAVES, dn);
 
 		if (ret < 0)
-			return ret;
+			goto end;
 	}
 
 	for (i = 0; i < bb->exit_dn_aliases->size; i++) {
 		dn =        bb->exit_dn_aliases->data[i];
 
-		if (! vector_find(bb->dn_updateds, dn)) {
+		if (!BB_FIND(BB_SET_UPDATEDS, dn)) {
 
 			if (l !=  list_head(bb_list_head) || !dn->var->arg_flag)
 				continue;
 		}
 
-		ret =  vector_add_unique(bb->dn_resaves, dn);
+		ret = BB_ADD_UNIQUE(BB_SET_RESAVES, dn);
 		if (ret < 0)
-			return ret;
+			goto end;
 	}
 
-	return 0;
+#undef BB_FIND
+#undef BB_ADD_UNIQUE
+
+	ret = 0;
+end:
+	for (i = 0; i < BB_SET_N; i++)
+		 bitset_clear(&sets[i]);
+	return ret;
 }
 
 void  basic_block_mov_code( basic_block_t* to,  list_t* start,  basic_block_t* from)
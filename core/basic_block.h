@@ -4,6 +4,8 @@
 #include "core_types.h"
 #include "utils_list.h"
 #include "utils_vector.h"
+#include "utils_bitset.h"
+#include "dag.h"
 
 typedef struct basic_block_s basic_block_t;
 
@@ -36,6 +38,7 @@ struct basic_block_s {
     list_t list; // for function's basic block list
 
     list_t dag_list_head;
+    dag_cons_t dag_cons; // dag_list_head 的散列索引
 
     list_t code_list_head;
     list_t save_list_head;
@@ -45,7 +48,8 @@ struct basic_block_s {
     vector_t *prevs; // prev basic blocks
     vector_t *nexts; // next basic blocks
 
-    vector_t *dominators;
+    basic_block_t *idom;  // 直接支配者，入口块指向自己，不可达的块为 NULL
+    basic_block_t *ipdom; // 直接后支配者，出口块指向自己
     int dfo;
 
     vector_t *entry_dn_delivery;
@@ -53,6 +57,12 @@ struct basic_block_s {
     vector_t *entry_dn_actives;
     vector_t *exit_dn_actives;
 
+    // 上面四个集合的位集合形式，下标是 dag_node_t 的 index，只在 active_vars 优化器里有效
+    bitset_t entry_dn_delivery_set;
+    bitset_t entry_dn_inactives_set;
+    bitset_t entry_dn_actives_set;
+    bitset_t exit_dn_actives_set;
+
     vector_t *dn_updateds;
     vector_t *dn_loads;
     vector_t *dn_saves;
@@ -81,12 +91,14 @@ struct basic_block_s {
     Epin *mask_pin;
 
     int code_bytes;
+    int code_offset; // 在函数代码里的起始位置(不含 init_code)，见 native_bb_offsets()
     int index;
 
     uint32_t call_flag : 1;
     uint32_t cmp_flag : 1;
     uint32_t jmp_flag : 1;
     uint32_t jcc_flag : 1;
+    uint32_t jmp_table_flag : 1;
     uint32_t ret_flag : 1;
     uint32_t vla_flag : 1;
     uint32_t end_flag : 1;
@@ -128,7 +140,7 @@ void basic_block_print(basic_block_t *bb, list_t *sentinel);
 void basic_block_print_list(list_t *h);
 
 int basic_block_vars(basic_block_t *bb, list_t *bb_list_head);
-int basic_block_dag(basic_block_t *bb, list_t *dag_list_head);
+int basic_block_dag(basic_block_t *bb, list_t *dag_list_head, dag_cons_t *dag_cons);
 
 int basic_block_active_vars(basic_block_t *bb);
 int basic_block_inited_vars(basic_block_t *bb, list_t *bb_list_head);
@@ -136,6 +148,10 @@ int basic_block_loads_saves(basic_block_t *bb, list_t *bb_list_head);
 
 int basic_block_connect(basic_block_t *prev_bb, basic_block_t *next_bb);
 
+int basic_block_dominator_tree(vector_t *rpo, int reverse);
+int basic_block_dominates(basic_block_t *dom, basic_block_t *bb);
+int basic_block_post_dominates(basic_block_t *pdom, basic_block_t *bb);
+
 int basic_block_split(basic_block_t *bb_parent, basic_block_t **pbb_child);
 
 int basic_block_inited_by3ac(basic_block_t *bb);
@@ -77,11 +77,16 @@ void block_free(block_t *b) {
 
 // 寻找类型
 type_t *block_find_type(block_t *b, const char *name) {
+    string_t *id = string_intern_find_cstr(name);
+
     assert(b);
+    if (!id)
+        return NULL;
+
     while (b) {
         if (OP_BLOCK == b->node.type || FUNCTION == b->node.type || b->node.type >= STRUCT) {
             if (b->scope) {
-                type_t *t = scope_find_type(b->scope, name);
+                type_t *t = scope_find_type_id(b->scope, id);
                 if (t)
                     return t;
             }
@@ -110,11 +115,23 @@ type_t *block_find_type_type(block_t *b, const int type) {
 
 // 寻找变量
 variable_t *block_find_variable(block_t *b, const char *name) {
+    string_t *id = string_intern_find_cstr(name);
+
     assert(b);
     while (b) {
         if (OP_BLOCK == b->node.type || FUNCTION == b->node.type || b->node.type >= STRUCT) {
             if (b->scope) {
-                variable_t *v = scope_find_variable(b->scope, name);
+                variable_t *v;
+
+                // 名字还没驻留时可能有还没进索引的变量，按名字查会先补索引
+                if (id)
+                    v = scope_find_variable_id(b->scope, id);
+                else {
+                    v = scope_find_variable(b->scope, name);
+                    if (!v)
+                        id = string_intern_find_cstr(name);
+                }
+
                 if (v)
                     return v;
             }
@@ -126,11 +143,16 @@ variable_t *block_find_variable(block_t *b, const char *name) {
 
 // 寻找函数
 function_t *block_find_function(block_t *b, const char *name) {
+    string_t *id = string_intern_find_cstr(name);
+
     assert(b);
+    if (!id)
+        return NULL;
+
     while (b) {
         if (OP_BLOCK == b->node.type || FUNCTION == b->node.type || b->node.type >= STRUCT) {
             if (b->scope) {
-                function_t *f = scope_find_function(b->scope, name);
+                function_t *f = scope_find_function_id(b->scope, id);
                 if (f)
                     return f;
             }
@@ -142,12 +164,17 @@ function_t *block_find_function(block_t *b, const char *name) {
 
 // 寻找标签
 label_t *block_find_label(block_t *b, const char *name) {
+    string_t *id = string_intern_find_cstr(name);
+
     assert(b);
+    if (!id)
+        return NULL;
+
     while (b) {
         if (OP_BLOCK == b->node.type || FUNCTION == b->node.type) {
             assert(b->scope);
 
-            label_t *l = scope_find_label(b->scope, name);
+            label_t *l = scope_find_label_id(b->scope, id);
 
             if (l)
                 return l;
@@ -199,6 +199,8 @@ enum core_types{
 
 	// 其他
 	OP_3AC_DUMP,
+	OP_3AC_COUNT,    // basic block counter ++, only for 3ac & native
+	OP_3AC_JMP_TABLE, // jmp to the table entry of src, only for 3ac & native
 	OP_3AC_NOP,
 	OP_3AC_END,
 
@@ -2,7 +2,7 @@
 #include "3ac.h"
 
 dn_index_t *dn_index_alloc() {
-    dn_index_t *di = calloc(1, sizeof(dn_index_t));
+    dn_index_t *di = arena_calloc(1, sizeof(dn_index_t));
     if (!di)
         return NULL;
 
@@ -34,7 +34,7 @@ dn_index_t *dn_index_clone(dn_index_t *di) {
 
 void dn_index_free(dn_index_t *di) {
     if (di && 0 == --di->refs)
-        free(di);
+        arena_free(di);
 }
 
 int dn_index_same(const dn_index_t *di0, const dn_index_t *di1) {
@@ -86,7 +86,7 @@ int dn_status_is_like(const dn_status_t *ds) {
 }
 
 dn_status_t *dn_status_null() {
-    dn_status_t *ds = calloc(1, sizeof(dn_status_t));
+    dn_status_t *ds = arena_calloc(1, sizeof(dn_status_t));
     if (!ds)
         return NULL;
 
@@ -95,7 +95,7 @@ dn_status_t *dn_status_null() {
 }
 
 dn_status_t *dn_status_alloc(dag_node_t *dn) {
-    dn_status_t *ds = calloc(1, sizeof(dn_status_t));
+    dn_status_t *ds = arena_calloc(1, sizeof(dn_status_t));
     if (!ds)
         return NULL;
 
@@ -178,7 +178,7 @@ dn_status_t *dn_status_clone(dn_status_t *ds) {
     if (!ds)
         return NULL;
 
-    ds2 = calloc(1, sizeof(dn_status_t));
+    ds2 = arena_calloc(1, sizeof(dn_status_t));
     if (!ds2)
         return NULL;
 
@@ -253,7 +253,7 @@ void dn_status_free(dn_status_t *ds) {
             vector_free(ds->alias_indexes);
         }
 
-        free(ds);
+        arena_free(ds);
     }
 }
 
@@ -297,8 +297,117 @@ void dn_status_print(dn_status_t *ds) {
     printf(" alias_type: %d\n", ds->alias_type);
 }
 
+// 非变量节点按类型分桶的键，最低位是 1，不会和变量指针相同
+#define DAG_CONS_TYPE(type) ((const void *)(((uintptr_t)(type) << 2) | 0x1))
+#define DAG_CONS_NO_CHILD ((const void *)0x2)
+
+// dag_node_same() 对这些类型不逐个比较子节点，只按类型分桶
+static int _dag_cons_by_type(int type) {
+    switch (type) {
+    case OP_LOGIC_AND:
+    case OP_LOGIC_OR:
+    case OP_INC:
+    case OP_DEC:
+    case OP_INC_POST:
+    case OP_DEC_POST:
+    case OP_ADDRESS_OF:
+    case OP_TYPE_CAST:
+    case OP_CALL:
+    case OP_CREATE:
+        return 1;
+    default:
+        break;
+    };
+
+    return 0;
+}
+
+static uint32_t _dag_cons_hash(int type, const void *key) {
+    return (uint32_t)(((uintptr_t)key >> 2) * 2654435761u) ^ ((uint32_t)type * 40503u);
+}
+
+// 子节点在键里的表示：变量节点用变量，其它节点用类型
+static const void *_dag_cons_child_key(int type, variable_t *var) {
+    if (type_is_var(type) && var)
+        return var;
+    return DAG_CONS_TYPE(type);
+}
+
+// 节点的键，dag_node_same() 成立的两个节点键一定相同
+static const void *_dag_cons_key(dag_node_t *dn) {
+    if (type_is_var(dn->type) || _dag_cons_by_type(dn->type))
+        return _dag_cons_child_key(dn->type, dn->var);
+
+    if (!dn->childs || 0 == dn->childs->size)
+        return DAG_CONS_NO_CHILD;
+
+    dag_node_t *child = dn->childs->data[0];
+
+    return _dag_cons_child_key(child->type, child->var);
+}
+
+// 和 dag_node_same() 一样先处理拆分节点和 OP_CREATE
+static const node_t *_dag_cons_node(const node_t *node) {
+    if (node->split_flag)
+        node = node->split_parent;
+
+    if (OP_CREATE == node->type)
+        node = node->result_nodes->data[0];
+    return node;
+}
+
+// 语法树节点的键，node 已经去掉了外层的 OP_EXPR
+static const void *_dag_cons_node_key(const node_t *node, int *ptype) {
+    node = _dag_cons_node(node);
+
+    *ptype = node->type;
+
+    if (type_is_var(node->type) || _dag_cons_by_type(node->type))
+        return _dag_cons_child_key(node->type, node->var);
+
+    if (0 == node->nb_nodes)
+        return DAG_CONS_NO_CHILD;
+
+    const node_t *child = node->nodes[0];
+
+    while (OP_EXPR == child->type)
+        child = child->nodes[0];
+
+    child = _dag_cons_node(child);
+
+    return _dag_cons_child_key(child->type, child->var);
+}
+
+static int _dag_cons_add(dag_node_t *dn) {
+    dn->cons_key = _dag_cons_key(dn);
+
+    return hash_add(&dn->cons->table, dn->cons_key, _dag_cons_hash(dn->type, dn->cons_key), dn);
+}
+
+static void _dag_cons_del(dag_node_t *dn) {
+    hash_del(&dn->cons->table, dn->cons_key, _dag_cons_hash(dn->type, dn->cons_key), dn);
+}
+
+void dag_cons_clear(dag_cons_t *cons) {
+    hash_clear(&cons->table);
+    cons->seq = 0;
+}
+
+// 把新节点加到 DAG 链表末尾，并登记到散列索引
+int dag_add_node(list_t *h, dag_cons_t *cons, dag_node_t *dn) {
+    list_add_tail(h, &dn->list);
+
+    if (!cons)
+        return 0;
+
+    dn->cons = cons;
+    dn->cons_seq = cons->seq++;
+
+    return _dag_cons_add(dn);
+}
+
 dag_node_t *dag_node_alloc(int type, variable_t *var, const node_t *node) {
-    dag_node_t *dn = calloc(1, sizeof(dag_node_t));
+    dag_node_t *dn = arena_calloc(1, sizeof(dag_node_t));
     if (!dn)
         return NULL;
 
@@ -309,6 +418,7 @@ dag_node_t *dag_node_alloc(int type, variable_t *var, const node_t *node) {
         dn->var = NULL;
 
     dn->node = (node_t *)node;
+    dn->index = -1;
 
 #if 0
 	if ( OP_CALL == type) {
@@ -357,11 +467,23 @@ int dag_node_add_child(dag_node_t *parent, dag_node_t *child) {
         return ret;
     }
 
+    // 第一个子节点决定了在散列索引里的键
+    if (parent->cons && 1 == parent->childs->size && DAG_CONS_NO_CHILD == parent->cons_key) {
+        _dag_cons_del(parent);
+
+        ret = _dag_cons_add(parent);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
 void dag_node_free(dag_node_t *dn) {
     if (dn) {
+        if (dn->cons)
+            _dag_cons_del(dn);
+
         if (dn->var)
             variable_free(dn->var);
 
@@ -371,7 +493,7 @@ void dag_node_free(dag_node_t *dn) {
         if (dn->childs)
             vector_free(dn->childs);
 
-        free(dn);
+        arena_free(dn);
         dn = NULL;
     }
 }
@@ -471,6 +593,7 @@ int ds_cmp_alias(const void *p0, const void *p1) {
 }
 
 void dag_node_free_list(list_t *dag_list_head) {
+    dag_cons_t *cons = NULL;
     dag_node_t *dn;
     list_t *l;
 
@@ -481,9 +604,16 @@ void dag_node_free_list(list_t *dag_list_head) {
 
         list_del(&dn->list);
 
+        if (dn->cons)
+            cons = dn->cons;
+
         dag_node_free(dn);
         dn = NULL;
     }
+
+    // 链表空了，索引里只剩删除标记
+    if (cons)
+        dag_cons_clear(cons);
 }
 
 static int __dn_same_call(dag_node_t *dn, const node_t *node, const node_t *split) {
@@ -656,25 +786,95 @@ cmp_childs:
     return 1;
 }
 
-dag_node_t *dag_find_node(list_t *h, const node_t *node) {
+// 按链表顺序给函数的 DAG 节点重新编号，nodes 不为 NULL 时按编号存放节点，返回节点个数
+int dag_index_nodes(list_t *h, vector_t *nodes) {
     dag_node_t *dn;
     list_t *l;
+    int n = 0;
+
+    if (nodes)
+        vector_clear(nodes, NULL);
+
+    for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+        dn = list_data(l, dag_node_t, list);
+
+        dn->index = n++;
+
+        if (nodes && vector_add(nodes, dn) < 0)
+            return -ENOMEM;
+    }
+
+    return n;
+}
+
+// 只给链表末尾新加的、还没编号的节点接着编号，返回编号总数
+int dag_index_new_nodes(list_t *h) {
+    dag_node_t *dn;
+    list_t *l;
+    int n = 0;
+
+    for (l = list_tail(h); l != list_sentinel(h); l = list_prev(l)) {
+        dn = list_data(l, dag_node_t, list);
+
+        if (dn->index >= 0) {
+            n = dn->index + 1;
+            break;
+        }
+    }
+
+    for (l = l != list_sentinel(h) ? list_next(l) : list_head(h); l != list_sentinel(h); l = list_next(l)) {
+        dn = list_data(l, dag_node_t, list);
+
+        dn->index = n++;
+    }
+
+    return n;
+}
+
+dag_node_t *dag_find_node(list_t *h, dag_cons_t *cons, const node_t *node) {
+    dag_node_t *dn;
+    dag_node_t *dn2;
+    list_t *l;
     node_t *origin = (node_t *)node;
 
     while (OP_EXPR == origin->type)
         origin = origin->nodes[0];
 
-    for (l = list_tail(h); l != list_sentinel(h); l = list_prev(l)) {
-        dn = list_data(l, dag_node_t, list);
+    if (!cons) {
+        for (l = list_tail(h); l != list_sentinel(h); l = list_prev(l)) {
+            dn = list_data(l, dag_node_t, list);
+
+            if (dag_node_same(dn, origin))
+                return dn;
+        }
+
+        return NULL;
+    }
+
+    // 只比较键相同的候选，和从链表尾部往前找一样，取最后加入的
+    int type;
+    int pos = -1;
+
+    const void *key = _dag_cons_node_key(origin, &type);
+    uint32_t hash = _dag_cons_hash(type, key);
+
+    dn2 = NULL;
+
+    while ((dn = hash_next(&cons->table, key, hash, &pos))) {
+        if (dn->type != type)
+            continue;
+
+        if (dn2 && dn->cons_seq < dn2->cons_seq)
+            continue;
 
         if (dag_node_same(dn, origin))
-            return dn;
+            dn2 = dn;
     }
 
-    return NULL;
+    return dn2;
 }
 
-int dag_get_node(list_t *h, const node_t *node, dag_node_t **pp) {
+int dag_get_node(list_t *h, dag_cons_t *cons, const node_t *node, dag_node_t **pp) {
     const node_t *node2;
     variable_t *v;
     dag_node_t *dn;
@@ -686,14 +886,16 @@ int dag_get_node(list_t *h, const node_t *node, dag_node_t **pp) {
 
     v = _operand_get((node_t *)node2);
 
-    dn = dag_find_node(h, node2);
+    dn = dag_find_node(h, cons, node2);
 
     if (!dn) {
         dn = dag_node_alloc(node2->type, v, node2);
         if (!dn)
             return -ENOMEM;
 
-        list_add_tail(h, &dn->list);
+        int ret = dag_add_node(h, cons, dn);
+        if (ret < 0)
+            return ret;
 
         dn->old = *pp;
     } else {
@@ -897,7 +1099,7 @@ int ds_for_dn(dn_status_t **pds, dag_node_t *dn) {
 
     ds->dn_indexes = vector_alloc();
     if (!ds->dn_indexes) {
-        free(ds);
+        arena_free(ds);
         return -ENOMEM;
     }
 
@@ -927,7 +1129,7 @@ int ds_for_assign_member(dn_status_t **pds, dag_node_t *dn_base, dag_node_t *dn_
 
     ds->dn_indexes = vector_alloc();
     if (!ds->dn_indexes) {
-        free(ds);
+        arena_free(ds);
         return -ENOMEM;
     }
 
@@ -963,7 +1165,7 @@ int ds_for_assign_array_member(dn_status_t **pds, dag_node_t *dn_base, dag_node_
 
     ds->dn_indexes = vector_alloc();
     if (!ds->dn_indexes) {
-        free(ds);
+        arena_free(ds);
         return -ENOMEM;
     }
 
@@ -1001,7 +1203,7 @@ int ds_for_assign_dereference(dn_status_t **pds, dag_node_t *dn) {
 
     ds->dn_indexes = vector_alloc();
     if (!ds->dn_indexes) {
-        free(ds);
+        arena_free(ds);
         return -ENOMEM;
     }
 
@@ -2,6 +2,8 @@
 #define DAG_H
 
 #include "utils_vector.h"
+#include "utils_hash.h"
+#include "utils_arena.h"
 #include "variable.h"
 #include "node.h"
 
@@ -9,6 +11,13 @@ typedef struct dag_node_s dag_node_t;
 typedef struct dn_index_s dn_index_t;
 typedef struct dn_status_s dn_status_t;
 
+// DAG 的散列索引(hash consing)：按 (类型, 变量或第一个子节点) 找候选节点，
+// 和节点链表放在一起，查找时不用再从尾到头扫整个链表
+typedef struct {
+    hash_t table;
+    int seq; // 节点加入链表的顺序号，候选里取最后加入的
+} dag_cons_t;
+
 enum dn_alias_type {
     DN_ALIAS_NULL = 0,
 
@@ -39,6 +48,13 @@ struct dag_node_s {
     int n_pins;
 
     intptr_t color;
+    int64_t spill_cost; // 溢出代价，由后端在分配寄存器之前计算，见 native_spill_costs()
+
+    int index; // 函数内的稠密编号，用作位集合的下标，-1 表示还没有编号
+
+    dag_cons_t *cons; // 所在 DAG 的散列索引，不在索引里时为 NULL
+    const void *cons_key; // 在索引里的键
+    int cons_seq;
 
     uint32_t done : 1;
 
@@ -109,8 +125,14 @@ int dag_dn_same(dag_node_t *dn0, dag_node_t *dn1);
 int dag_node_same(dag_node_t *dn, const node_t *node);
 void dag_node_free(dag_node_t *dn);
 
-dag_node_t *dag_find_node(list_t *h, const node_t *node);
-int dag_get_node(list_t *h, const node_t *node, dag_node_t **pp);
+void dag_cons_clear(dag_cons_t *cons);
+int dag_add_node(list_t *h, dag_cons_t *cons, dag_node_t *dn);
+
+int dag_index_nodes(list_t *h, vector_t *nodes);
+int dag_index_new_nodes(list_t *h);
+
+dag_node_t *dag_find_node(list_t *h, dag_cons_t *cons, const node_t *node);
+int dag_get_node(list_t *h, dag_cons_t *cons, const node_t *node, dag_node_t **pp);
 
 int dag_find_roots(list_t *h, vector_t *roots);
 
@@ -44,6 +44,10 @@ function_t *function_alloc(lex_word_t *w) {
     if (!f->jmps)
         goto _jmps_error;
 
+    f->jmp_tables = vector_alloc();
+    if (!f->jmp_tables)
+        goto _jmp_table_error;
+
     f->bb_loops = vector_alloc();
     if (!f->bb_loops)
         goto _loop_error;
@@ -69,6 +73,8 @@ _text_rela_error:
 _group_error:
     vector_free(f->bb_loops);
 _loop_error:
+    vector_free(f->jmp_tables);
+_jmp_table_error:
     vector_free(f->jmps);
 _jmps_error:
     vector_free(f->caller_functions);
@@ -114,11 +120,27 @@ void function_free(function_t *f) {
         if (f->caller_functions)
             vector_free(f->caller_functions);
 
+        if (f->bb_counts) {
+            free(f->bb_counts);
+            f->bb_counts = NULL;
+        }
+
+        if (f->call_counts) {
+            vector_clear(f->call_counts, free);
+            vector_free(f->call_counts);
+            f->call_counts = NULL;
+        }
+
         if (f->jmps) {
             vector_free(f->jmps);
             f->jmps = NULL;
         }
 
+        if (f->jmp_tables) {
+            vector_free(f->jmp_tables);
+            f->jmp_tables = NULL;
+        }
+
         if (f->text_relas) {
             vector_free(f->text_relas);
             f->text_relas = NULL;
@@ -129,12 +151,19 @@ void function_free(function_t *f) {
             f->data_relas = NULL;
         }
 
+        dag_cons_clear(&f->dag_cons);
+
+        if (f->arena) {
+            arena_close(f->arena);
+            f->arena = NULL;
+        }
+
         node_free((node_t *)f);
     }
 }
 
 int function_same(function_t *f0, function_t *f1) {
-    if (strcmp(f0->node.w->text->data, f1->node.w->text->data))
+    if (lex_word_id(f0->node.w) != lex_word_id(f1->node.w))
         return 0;
 
     return function_same_type(f0, f1);
@@ -1,6 +1,7 @@
 #ifndef FUNCTION_H
 #define FUNCTION_H
 #include "node.h"
+#include "dag.h"
 
 /*
 function_s 本质上是编译器/解释器里函数抽象表示的数据结构，保存了从语法、语义分析到代码生成阶段所需的各种信息：
@@ -15,6 +16,13 @@ function_s 本质上是编译器/解释器里函数抽象表示的数据结构
     标志位：标记函数是否是 static/extern/inline、是否有可变参数等。
 */
 
+// 上一次插桩运行得到的一个调用点的执行次数，调用点按(被调函数, 行号)区分
+typedef struct {
+    function_t* callee;
+    int         line;
+    uint64_t    count;
+} call_count_t;
+
 // 表示函数(Function)的结构体
 struct function_s
 {
@@ -40,8 +48,12 @@ struct function_s
     int nb_basic_blocks;// 基本块数量
 
     vector_t* jmps;// 跳转指令集合(控制流跳转信息)
+    vector_t* jmp_tables;// 查表跳转指令集合，表本身由 parse 放进 .rodata
 
     list_t dag_list_head;// DAG(有向无环图)链表头，可能用于优化中间代码
+    dag_cons_t dag_cons;// dag_list_head 的散列索引，按运算符、子节点、变量查找已有节点
+
+    arena_t* arena;// 编译这个函数时的三地址码、DAG 节点、基本块从这里分配，函数释放时整体释放
 
     vector_t* bb_loops;// 基本块中循环集合
     vector_t* bb_groups;// 基本块分组集合
@@ -62,6 +74,13 @@ struct function_s
     int local_vars_size;// 局部变量占用的栈大小
     int code_bytes;// 函数编译生成的机器码大小
 
+    variable_t* prof_counters;// 插桩编译时基本块的计数器数组，下标是基本块的 index，不插桩时为 NULL
+    int prof_offset;// 计数器数组在 scf_prof 段里的偏移
+
+    uint64_t* bb_counts;// 上一次插桩运行得到的各基本块执行次数，下标是基本块的 index，没有时为 NULL
+    int nb_bb_counts;
+    vector_t* call_counts;// 上一次插桩运行得到的调用点执行次数(call_count_t)，内联按它选热的调用点，没有时为 NULL
+
     // 标志位（使用位域存储多个布尔标志）
     uint32_t visited_flag:1;     // 是否已经被访问过（图遍历/优化时使用）
     uint32_t bp_used_flag:1;     // 是否使用了基址指针 (base pointer)
@@ -1139,34 +1139,370 @@ static int _op_case(ast_t* ast, node_t** nodes, int nb_nodes, void* data)
 	return 0;
 }
 
-static int _op_switch(ast_t* ast, node_t** nodes, int nb_nodes, void* data)
+#define SWITCH_MIN_CASES   4    // 少于这么多 case 时逐个比较
+#define SWITCH_TABLE_RANGE 4096 // 跳转表最多的项数
+#define SWITCH_LEAF_CASES  3    // 二分查找分到这么多 case 以内时逐个比较
+
+typedef struct {
+	int64_t         value;
+	node_t*         node;  // case 后面的常量
+	int             label; // case 在 switch 块里的下标
+} switch_case_t;
+
+typedef struct {
+	_3ac_operand_t* dst;
+	int             label; // 跳到 switch 块里这个下标的 case / default，-1 是跳出 switch
+} switch_fix_t;
+
+static int _switch_case_cmp(const void* p0, const void* p1)
 {
-	assert(2 == nb_nodes);
+	const switch_case_t* c0 = p0;
+	const switch_case_t* c1 = p1;
 
-	handler_data_t* d = data;
-	expr_t*         e = nodes[0];
-	node_t*         b = nodes[1];
+	if (c0->value == c1->value)
+		return 0;
+	return c0->value < c1->value ? -1 : 1;
+}
 
-	assert(OP_EXPR == e->type);
+static int _switch_case_ucmp(const void* p0, const void* p1)
+{
+	const switch_case_t* c0 = p0;
+	const switch_case_t* c1 = p1;
 
-	while (e && OP_EXPR == e->type)
-		e = e->nodes[0];
+	if (c0->value == c1->value)
+		return 0;
+	return (uint64_t)c0->value < (uint64_t)c1->value ? -1 : 1;
+}
 
-	if (_expr_calculate_internal(ast, e, d) < 0) {
-		loge("\n");
-		return -1;
+// case 的常量按 switch 表达式的类型截断或扩展
+static int64_t _switch_case_value(variable_t* ve, variable_t* v)
+{
+	int64_t x;
+
+	if (variable_size(v) > 4)
+		x = v->data.i64;
+	else if (type_is_unsigned(v->type))
+		x = (uint32_t)v->data.i;
+	else
+		x = v->data.i;
+
+	int bits = variable_size(ve) << 3;
+	if (bits >= 64)
+		return x;
+
+	if (type_is_unsigned(ve->type))
+		return (int64_t)((uint64_t)x & ((1ULL << bits) - 1));
+
+	return (int64_t)((uint64_t)x << (64 - bits)) >> (64 - bits);
+}
+
+static node_t* _switch_var_node(ast_t* ast, node_t* parent, variable_t* ve, int const_flag, int64_t value)
+{
+	type_t*     t = block_find_type_type(ast->current_block, ve->type);
+	variable_t* v = VAR_ALLOC_BY_TYPE(NULL, t, const_flag, 0, NULL);
+	node_t*     n;
+
+	if (!v)
+		return NULL;
+
+	if (const_flag) {
+		v->data.i64 = value;
+		v->const_literal_flag = 1;
+	} else
+		v->tmp_flag = 1;
+
+	n = node_alloc(NULL, v->type, v);
+	variable_free(v);
+	v = NULL;
+	if (!n)
+		return NULL;
+
+	if (node_add_child(parent, n) < 0) {
+		node_free(n);
+		return NULL;
 	}
 
-	branch_ops_t* up_branch_ops = d->branch_ops;
-	block_t*      up            = ast->current_block;
+	return n;
+}
 
-	d->branch_ops      = branch_ops_alloc();
-	ast->current_block = (block_t*)b;
+static int _switch_jmp(list_t* h, int op_type, switch_fix_t* fixes, int* nb_fixes, int label)
+{
+	_3ac_code_t* jmp = _3ac_jmp_code(op_type, NULL, NULL);
+	if (!jmp)
+		return -ENOMEM;
+
+	list_add_tail(h, &jmp->list);
+
+	if (fixes) {
+		fixes[*nb_fixes].dst   = jmp->dsts->data[0];
+		fixes[*nb_fixes].label = label;
+		(*nb_fixes)++;
+	}
+	return 0;
+}
+
+// 按排好序的 case 生成平衡的二分查找，小于的一半放在后面
+static int _switch_bsearch(list_t* h, node_t* e, switch_case_t* cases, int n, int jlt, int label_default, switch_fix_t* fixes, int* nb_fixes)
+{
+	node_t* srcs[2] = {e, NULL};
+	int     ret;
+	int     i;
+
+	if (n <= SWITCH_LEAF_CASES) {
+		for (i = 0; i < n; i++) {
+			srcs[1] = cases[i].node;
+
+			ret = _3ac_code_NN(h, OP_3AC_CMP, NULL, 0, srcs, 2);
+			if (ret < 0)
+				return ret;
+
+			ret = _switch_jmp(h, OP_3AC_JZ, fixes, nb_fixes, cases[i].label);
+			if (ret < 0)
+				return ret;
+		}
+
+		return _switch_jmp(h, OP_GOTO, fixes, nb_fixes, label_default);
+	}
+
+	int mid = n / 2;
+
+	srcs[1] = cases[mid].node;
+
+	ret = _3ac_code_NN(h, OP_3AC_CMP, NULL, 0, srcs, 2);
+	if (ret < 0)
+		return ret;
+
+	ret = _switch_jmp(h, OP_3AC_JZ, fixes, nb_fixes, cases[mid].label);
+	if (ret < 0)
+		return ret;
+
+	ret = _switch_jmp(h, jlt, NULL, NULL, 0);
+	if (ret < 0)
+		return ret;
+
+	_3ac_code_t*    jmp = list_data(list_tail(h), _3ac_code_t, list);
+	_3ac_operand_t* dst = jmp->dsts->data[0];
+
+	ret = _switch_bsearch(h, e, cases + mid + 1, n - mid - 1, jlt, label_default, fixes, nb_fixes);
+	if (ret < 0)
+		return ret;
+
+	list_t* prev = list_tail(h);
+
+	ret = _switch_bsearch(h, e, cases, mid, jlt, label_default, fixes, nb_fixes);
+	if (ret < 0)
+		return ret;
+
+	dst->code = list_data(list_next(prev), _3ac_code_t, list);
+	return 0;
+}
+
+/* case 都是整数常量并且足够多时，先生成一次分派再顺序生成各个 case 的代码:
+ * 值密集的查跳转表，稀疏的二分查找，返回 1，
+ * 不满足条件时返回 0，由调用者逐个比较
+ */
+static int _switch_dispatch(ast_t* ast, node_t* parent, node_t* e, node_t* b, handler_data_t* d)
+{
+	variable_t*     ve    = _operand_get(e);
+	variable_t*     v;
+	switch_case_t*  cases = NULL;
+	switch_fix_t*   fixes = NULL;
+	list_t**        prevs = NULL;
+	list_t*         h     = d->_3ac_list_head;
+	_3ac_code_t*    nop;
+	node_t*         child;
+	node_t*         e2;
+
+	int label_default = -1;
+	int nb_fixes      = 0;
+	int n             = 0;
+	int ret           = 0;
+	int i;
+
+	if (!ve || !type_is_integer(ve->type) || ve->nb_pointers > 0 || ve->nb_dimentions > 0)
+		return 0;
+
+	for (i = 0; i < b->nb_nodes; i++) {
+		child = b->nodes[i];
+
+		if (OP_DEFAULT == child->type)
+			label_default = i;
+
+		else if (OP_CASE == child->type) {
+			e2 = child->nodes[0];
+
+			while (e2 && OP_EXPR == e2->type)
+				e2 = e2->nodes[0];
+
+			v = _operand_get(e2);
+
+			if (!type_is_var(e2->type) || !v->const_literal_flag || !variable_const_integer(v))
+				return 0;
+			n++;
+		}
+	}
+
+	if (n < SWITCH_MIN_CASES)
+		return 0;
 
+	cases = calloc(n, sizeof(switch_case_t));
+	if (!cases)
+		return -ENOMEM;
+
+	n = 0;
+	for (i = 0; i < b->nb_nodes; i++) {
+		child = b->nodes[i];
+
+		if (OP_CASE != child->type)
+			continue;
+
+		e2 = child->nodes[0];
+		while (e2 && OP_EXPR == e2->type)
+			e2 = e2->nodes[0];
+
+		cases[n].value = _switch_case_value(ve, _operand_get(e2));
+		cases[n].node  = e2;
+		cases[n].label = i;
+		n++;
+	}
+
+	int uflag = type_is_unsigned(ve->type);
+
+	qsort(cases, n, sizeof(switch_case_t), uflag ? _switch_case_ucmp : _switch_case_cmp);
+
+	for (i = 1; i < n; i++) {
+		if (cases[i].value == cases[i - 1].value) { // 重复的 case 留给逐个比较
+			ret = 0;
+			goto end;
+		}
+	}
+
+	uint64_t span  = (uint64_t)cases[n - 1].value - (uint64_t)cases[0].value;
+	int      range = 0;
+
+	if (span < SWITCH_TABLE_RANGE && span < 4ULL * n)
+		range = span + 1;
+
+	fixes = calloc(2 * n + range + 2, sizeof(switch_fix_t));
+	prevs = calloc(b->nb_nodes, sizeof(list_t*));
+	if (!fixes || !prevs) {
+		ret = -ENOMEM;
+		goto end;
+	}
+
+	if (range > 0) {
+		node_t*      idx = e;
+		node_t*      srcs[2];
+		variable_t*  table;
+		_3ac_code_t* jt;
+
+		if (0 != cases[0].value) {
+			srcs[0] = e;
+			srcs[1] = _switch_var_node(ast, parent, ve, 1, cases[0].value);
+
+			idx = _switch_var_node(ast, parent, ve, 0, 0);
+			if (!srcs[1] || !idx) {
+				ret = -ENOMEM;
+				goto end;
+			}
+
+			ret = _3ac_code_NN(h, OP_SUB, &idx, 1, srcs, 2);
+			if (ret < 0)
+				goto end;
+		}
+
+		srcs[0] = idx;
+		srcs[1] = _switch_var_node(ast, parent, ve, 1, range - 1);
+		if (!srcs[1]) {
+			ret = -ENOMEM;
+			goto end;
+		}
+
+		ret = _3ac_code_NN(h, OP_3AC_CMP, NULL, 0, srcs, 2);
+		if (ret < 0)
+			goto end;
+
+		ret = _switch_jmp(h, OP_3AC_JA, fixes, &nb_fixes, label_default);
+		if (ret < 0)
+			goto end;
+
+		// 表在 .rodata 里，每项是目标的地址，见 parse 的 _parse_add_data_relas()
+		type_t* t = block_find_type_type(ast->current_block, VAR_UINTPTR);
+
+		table = VAR_ALLOC_BY_TYPE(parent->w, t, 1, 0, NULL);
+		if (!table) {
+			ret = -ENOMEM;
+			goto end;
+		}
+		table->static_flag = 1;
+
+		jt = _3ac_jmp_table_code(idx, table, range);
+		variable_free(table);
+		table = NULL;
+		if (!jt) {
+			ret = -ENOMEM;
+			goto end;
+		}
+		list_add_tail(h, &jt->list);
+
+		int j = 0;
+		for (i = 0; i < range; i++) {
+			fixes[nb_fixes].dst = jt->jmp_table->targets->data[i];
+
+			if (j < n && (uint64_t)cases[j].value - (uint64_t)cases[0].value == (uint64_t)i)
+				fixes[nb_fixes].label = cases[j++].label;
+			else
+				fixes[nb_fixes].label = label_default;
+			nb_fixes++;
+		}
+	} else {
+		ret = _switch_bsearch(h, e, cases, n, uflag ? OP_3AC_JB : OP_3AC_JLT, label_default, fixes, &nb_fixes);
+		if (ret < 0)
+			goto end;
+	}
+
+	// 顺序生成各个 case 的代码，记下每个 case 之前的最后一条三地址码
+	for (i = 0; i < b->nb_nodes; i++) {
+		child = b->nodes[i];
+
+		if (OP_CASE == child->type || OP_DEFAULT == child->type)
+			prevs[i] = list_tail(h);
+
+		else if (_op_node(ast, child, d) < 0) {
+			loge("\n");
+			ret = -1;
+			goto end;
+		}
+	}
+
+	nop = _3ac_code_alloc();
+	if (!nop) {
+		ret = -ENOMEM;
+		goto end;
+	}
+	nop->op = _3ac_find_operator(OP_3AC_NOP);
+	list_add_tail(h, &nop->list);
+
+	for (i = 0; i < nb_fixes; i++) {
+		if (fixes[i].label < 0)
+			fixes[i].dst->code = nop;
+		else
+			fixes[i].dst->code = list_data(list_next(prevs[fixes[i].label]), _3ac_code_t, list);
+	}
+
+	ret = 1;
+end:
+	free(prevs);
+	free(fixes);
+	free(cases);
+	return ret;
+}
+
+// case 之间逐个比较，不匹配时跳到下一个 case 的比较
+static int _switch_linear(ast_t* ast, node_t* e, node_t* b, branch_ops_t* up_branch_ops, handler_data_t* d)
+{
 	_3ac_operand_t* dst;
 	_3ac_code_t*    cmp;
-	_3ac_code_t*    end;
-	_3ac_code_t*    c;
 	_3ac_code_t*    jnot  = NULL;
 	_3ac_code_t*    jnext = NULL;
 
@@ -1239,9 +1575,53 @@ static int _op_switch(ast_t* ast, node_t** nodes, int nb_nodes, void* data)
 		}
 	}
 
+	return 0;
+}
+
+static int _op_switch(ast_t* ast, node_t** nodes, int nb_nodes, void* data)
+{
+	assert(2 == nb_nodes);
+
+	handler_data_t* d = data;
+	expr_t*         e = nodes[0];
+	node_t*         b = nodes[1];
+
+	assert(OP_EXPR == e->type);
+
+	while (e && OP_EXPR == e->type)
+		e = e->nodes[0];
+
+	if (_expr_calculate_internal(ast, e, d) < 0) {
+		loge("\n");
+		return -1;
+	}
+
+	branch_ops_t* up_branch_ops = d->branch_ops;
+	block_t*      up            = ast->current_block;
+
+	d->branch_ops      = branch_ops_alloc();
+	ast->current_block = (block_t*)b;
+
+	_3ac_operand_t* dst;
+	_3ac_code_t*    end;
+	_3ac_code_t*    c;
+	list_t*         l;
+
+	int ret = _switch_dispatch(ast, nodes[0]->parent, e, b, d);
+	if (ret < 0) {
+		loge("\n");
+		return -1;
+	}
+
+	if (0 == ret && _switch_linear(ast, e, b, up_branch_ops, d) < 0) {
+		loge("\n");
+		return -1;
+	}
+
 	l   = list_tail(d->_3ac_list_head);
 	end = list_data(l, _3ac_code_t, list);
 
+	int i;
 	for (i = 0; i < d->branch_ops->_breaks->size; i++) {
 		c  =        d->branch_ops->_breaks->data[i];
 
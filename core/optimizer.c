@@ -1,6 +1,7 @@
 #include "optimizer.h"
 
 extern optimizer_t optimizer_inline;
+extern optimizer_t optimizer_dce;
 extern optimizer_t optimizer_split_call;
 
 extern optimizer_t optimizer_dag;
@@ -22,18 +23,22 @@ extern optimizer_t optimizer_auto_gc;
 
 extern optimizer_t optimizer_basic_block;
 
+extern optimizer_t optimizer_sccp;
 extern optimizer_t optimizer_const_teq;
 
 extern optimizer_t optimizer_loop;
+extern optimizer_t optimizer_licm;
 
 extern optimizer_t optimizer_vla;
 
 extern optimizer_t optimizer_group;
 extern optimizer_t optimizer_generate_loads_saves;
+extern optimizer_t optimizer_instrument;
 
 static optimizer_t *optimizers[] =
     {
         &optimizer_inline, // global optimizer
+        &optimizer_dce,
         &optimizer_split_call,
 
         &optimizer_dag,
@@ -54,19 +59,67 @@ static optimizer_t *optimizers[] =
         &optimizer_auto_gc,
 
         &optimizer_basic_block,
+        &optimizer_sccp,
         &optimizer_const_teq,
 
         &optimizer_dominators,
         &optimizer_loop,
+        &optimizer_licm,
+        &optimizer_dce,
         &optimizer_vla,
         &optimizer_group,
 
         &optimizer_generate_loads_saves,
+        &optimizer_instrument,
 
         &optimizer_dominators_reverse,
 };
 
-int optimize(ast_t *ast, vector_t *functions) {
+// 局部优化器之前先给函数的 DAG 节点重新编号，basic_block.c 里的集合运算以编号为位集合下标
+// 局部优化器生成的中间表示从函数自己的 arena 分配
+static int _optimize_local(ast_t *ast, optimizer_t *opt, function_t *f) {
+    dag_index_nodes(&f->dag_list_head, NULL);
+
+    arena_t *prev = arena_switch(f->arena);
+
+    int ret = opt->optimize(ast, f, NULL);
+
+    arena_switch(prev);
+    return ret;
+}
+
+// 一段连续的局部优化器 [first, last)，按函数并行执行
+typedef struct {
+    ast_t *ast;
+    vector_t *functions;
+    int first;
+    int last;
+} optimizer_job_t;
+
+// 局部优化器只读写一个函数，同一个函数的几个局部优化器依次执行，不同函数互不干扰
+static int _optimize_function(void *arg, int i) {
+    optimizer_job_t *job = arg;
+    function_t *f = job->functions->data[i];
+    optimizer_t *opt;
+
+    if (!f->node.define_flag)
+        return 0;
+
+    int j;
+    for (j = job->first; j < job->last; j++) {
+        opt = optimizers[j];
+
+        int ret = _optimize_local(job->ast, opt, f);
+        if (ret < 0) {
+            loge("optimizer: %s, function: %s()\n", opt->name, f->node.w->text->data);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+int optimize(ast_t *ast, vector_t *functions, thread_pool_t *pool) {
     optimizer_t *opt;
     function_t *f;
     bb_group_t *bbg;
@@ -87,13 +140,28 @@ int optimize(ast_t *ast, vector_t *functions) {
             continue;
         }
 
+        if (pool) {
+            // 全局优化器是屏障，它们之间的局部优化器作为一段交给线程池
+            optimizer_job_t job = {ast, functions, i, i + 1};
+
+            while (job.last < n && OPTIMIZER_GLOBAL != optimizers[job.last]->flags)
+                job.last++;
+
+            int ret = thread_pool_for(pool, functions->size, _optimize_function, &job);
+            if (ret < 0)
+                return ret;
+
+            i = job.last - 1;
+            continue;
+        }
+
         for (j = 0; j < functions->size; j++) {
             f = functions->data[j];
 
             if (!f->node.define_flag)
                 continue;
 
-            int ret = opt->optimize(ast, f, NULL);
+            int ret = _optimize_local(ast, opt, f);
             if (ret < 0) {
                 loge("optimizer: %s\n", opt->name);
                 return ret;
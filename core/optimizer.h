@@ -4,6 +4,7 @@
 #include "ast.h"
 #include "basic_block.h"
 #include "3ac.h"
+#include "utils_thread_pool.h"
 
 typedef struct optimizer_s optimizer_t;
 
@@ -20,6 +21,7 @@ struct optimizer_s {
 int bbg_find_entry_exit(bb_group_t *bbg);
 void loops_print(vector_t *loops);
 
-int optimize(ast_t *ast, vector_t *functions);
+// pool 为 NULL 时串行，否则两个全局优化器之间的局部优化按函数并行
+int optimize(ast_t *ast, vector_t *functions, thread_pool_t *pool);
 
 #endif
\ No newline at end of file
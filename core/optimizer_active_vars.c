@@ -2,59 +2,92 @@
 
 #include "optimizer.h"
 
+// 整个优化器共用的数据：按编号存放的 DAG 节点，以及一个临时位集合
+typedef struct {
+    vector_t *dag_nodes;
+    bitset_t tmp;
+} active_vars_data_t;
+
+// 把 set 里有、vec 里还没有的节点按编号顺序追加到 vec
+static int _dn_set_to_vec(vector_t *vec, bitset_t *set, vector_t *dag_nodes) {
+    int i;
+
+    bitset_for_each(set, i) {
+        int ret = vector_add(vec, dag_nodes->data[i]);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int _dn_vec_to_set(bitset_t *set, vector_t *vec) {
+    dag_node_t *dn;
+    int i;
+
+    int ret = bitset_reset(set, 0);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < vec->size; i++) {
+        dn = vec->data[i];
+
+        assert(dn->index >= 0);
+
+        ret = bitset_add(set, dn->index);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 static int _bb_prev_find(basic_block_t *bb, void *data, vector_t *queue) {
+    active_vars_data_t *d = data;
     basic_block_t *prev_bb;
-    dag_node_t *dn;
 
     int count = 0;
     int ret;
     int j;
-    int k;
-
-    for (k = 0; k < bb->exit_dn_actives->size; k++) {
-        dn = bb->exit_dn_actives->data[k];
 
-        if (vector_find(bb->entry_dn_inactives, dn))
-            continue;
+    // delivery += exit_actives - entry_inactives - entry_actives - delivery
+    ret = bitset_copy(&d->tmp, &bb->exit_dn_actives_set);
+    if (ret < 0)
+        return ret;
 
-        if (vector_find(bb->entry_dn_actives, dn))
-            continue;
+    bitset_andnot(&d->tmp, &bb->entry_dn_inactives_set);
+    bitset_andnot(&d->tmp, &bb->entry_dn_actives_set);
+    bitset_andnot(&d->tmp, &bb->entry_dn_delivery_set);
 
-        if (vector_find(bb->entry_dn_delivery, dn))
-            continue;
+    ret = _dn_set_to_vec(bb->entry_dn_delivery, &d->tmp, d->dag_nodes);
+    if (ret < 0)
+        return ret;
 
-        ret = vector_add(bb->entry_dn_delivery, dn);
-        if (ret < 0)
-            return ret;
-        ++count;
-    }
+    ret = bitset_or(&bb->entry_dn_delivery_set, &d->tmp);
+    if (ret < 0)
+        return ret;
+    count += ret;
 
     for (j = 0; j < bb->prevs->size; j++) {
         prev_bb = bb->prevs->data[j];
 
-        for (k = 0; k < bb->entry_dn_actives->size; k++) {
-            dn = bb->entry_dn_actives->data[k];
-
-            if (vector_find(prev_bb->exit_dn_actives, dn))
-                continue;
+        // prev.exit_actives += (entry_actives + delivery) - prev.exit_actives
+        ret = bitset_copy(&d->tmp, &bb->entry_dn_actives_set);
+        if (ret < 0)
+            return ret;
 
-            ret = vector_add(prev_bb->exit_dn_actives, dn);
-            if (ret < 0)
-                return ret;
-            ++count;
-        }
+        ret = bitset_or(&d->tmp, &bb->entry_dn_delivery_set);
+        if (ret < 0)
+            return ret;
 
-        for (k = 0; k < bb->entry_dn_delivery->size; k++) {
-            dn = bb->entry_dn_delivery->data[k];
+        bitset_andnot(&d->tmp, &prev_bb->exit_dn_actives_set);
 
-            if (vector_find(prev_bb->exit_dn_actives, dn))
-                continue;
+        ret = _dn_set_to_vec(prev_bb->exit_dn_actives, &d->tmp, d->dag_nodes);
+        if (ret < 0)
+            return ret;
 
-            ret = vector_add(prev_bb->exit_dn_actives, dn);
-            if (ret < 0)
-                return ret;
-            ++count;
-        }
+        ret = bitset_or(&prev_bb->exit_dn_actives_set, &d->tmp);
+        if (ret < 0)
+            return ret;
+        count += ret;
 
         ret = vector_add(queue, prev_bb);
         if (ret < 0)
@@ -71,18 +104,49 @@ static int _optimize_active_vars(ast_t *ast, function_t *f, vector_t *functions)
     list_t *l;
     basic_block_t *bb;
 
+    active_vars_data_t d = {NULL};
+
     int count;
     int ret;
 
     if (list_empty(bb_list_head))
         return 0;
 
+    d.dag_nodes = vector_alloc();
+    if (!d.dag_nodes)
+        return -ENOMEM;
+
+    // 给 DAG 节点稠密编号，活跃变量的传播都在位集合上按字进行
+    ret = dag_index_nodes(&f->dag_list_head, d.dag_nodes);
+    if (ret < 0)
+        goto end;
+
     for (l = list_head(bb_list_head); l != list_sentinel(bb_list_head); l = list_next(l)) {
         bb = list_data(l, basic_block_t, list);
 
         ret = basic_block_active_vars(bb);
         if (ret < 0)
-            return ret;
+            goto end;
+    }
+
+    for (l = list_head(bb_list_head); l != list_sentinel(bb_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        ret = _dn_vec_to_set(&bb->entry_dn_delivery_set, bb->entry_dn_delivery);
+        if (ret < 0)
+            goto end;
+
+        ret = _dn_vec_to_set(&bb->entry_dn_inactives_set, bb->entry_dn_inactives);
+        if (ret < 0)
+            goto end;
+
+        ret = _dn_vec_to_set(&bb->entry_dn_actives_set, bb->entry_dn_actives);
+        if (ret < 0)
+            goto end;
+
+        ret = _dn_vec_to_set(&bb->exit_dn_actives_set, bb->exit_dn_actives);
+        if (ret < 0)
+            goto end;
     }
 
     do {
@@ -90,15 +154,19 @@ static int _optimize_active_vars(ast_t *ast, function_t *f, vector_t *functions)
         bb = list_data(l, basic_block_t, list);
         assert(bb->end_flag);
 
-        ret = basic_block_search_bfs(bb, _bb_prev_find, NULL);
+        ret = basic_block_search_bfs(bb, _bb_prev_find, &d);
         if (ret < 0)
-            return ret;
+            goto end;
         count = ret;
 
     } while (count > 0);
 
     //	  basic_block_print_list(bb_list_head);
-    return 0;
+    ret = 0;
+end:
+    bitset_clear(&d.tmp);
+    vector_free(d.dag_nodes);
+    return ret;
 }
 
 optimizer_t optimizer_active_vars =
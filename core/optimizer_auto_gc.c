@@ -379,12 +379,10 @@ static int _bb_add_last_free(dn_status_t *ds, basic_block_t *bb, ast_t *ast, fun
     AUTO_GC_FIND_MAX_DFO();
     vec->size = 0;
 
-    for (j = 0; j < bb->dominators->size; j++) {
-        bb2 = bb->dominators->data[j];
-
-        if (bb2->dfo > dfo)
-            break;
-    }
+    // 支配 bb 的块里 dfo 大于 dfo 的最靠上的一个，没有就是 bb 自己；支配树上越往上 dfo 越小
+    bb2 = bb;
+    while (bb2->idom && bb2->idom != bb2 && bb2->idom->dfo > dfo)
+        bb2 = bb2->idom;
 
     ret = _bb_split_prevs(bb2, ds, vec);
     if (ret < 0) {
@@ -61,7 +61,7 @@ static int _alias_call(vector_t *aliases, _3ac_code_t *c, basic_block_t *bb, lis
             if (dn != dn_pointer && dn->var->nb_pointers > 1) {
                 logd("pointer: v_%d_%d/%s,   DN_ALIAS_ALLOC\n", v->w->line, v->w->pos, v->w->text->data);
 
-                ds = calloc(1, sizeof(dn_status_t));
+                ds = arena_calloc(1, sizeof(dn_status_t));
                 if (!ds) {
                     vector_free(dn_pointers);
                     return -ENOMEM;
@@ -50,7 +50,7 @@ int __optimize_common_expr(basic_block_t *bb, function_t *f) {
     if (!roots)
         return -ENOMEM;
 
-    ret = basic_block_dag(bb, &bb->dag_list_head);
+    ret = basic_block_dag(bb, &bb->dag_list_head, &bb->dag_cons);
     if (ret < 0)
         goto error;
 
@@ -99,6 +99,7 @@ static int _optimize_common_expr(ast_t *ast, function_t *f, vector_t *functions)
         bb = list_data(l, basic_block_t, list);
 
         if (bb->jmp_flag
+            || bb->jmp_table_flag
             || bb->end_flag
             || bb->call_flag
             || bb->dump_flag
@@ -18,12 +18,15 @@ static int _optimize_dag(ast_t *ast, function_t *f, vector_t *functions) {
 
         bb->index = f->nb_basic_blocks++;
 
-        int ret = basic_block_dag(bb, &f->dag_list_head);
+        int ret = basic_block_dag(bb, &f->dag_list_head, &f->dag_cons);
         if (ret < 0) {
             loge("\n");
             return ret;
         }
 
+        // 新建的 DAG 节点接着编号
+        dag_index_new_nodes(&f->dag_list_head);
+
         ret = basic_block_vars(bb, bb_list_head);
         if (ret < 0) {
             loge("\n");
@@ -0,0 +1,1011 @@
+#include "optimizer.h"
+#include "utils_hash.h"
+
+// 死代码删除(DCE)和死存储删除(DSE)。
+// 按变量在整个函数的控制流图上做逆向活跃分析，结果之后不会再被读到的纯计算、读内存和标量赋值直接删掉，
+// 内联之后形参的拷贝大多就是这样的死代码。
+// 同一个基本块里 *p、a[i]、p->x 被后面同一地址的存储覆盖，中间又没有读到它，前面的存储也删掉。
+// 地址被取过的、是指针别名目标的变量，以及全局变量、结构体和数组一律当作活跃，
+// 中间读内存的三地址码只有在 dn_pointer_aliases 证明两边指向的变量不相交时才不打断存储的覆盖。
+// 内联之后(还没有 DAG)和循环优化之后各执行一次，后一次还要维护基本块的 dn_updateds、dn_saves 和 dn_resaves
+
+typedef struct {
+    function_t *f;
+
+    hash_t taken;  // 取过地址或者是指针别名目标的变量
+    hash_t pinned; // 循环的 pre 要加载、posts 要保存的变量，以及跨基本块重新加载的临时变量，定义不能删
+    hash_t ins;    // basic_block_t -> 入口活跃的变量
+
+    vector_t *pending; // 基本块里后面的、还没有被读到的存储
+    vector_t *t0;
+    vector_t *t1;
+} dce_t;
+
+static uint32_t _dce_hash(const void *p) {
+    return (uint32_t)(((uintptr_t)p >> 4) * 2654435761u);
+}
+
+static variable_t *_operand_var(mc_3ac_operand_t *operand) {
+    if (!operand)
+        return NULL;
+
+    if (operand->dag_node)
+        return operand->dag_node->var;
+
+    if (operand->node)
+        return _mc_operand_get(operand->node);
+    return NULL;
+}
+
+// 还没有 DAG 时看抽象语法树的节点
+static int _operand_type(mc_3ac_operand_t *operand) {
+    if (operand->dag_node)
+        return operand->dag_node->type;
+
+    if (operand->node)
+        return operand->node->type;
+    return -1;
+}
+
+// 只能被本函数的三地址码直接读写的标量，活跃分析只跟踪它们
+static int _dce_tracked(dce_t *d, variable_t *v) {
+    if (!v)
+        return 0;
+
+    if (!v->local_flag && !v->tmp_flag && !v->arg_flag)
+        return 0;
+
+    if (v->global_flag || v->static_flag || v->extern_flag || v->member_flag)
+        return 0;
+
+    if (v->const_literal_flag || v->vla_flag || v->auto_gc_flag)
+        return 0;
+
+    if (v->nb_dimentions > 0 || variable_is_struct(v))
+        return 0;
+
+    return !hash_find(&d->taken, v, _dce_hash(v));
+}
+
+static int _dce_add_unique(hash_t *h, variable_t *v) {
+    if (!v || hash_find(h, v, _dce_hash(v)))
+        return 0;
+
+    return hash_add(h, v, _dce_hash(v), v);
+}
+
+static int _dce_add_dns(hash_t *h, vector_t *dns, int tmp_only) {
+    dag_node_t *dn;
+    int i;
+
+    if (!dns)
+        return 0;
+
+    for (i = 0; i < dns->size; i++) {
+        dn = dns->data[i];
+
+        if (!dn->var || (tmp_only && !dn->var->tmp_flag))
+            continue;
+
+        int ret = _dce_add_unique(h, dn->var);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// 左值是内存的赋值，*p、a[i]、p->x 和结构体成员
+static int _dce_lvalue_type(int type) {
+    switch (type) {
+    case OP_DEREFERENCE:
+    case OP_ARRAY_INDEX:
+    case OP_POINTER:
+    case OP_DOT:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+// 给变量赋值，目标也是源操作数的赋值先读后写
+static int _dce_assign(mc_3ac_code_t *c) {
+    return OP_ASSIGN == c->op->type || (c->op->type >= OP_ADD_ASSIGN && c->op->type <= OP_OR_ASSIGN);
+}
+
+static int _dce_store(mc_3ac_code_t *c) {
+    switch (c->op->type) {
+    case OP_3AC_ASSIGN_DEREFERENCE:
+        return c->srcs && 2 == c->srcs->size;
+    case OP_3AC_ASSIGN_ARRAY_INDEX:
+        return c->srcs && 4 == c->srcs->size;
+    case OP_3AC_ASSIGN_POINTER:
+        return c->srcs && 3 == c->srcs->size;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int _dce_load(mc_3ac_code_t *c) {
+    switch (c->op->type) {
+    case OP_DEREFERENCE:
+    case OP_ARRAY_INDEX:
+    case OP_POINTER:
+        return c->srcs && c->srcs->size > 0;
+    default:
+        break;
+    }
+    return 0;
+}
+
+// 结果只写到目标变量里的计算，除了读内存的都不碰内存
+static int _dce_pure(mc_3ac_code_t *c) {
+    switch (c->op->type) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_DIV:
+    case OP_MOD:
+    case OP_NEG:
+    case OP_POSITIVE:
+    case OP_SHL:
+    case OP_SHR:
+    case OP_BIT_AND:
+    case OP_BIT_OR:
+    case OP_BIT_NOT:
+    case OP_BIT_XOR:
+    case OP_LOGIC_NOT:
+    case OP_EQ:
+    case OP_NE:
+    case OP_LT:
+    case OP_GT:
+    case OP_LE:
+    case OP_GE:
+    case OP_TYPE_CAST:
+    case OP_ADDRESS_OF:
+    case OP_3AC_LEA:
+    case OP_3AC_ADDRESS_OF_ARRAY_INDEX:
+    case OP_3AC_ADDRESS_OF_POINTER:
+        return 1;
+    default:
+        break;
+    }
+    return _dce_load(c);
+}
+
+static int _dce_src_updated(mc_3ac_code_t *c) {
+    switch (c->op->type) {
+    case OP_INC:
+    case OP_DEC:
+    case OP_INC_POST:
+    case OP_DEC_POST:
+    case OP_3AC_INC:
+    case OP_3AC_DEC:
+    case OP_3AC_POP:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+// 赋值的目标是内存时，这条三地址码不定义变量
+static int _dce_assign_memory(mc_3ac_code_t *c) {
+    if (!_dce_assign(c) || !c->dsts || c->dsts->size < 1)
+        return 0;
+
+    mc_3ac_operand_t *dst = c->dsts->data[0];
+
+    return _dce_lvalue_type(_operand_type(dst));
+}
+
+// 可以删掉的三地址码定义的变量，不能删时返回 NULL
+static variable_t *_dce_removable(mc_3ac_code_t *c) {
+    mc_3ac_operand_t *operand;
+    variable_t *v;
+
+    if (OP_3AC_INC == c->op->type || OP_3AC_DEC == c->op->type) {
+        if (c->dsts || !c->srcs || 1 != c->srcs->size)
+            return NULL;
+
+        operand = c->srcs->data[0];
+        v = _operand_var(operand);
+
+        // 指针的自增、自减要维护指针别名
+        if (!v || !type_is_var(_operand_type(operand)) || v->nb_pointers > 0)
+            return NULL;
+        return v;
+    }
+
+    if (!c->dsts || 1 != c->dsts->size)
+        return NULL;
+
+    operand = c->dsts->data[0];
+
+    if (_dce_assign(c)) {
+        if (!type_is_var(_operand_type(operand)))
+            return NULL;
+
+    } else if (!_dce_pure(c))
+        return NULL;
+
+    return _operand_var(operand);
+}
+
+static int _dce_add_tree_dn(dce_t *d, vector_t *live, dag_node_t *dn) {
+    int i;
+
+    if (_dce_tracked(d, dn->var)) {
+        int ret = vector_add_unique(live, dn->var);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (dn->childs) {
+        for (i = 0; i < dn->childs->size; i++) {
+            int ret = _dce_add_tree_dn(d, live, dn->childs->data[i]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+static int _dce_add_tree_node(dce_t *d, vector_t *live, node_t *node) {
+    variable_t *v = _mc_operand_get(node);
+    int i;
+
+    if (_dce_tracked(d, v)) {
+        int ret = vector_add_unique(live, v);
+        if (ret < 0)
+            return ret;
+    }
+
+    for (i = 0; i < node->nb_nodes; i++) {
+        int ret = _dce_add_tree_node(d, live, node->nodes[i]);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// 从后往前经过一条三地址码：先去掉它定义的变量，再加上它用到的变量
+static int _dce_transfer(dce_t *d, mc_3ac_code_t *c, vector_t *live) {
+    mc_3ac_operand_t *operand;
+    variable_t *v;
+
+    int memory = _dce_assign_memory(c);
+    int ret;
+    int i;
+
+    if (c->dsts && !memory && !(c->op->type >= OP_ADD_ASSIGN && c->op->type <= OP_OR_ASSIGN)) {
+        for (i = 0; i < c->dsts->size; i++) {
+            v = _operand_var(c->dsts->data[i]);
+            if (v)
+                vector_del(live, v);
+        }
+    }
+
+    if (c->dsts) {
+        for (i = 0; i < c->dsts->size; i++) {
+            operand = c->dsts->data[i];
+
+            if (memory) {
+                if (operand->dag_node)
+                    ret = _dce_add_tree_dn(d, live, operand->dag_node);
+                else if (operand->node)
+                    ret = _dce_add_tree_node(d, live, operand->node);
+                else
+                    ret = 0;
+
+            } else if (c->op->type >= OP_ADD_ASSIGN && c->op->type <= OP_OR_ASSIGN) {
+                v = _operand_var(operand);
+
+                ret = _dce_tracked(d, v) ? vector_add_unique(live, v) : 0;
+            } else
+                ret = 0;
+
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    if (c->srcs) {
+        for (i = 0; i < c->srcs->size; i++) {
+            v = _operand_var(c->srcs->data[i]);
+
+            if (_dce_tracked(d, v)) {
+                ret = vector_add_unique(live, v);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int _dce_defines(mc_3ac_code_t *c, variable_t *v) {
+    int i;
+
+    if (c->dsts && !_dce_assign_memory(c)) {
+        for (i = 0; i < c->dsts->size; i++) {
+            if (_operand_var(c->dsts->data[i]) == v)
+                return 1;
+        }
+    }
+
+    if (c->srcs && _dce_src_updated(c)) {
+        for (i = 0; i < c->srcs->size; i++) {
+            if (_operand_var(c->srcs->data[i]) == v)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// 取地址的变量和指针别名的目标，它们可能被别的三地址码通过指针读写
+static int _dce_find_taken(dce_t *d) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    dn_status_t *ds;
+    list_t *h = &d->f->basic_block_list_head;
+    list_t *l1;
+    list_t *l2;
+
+    int ret = 0;
+    int i;
+
+    for (l1 = list_head(h); l1 != list_sentinel(h); l1 = list_next(l1)) {
+        bb = list_data(l1, basic_block_t, list);
+
+        for (i = 0; bb->dn_pointer_aliases && i < bb->dn_pointer_aliases->size; i++) {
+            ds = bb->dn_pointer_aliases->data[i];
+
+            if (ds->alias) {
+                ret = _dce_add_unique(&d->taken, ds->alias->var);
+                if (ret < 0)
+                    return ret;
+            }
+        }
+
+        ret = _dce_add_dns(&d->taken, bb->entry_dn_aliases, 0);
+        if (ret < 0)
+            return ret;
+
+        ret = _dce_add_dns(&d->taken, bb->exit_dn_aliases, 0);
+        if (ret < 0)
+            return ret;
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (!c->srcs || 0 == c->srcs->size)
+                continue;
+
+            switch (c->op->type) {
+            case OP_3AC_ADDRESS_OF_ARRAY_INDEX:
+                ret = _dce_add_unique(&d->taken, _operand_var(c->srcs->data[0]));
+                break;
+
+            case OP_ADDRESS_OF:
+            case OP_3AC_LEA:
+            case OP_3AC_ADDRESS_OF_POINTER:
+                for (i = 0; i < c->srcs->size; i++) {
+                    ret = _dce_add_unique(&d->taken, _operand_var(c->srcs->data[i]));
+                    if (ret < 0)
+                        break;
+                }
+                break;
+            default:
+                break;
+            }
+
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+// 循环优化之后 pre 的 dn_loads 让外提的值在整个循环里保持活跃，posts 的 dn_saves 要把循环里的值写回去，
+// 跨基本块重新加载的临时变量在内存里要有值，这些变量的定义都留着
+static int _dce_find_pinned(dce_t *d) {
+    basic_block_t *bb;
+    bb_group_t *loop;
+    list_t *h = &d->f->basic_block_list_head;
+    list_t *l;
+
+    int ret;
+    int i;
+    int j;
+
+    for (i = 0; d->f->bb_loops && i < d->f->bb_loops->size; i++) {
+        loop = d->f->bb_loops->data[i];
+
+        if (!loop->pre)
+            continue;
+
+        ret = _dce_add_dns(&d->pinned, loop->pre->dn_loads, 0);
+        if (ret < 0)
+            return ret;
+
+        for (j = 0; loop->posts && j < loop->posts->size; j++) {
+            bb = loop->posts->data[j];
+
+            ret = _dce_add_dns(&d->pinned, bb->dn_saves, 0);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        ret = _dce_add_dns(&d->pinned, bb->dn_loads, 1);
+        if (ret < 0)
+            return ret;
+
+        ret = _dce_add_dns(&d->pinned, bb->dn_reloads, 1);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static vector_t *_dce_in(dce_t *d, basic_block_t *bb) {
+    return hash_find(&d->ins, bb, _dce_hash(bb));
+}
+
+// 出口活跃的变量是后继入口活跃变量的并集
+static int _dce_out(dce_t *d, basic_block_t *bb, vector_t *live) {
+    basic_block_t *next;
+    vector_t *in;
+
+    int i;
+    int j;
+
+    vector_clear(live, NULL);
+
+    for (i = 0; i < bb->nexts->size; i++) {
+        next = bb->nexts->data[i];
+
+        in = _dce_in(d, next);
+        if (!in)
+            continue;
+
+        for (j = 0; j < in->size; j++) {
+            int ret = vector_add_unique(live, in->data[j]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+static void _dce_free_ins(dce_t *d) {
+    list_t *h = &d->f->basic_block_list_head;
+    list_t *l;
+
+    for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+        basic_block_t *bb = list_data(l, basic_block_t, list);
+
+        vector_t *in = _dce_in(d, bb);
+        if (in)
+            vector_free(in);
+    }
+
+    hash_clear(&d->ins);
+}
+
+// 入口活跃变量只会变多，集合大小不变时到达不动点
+static int _dce_liveness(dce_t *d) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    vector_t *live;
+    vector_t *in;
+    list_t *h = &d->f->basic_block_list_head;
+    list_t *l;
+    list_t *l2;
+
+    int changed;
+    int ret;
+    int n;
+    int i;
+
+    _dce_free_ins(d);
+
+    for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        in = vector_alloc();
+        if (!in)
+            return -ENOMEM;
+
+        ret = hash_add(&d->ins, bb, _dce_hash(bb), in);
+        if (ret < 0) {
+            vector_free(in);
+            return ret;
+        }
+    }
+
+    live = vector_alloc();
+    if (!live)
+        return -ENOMEM;
+
+    do {
+        changed = 0;
+
+        for (l = list_tail(h); l != list_sentinel(h); l = list_prev(l)) {
+            bb = list_data(l, basic_block_t, list);
+
+            ret = _dce_out(d, bb, live);
+            if (ret < 0)
+                goto end;
+
+            for (l2 = list_tail(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_prev(l2)) {
+                c = list_data(l2, mc_3ac_code_t, list);
+
+                ret = _dce_transfer(d, c, live);
+                if (ret < 0)
+                    goto end;
+            }
+
+            in = _dce_in(d, bb);
+            n = in->size;
+
+            for (i = 0; i < live->size; i++) {
+                ret = vector_add_unique(in, live->data[i]);
+                if (ret < 0)
+                    goto end;
+            }
+
+            if (in->size != n)
+                changed = 1;
+        }
+    } while (changed);
+
+    ret = 0;
+end:
+    vector_free(live);
+    return ret;
+}
+
+// 读写内存的三地址码可能访问的变量放到 t 里，不确定时返回 0
+static int _dce_targets(basic_block_t *bb, mc_3ac_code_t *c, vector_t *t) {
+    dn_status_t *ds;
+    variable_t *v;
+
+    int found = 0;
+    int ret;
+    int i;
+
+    vector_clear(t, NULL);
+
+    v = _operand_var(c->srcs->data[0]);
+    if (!v)
+        return 0;
+
+    if (v->nb_dimentions > 0 && !v->member_flag
+        && (OP_ARRAY_INDEX == c->op->type || OP_3AC_ASSIGN_ARRAY_INDEX == c->op->type)) {
+        ret = vector_add(t, v);
+        return ret < 0 ? ret : 1;
+    }
+
+    if (0 == v->nb_pointers || !bb->dn_pointer_aliases)
+        return 0;
+
+    for (i = 0; i < bb->dn_pointer_aliases->size; i++) {
+        ds = bb->dn_pointer_aliases->data[i];
+
+        if (!ds->dag_node || ds->dag_node->var != v)
+            continue;
+
+        if (DN_ALIAS_VAR != ds->alias_type && DN_ALIAS_ARRAY != ds->alias_type)
+            return 0;
+
+        if (!ds->alias || !ds->alias->var || !type_is_var(ds->alias->type))
+            return 0;
+
+        ret = vector_add_unique(t, ds->alias->var);
+        if (ret < 0)
+            return ret;
+        found = 1;
+    }
+
+    return found;
+}
+
+static int _dce_disjoint(vector_t *t0, vector_t *t1) {
+    int i;
+
+    for (i = 0; i < t0->size; i++) {
+        if (vector_find(t1, t0->data[i]))
+            return 0;
+    }
+    return 1;
+}
+
+// 读内存时去掉可能读到的存储，known 为 0 时 d->t0 不确定
+static int _dce_read(dce_t *d, basic_block_t *bb, int known) {
+    mc_3ac_code_t *c;
+    int i;
+
+    for (i = d->pending->size - 1; i >= 0; i--) {
+        c = d->pending->data[i];
+
+        if (known) {
+            int ret = _dce_targets(bb, c, d->t1);
+            if (ret < 0)
+                return ret;
+
+            if (ret > 0 && _dce_disjoint(d->t0, d->t1))
+                continue;
+        }
+
+        vector_del(d->pending, c);
+    }
+    return 0;
+}
+
+// 不跟踪的变量在内存里，直接读写它们也可能读到前面通过指针的存储
+static int _dce_read_operands(dce_t *d, basic_block_t *bb, vector_t *operands) {
+    variable_t *v;
+    int i;
+
+    if (!operands)
+        return 0;
+
+    for (i = 0; i < operands->size && d->pending->size > 0; i++) {
+        v = _operand_var(operands->data[i]);
+
+        if (!v || _dce_tracked(d, v) || variable_const(v))
+            continue;
+
+        vector_clear(d->t0, NULL);
+
+        int ret = vector_add(d->t0, v);
+        if (ret < 0)
+            return ret;
+
+        ret = _dce_read(d, bb, 1);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// 只读写变量、不读内存的三地址码
+static int _dce_no_memory(mc_3ac_code_t *c) {
+    if (_dce_store(c) || _dce_load(c) || _dce_assign_memory(c))
+        return 0;
+
+    if (_dce_pure(c) || _dce_assign(c))
+        return 1;
+
+    switch (c->op->type) {
+    case OP_3AC_INC:
+    case OP_3AC_DEC:
+    case OP_3AC_CMP:
+    case OP_3AC_TEQ:
+    case OP_GOTO:
+        return 1;
+    default:
+        break;
+    }
+    return type_is_jmp(c->op->type) || type_is_setcc(c->op->type);
+}
+
+static int _dce_same_var(variable_t *v0, variable_t *v1) {
+    if (v0 == v1)
+        return 1;
+
+    if (!v0 || !v1 || !variable_const_integer(v0) || !variable_const_integer(v1))
+        return 0;
+
+    if (v0->size != v1->size)
+        return 0;
+
+    if (v0->size <= 4)
+        return v0->data.i == v1->data.i;
+    return v0->data.i64 == v1->data.i64;
+}
+
+// 两个存储的地址操作数相同，最后一个源操作数是存进去的值
+static int _dce_same_address(mc_3ac_code_t *c0, mc_3ac_code_t *c1) {
+    int i;
+
+    if (c0->op->type != c1->op->type || c0->srcs->size != c1->srcs->size)
+        return 0;
+
+    for (i = 0; i < c0->srcs->size - 1; i++) {
+        if (!_dce_same_var(_operand_var(c0->srcs->data[i]), _operand_var(c1->srcs->data[i])))
+            return 0;
+    }
+    return 1;
+}
+
+static int _dce_uses_address(mc_3ac_code_t *store, variable_t *v) {
+    int i;
+
+    for (i = 0; i < store->srcs->size - 1; i++) {
+        if (_operand_var(store->srcs->data[i]) == v)
+            return 1;
+    }
+    return 0;
+}
+
+// 改写了地址操作数，前面的存储和后面的不是同一个地址
+static void _dce_kill_addresses(dce_t *d, mc_3ac_code_t *c) {
+    mc_3ac_code_t *store;
+    variable_t *v;
+
+    vector_t *operands[2] = {_dce_assign_memory(c) ? NULL : c->dsts, _dce_src_updated(c) ? c->srcs : NULL};
+
+    int i;
+    int j;
+    int k;
+
+    for (k = 0; k < 2; k++) {
+        if (!operands[k])
+            continue;
+
+        for (i = 0; i < operands[k]->size; i++) {
+            v = _operand_var(operands[k]->data[i]);
+            if (!v)
+                continue;
+
+            for (j = d->pending->size - 1; j >= 0; j--) {
+                store = d->pending->data[j];
+
+                if (_dce_uses_address(store, v))
+                    vector_del(d->pending, store);
+            }
+        }
+    }
+}
+
+// 从后往前，存储进 pending，同一地址前面的存储在读到之前被覆盖就删掉
+static int _dce_stores_bb(dce_t *d, basic_block_t *bb, int *pcount) {
+    mc_3ac_code_t *c;
+    list_t *l;
+
+    int ret;
+    int i;
+
+    vector_clear(d->pending, NULL);
+
+    for (l = list_tail(&bb->code_list_head); l != list_sentinel(&bb->code_list_head);) {
+        c = list_data(l, mc_3ac_code_t, list);
+        l = list_prev(l);
+
+        if (_dce_store(c)) {
+            for (i = 0; i < d->pending->size; i++) {
+                if (_dce_same_address(c, d->pending->data[i]))
+                    break;
+            }
+
+            if (i < d->pending->size) {
+                list_del(&c->list);
+                mc_3ac_code_free(c);
+
+                (*pcount)++;
+                continue;
+            }
+
+            ret = _dce_read_operands(d, bb, c->srcs);
+            if (ret < 0)
+                return ret;
+
+            ret = vector_add(d->pending, c);
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+
+        if (0 == d->pending->size)
+            continue;
+
+        _dce_kill_addresses(d, c);
+
+        if (_dce_load(c)) {
+            ret = _dce_targets(bb, c, d->t0);
+            if (ret < 0)
+                return ret;
+
+            ret = _dce_read(d, bb, ret);
+
+        } else if (_dce_no_memory(c)) {
+            ret = _dce_read_operands(d, bb, c->srcs);
+            if (ret < 0)
+                return ret;
+
+            ret = _dce_read_operands(d, bb, c->dsts);
+        } else {
+            vector_clear(d->pending, NULL);
+            ret = 0;
+        }
+
+        if (ret < 0)
+            return ret;
+    }
+
+    vector_clear(d->pending, NULL);
+    return 0;
+}
+
+static void _dce_del_dns(vector_t *dns, variable_t *v) {
+    dag_node_t *dn;
+    int i;
+
+    if (!dns)
+        return;
+
+    for (i = dns->size - 1; i >= 0; i--) {
+        dn = dns->data[i];
+
+        if (dn->var == v)
+            vector_del(dns, dn);
+    }
+}
+
+// 基本块里已经没有 v 的定义，不用再保存它
+static void _dce_fix_bb(basic_block_t *bb, variable_t *v) {
+    mc_3ac_code_t *c;
+    list_t *l;
+
+    for (l = list_head(&bb->code_list_head); l != list_sentinel(&bb->code_list_head); l = list_next(l)) {
+        c = list_data(l, mc_3ac_code_t, list);
+
+        if (_dce_defines(c, v))
+            return;
+    }
+
+    _dce_del_dns(bb->dn_updateds, v);
+    _dce_del_dns(bb->dn_saves, v);
+    _dce_del_dns(bb->dn_resaves, v);
+}
+
+static int _dce_codes_bb(dce_t *d, basic_block_t *bb, vector_t *live, int *pcount) {
+    mc_3ac_code_t *c;
+    variable_t *v;
+    list_t *l;
+
+    int ret = _dce_out(d, bb, live);
+    if (ret < 0)
+        return ret;
+
+    for (l = list_tail(&bb->code_list_head); l != list_sentinel(&bb->code_list_head);) {
+        c = list_data(l, mc_3ac_code_t, list);
+        l = list_prev(l);
+
+        v = _dce_removable(c);
+
+        if (_dce_tracked(d, v)
+            && !vector_find(live, v)
+            && !hash_find(&d->pinned, v, _dce_hash(v))) {
+            list_del(&c->list);
+            mc_3ac_code_free(c);
+
+            _dce_fix_bb(bb, v);
+
+            (*pcount)++;
+            continue;
+        }
+
+        ret = _dce_transfer(d, c, live);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int _dce_codes(dce_t *d, int *pcount) {
+    basic_block_t *bb;
+    vector_t *live;
+    list_t *h = &d->f->basic_block_list_head;
+    list_t *l;
+
+    int n;
+
+    live = vector_alloc();
+    if (!live)
+        return -ENOMEM;
+
+    // 删掉的代码用到的变量可能也死了，删到没有可删的为止
+    do {
+        n = *pcount;
+
+        int ret = _dce_liveness(d);
+        if (ret < 0) {
+            vector_free(live);
+            return ret;
+        }
+
+        for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+            bb = list_data(l, basic_block_t, list);
+
+            ret = _dce_codes_bb(d, bb, live, pcount);
+            if (ret < 0) {
+                vector_free(live);
+                return ret;
+            }
+        }
+    } while (n != *pcount);
+
+    vector_free(live);
+    return 0;
+}
+
+static int _optimize_dce(ast_t *ast, function_t *f, vector_t *functions) {
+    if (!f)
+        return -EINVAL;
+
+    if (list_empty(&f->basic_block_list_head))
+        return 0;
+
+    dce_t d = {0};
+    basic_block_t *bb;
+    list_t *l;
+
+    int nb_stores = 0;
+    int nb_codes = 0;
+    int ret = -ENOMEM;
+
+    d.f = f;
+
+    d.pending = vector_alloc();
+    d.t0 = vector_alloc();
+    d.t1 = vector_alloc();
+    if (!d.pending || !d.t0 || !d.t1)
+        goto end;
+
+    ret = _dce_find_taken(&d);
+    if (ret < 0)
+        goto end;
+
+    ret = _dce_find_pinned(&d);
+    if (ret < 0)
+        goto end;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        ret = _dce_stores_bb(&d, bb, &nb_stores);
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = _dce_codes(&d, &nb_codes);
+    if (ret < 0)
+        goto end;
+
+    logd("%s(), dead stores: %d, dead codes: %d\n", f->node.w->text->data, nb_stores, nb_codes);
+
+end:
+    _dce_free_ins(&d);
+
+    hash_clear(&d.taken);
+    hash_clear(&d.pinned);
+
+    if (d.pending)
+        vector_free(d.pending);
+    if (d.t0)
+        vector_free(d.t0);
+    if (d.t1)
+        vector_free(d.t1);
+    return ret;
+}
+
+optimizer_t optimizer_dce =
+    {
+        .name = "dce",
+
+        .optimize = _optimize_dce,
+
+        .flags = OPTIMIZER_LOCAL,
+};
@@ -75,6 +75,10 @@ static int _optimize_generate_loads_saves(ast_t *ast, function_t *f, vector_t *f
             if (vector_find(bb->dn_reloads, dn))
                 continue;
 
+            // 外提到循环 pre 里的临时变量由 pre 里的代码定义，放在 dn_loads 里只是为了在整个循环里保持活跃
+            if (dn->var->tmp_flag)
+                continue;
+
             OPTIMIZER_LOAD(OP_3AC_LOAD, &bb->code_list_head);
         }
 
@@ -89,7 +93,7 @@ static int _optimize_generate_loads_saves(ast_t *ast, function_t *f, vector_t *f
             else {
                 OPTIMIZER_SAVE(OP_3AC_SAVE, &bb->code_list_head);
 
-                if (bb->cmp_flag) {
+                if (bb->cmp_flag || bb->jmp_table_flag) {
                     list_del(&save->list);
                     list_add_front(&bb->code_list_head, &save->list);
                 }
@@ -105,7 +109,7 @@ static int _optimize_generate_loads_saves(ast_t *ast, function_t *f, vector_t *f
             dn = bb->dn_resaves->data[i];
             OPTIMIZER_SAVE(OP_3AC_RESAVE, &bb->code_list_head);
 
-            if (bb->cmp_flag && !vector_find(bb->dn_updateds, dn)) {
+            if ((bb->cmp_flag || bb->jmp_table_flag) && !vector_find(bb->dn_updateds, dn)) {
                 list_del(&save->list);
                 list_add_front(&bb->code_list_head, &save->list);
             }
@@ -240,6 +244,17 @@ static int _optimize_generate_loads_saves(ast_t *ast, function_t *f, vector_t *f
         dst->bb->jmp_dst_flag = 1;
     }
 
+    for (i = 0; i < f->jmp_tables->size; i++) {
+        c = f->jmp_tables->data[i];
+
+        int j;
+        for (j = 0; j < c->jmp_table->targets->size; j++) {
+            _3ac_operand_t *dst = c->jmp_table->targets->data[j];
+
+            dst->bb->jmp_dst_flag = 1;
+        }
+    }
+
     return 0;
 }
 
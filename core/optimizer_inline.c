@@ -1,4 +1,5 @@
 #include "optimizer.h"
+#include "utils_hash.h"
 
 static int _arg_cmp(const void *p0, const void *p1) {
     node_t *n0 = (node_t *)p0;
@@ -342,7 +343,251 @@ static int _do_inline(ast_t *ast, _3ac_code_t *c, basic_block_t **pbb, function_
     return 0;
 }
 
-static int _optimize_inline2(ast_t *ast, function_t *f) {
+// 内联的代价模型：被调函数的大小按三地址码条数算，调用点的收益按执行次数估计，
+// 有插桩运行得到的调用点计数(f->call_counts，从 scf.prof 读进来)时用实际次数，没有时按调用点所在的循环层数估计。
+// 调用点按每条三地址码的收益从高到低选，整个程序增加的三地址码不超过内联前总数的 growth%
+#define INLINE_TINY       8   // 不比传参和调用本身多，总是内联
+#define INLINE_SIZE       24  // 没有 inline 标记的函数
+#define INLINE_SIZE_FLAG  120 // 有 inline 标记的函数
+#define INLINE_SIZE_HOT   240 // 热的调用点
+#define INLINE_HOT        64  // 计数不少于最大计数的 1/64 算热
+#define INLINE_COLD       4096 // 计数少于最大计数的 1/4096 算冷
+#define INLINE_LOOP_TRIPS 16  // 没有计数时每层循环估计的执行次数
+#define INLINE_GROWTH     30
+#define INLINE_BUDGET_MIN 256
+
+typedef struct {
+    mc_3ac_code_t *c;
+    int size;
+    double score;
+} inline_site_t;
+
+typedef struct {
+    uint64_t max_count;
+
+    hash_t approved;    // 选中内联的 OP_CALL
+    int budget;         // 还能增加的三地址码条数
+} inline_ctx_t;
+
+static uint32_t _inline_hash(const void *p) {
+    return (uint32_t)(((uintptr_t)p >> 4) * 2654435761u);
+}
+
+static int _inline_size(function_t *f) {
+    basic_block_t *bb;
+    list_t *l;
+    list_t *l2;
+
+    int n = 0;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2))
+            n++;
+    }
+    return n;
+}
+
+// 调用点的行号取函数指针常量的词，每个调用点各有一个，DAG 优化以后也不变，
+// 写 scf.prof 的 _parse_add_prof() 用同样的办法
+static int _inline_site_line(mc_3ac_code_t *c) {
+    mc_3ac_operand_t *src = c->srcs->data[0];
+    variable_t *v = _mc_operand_get(src->node);
+
+    return v && v->w ? v->w->line : 0;
+}
+
+static int _inline_loop_depth(mc_3ac_code_t *c) {
+    mc_3ac_operand_t *src = c->srcs->data[0];
+    node_t *node = src->node;
+
+    int depth = 0;
+
+    while (node && FUNCTION != node->type) {
+        if (OP_FOR == node->type || OP_WHILE == node->type || OP_DO == node->type)
+            depth++;
+
+        node = node->parent;
+    }
+    return depth;
+}
+
+static call_count_t *_inline_count(function_t *f, function_t *f2, int line) {
+    call_count_t *cc;
+    int i;
+
+    if (!f->call_counts)
+        return NULL;
+
+    for (i = 0; i < f->call_counts->size; i++) {
+        cc = f->call_counts->data[i];
+
+        if (cc->callee == f2 && cc->line == line)
+            return cc;
+    }
+    return NULL;
+}
+
+// 能内联的调用点，算出每条三地址码的收益，不值得内联时返回 0
+static int _inline_cost(inline_ctx_t *ctx, function_t *f, mc_3ac_code_t *c, inline_site_t *site) {
+    mc_3ac_operand_t *src = c->srcs->data[0];
+    variable_t *v = _mc_operand_get(src->node);
+    function_t *f2;
+    call_count_t *cc;
+
+    double freq;
+    int limit;
+
+    if (!v || !v->const_literal_flag)
+        return 0;
+
+    f2 = v->func_ptr;
+
+    if (!f2 || f2 == f || !f2->node.define_flag || f2->vargs_flag)
+        return 0;
+
+    // 查表跳转的目标按基本块登记在被调函数里，拷贝时不重建，这样的函数不内联
+    if (f2->jmp_tables->size > 0)
+        return 0;
+
+    if (c->srcs->size - 1 != f2->argv->size)
+        return 0;
+
+    site->c = c;
+    site->size = _inline_size(f2);
+
+    limit = f2->inline_flag ? INLINE_SIZE_FLAG : INLINE_SIZE;
+
+    cc = _inline_count(f, f2, _inline_site_line(c));
+    if (cc) {
+        if (cc->count * INLINE_HOT >= ctx->max_count)
+            limit = INLINE_SIZE_HOT;
+        else if (cc->count * INLINE_COLD < ctx->max_count)
+            limit = INLINE_TINY;
+
+        freq = (double)cc->count;
+    } else {
+        int depth = _inline_loop_depth(c);
+        int i;
+
+        if (depth > 4)
+            depth = 4;
+
+        freq = 1.0;
+        for (i = 0; i < depth; i++)
+            freq *= INLINE_LOOP_TRIPS;
+
+        // 循环里的调用点多给一些空间
+        limit += limit * (depth < 2 ? depth : 2) / 2;
+    }
+
+    if (site->size > limit && site->size > INLINE_TINY)
+        return 0;
+
+    site->score = freq / (site->size + 1);
+    return 1;
+}
+
+static int _inline_site_cmp(const void *p0, const void *p1) {
+    const inline_site_t *s0 = *(const inline_site_t **)p0;
+    const inline_site_t *s1 = *(const inline_site_t **)p1;
+
+    if (s0->score > s1->score)
+        return -1;
+    if (s0->score < s1->score)
+        return 1;
+    return s0->size - s1->size;
+}
+
+// 所有调用点按收益排序，在预算里从高往低选
+static int _inline_select(ast_t *ast, inline_ctx_t *ctx, vector_t *functions) {
+    basic_block_t *bb;
+    inline_site_t *site;
+    mc_3ac_code_t *c;
+    function_t *f;
+    vector_t *sites;
+    list_t *l;
+    list_t *l2;
+
+    int total = 0;
+    int ret = 0;
+    int i;
+
+    sites = vector_alloc();
+    if (!sites)
+        return -ENOMEM;
+
+    for (i = 0; i < functions->size; i++) {
+        f = functions->data[i];
+
+        if (!f->node.define_flag)
+            continue;
+
+        total += _inline_size(f);
+
+        for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+            bb = list_data(l, basic_block_t, list);
+
+            if (!bb->call_flag)
+                continue;
+
+            for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+                c = list_data(l2, mc_3ac_code_t, list);
+
+                if (OP_CALL != c->op->type)
+                    continue;
+
+                site = calloc(1, sizeof(inline_site_t));
+                if (!site) {
+                    ret = -ENOMEM;
+                    goto end;
+                }
+
+                if (!_inline_cost(ctx, f, c, site)) {
+                    free(site);
+                    continue;
+                }
+
+                ret = vector_add(sites, site);
+                if (ret < 0) {
+                    free(site);
+                    goto end;
+                }
+            }
+        }
+    }
+
+    int growth = ast->inline_growth > 0 ? ast->inline_growth : INLINE_GROWTH;
+
+    ctx->budget = total * growth / 100;
+    if (ctx->budget < INLINE_BUDGET_MIN)
+        ctx->budget = INLINE_BUDGET_MIN;
+
+    vector_qsort(sites, _inline_site_cmp);
+
+    int budget = ctx->budget;
+
+    for (i = 0; i < sites->size; i++) {
+        site = sites->data[i];
+
+        if (site->size - 1 > budget)
+            continue;
+        budget -= site->size - 1;
+
+        ret = hash_add(&ctx->approved, site->c, _inline_hash(site->c), site->c);
+        if (ret < 0)
+            goto end;
+    }
+
+    logd("sites: %d, approved: %d, codes: %d, budget: %d\n", sites->size, ctx->approved.size, total, ctx->budget);
+end:
+    vector_clear(sites, free);
+    vector_free(sites);
+    return ret;
+}
+
+static int _optimize_inline2(ast_t *ast, function_t *f, inline_ctx_t *ctx) {
     basic_block_t *bb;
     basic_block_t *bb_cur;
     basic_block_t *bb2;
@@ -382,25 +627,18 @@ static int _optimize_inline2(ast_t *ast, function_t *f) {
 
             n_calls++;
 
-            src = c->srcs->data[0];
-            v = _operand_get(src->node);
-
-            if (!v->const_literal_flag)
+            if (!hash_find(&ctx->approved, c, _inline_hash(c)))
                 continue;
 
+            src = c->srcs->data[0];
+            v = _operand_get(src->node);
             f2 = v->func_ptr;
 
-            if (!f2->node.define_flag)
-                continue;
-
-            if (!f2->inline_flag)
-                continue;
-
-            if (f2->vargs_flag)
-                continue;
-
-            if (f2->nb_basic_blocks > 10)
+            // 被调函数自己内联过别的函数后可能比选的时候大
+            int size = _inline_size(f2);
+            if (size - 1 > ctx->budget)
                 continue;
+            ctx->budget -= size - 1;
 #if 1
             bb2 = bb_cur;
             bb_cur->call_flag = 0;
@@ -438,16 +676,43 @@ static int _optimize_inline(ast_t *ast, function_t *f, vector_t *functions) {
     if (!ast || !functions)
         return -EINVAL;
 
+    // 插桩编译不内联，每个调用点都留在 scf.prof 里，用计数编译时才能逐个查到
+    if (ast->instrument)
+        return 0;
+
+    inline_ctx_t ctx = {0};
+
     int i;
+    int j;
+    for (i = 0; i < functions->size; i++) {
+        f = functions->data[i];
+
+        if (!f->call_counts)
+            continue;
+
+        for (j = 0; j < f->call_counts->size; j++) {
+            call_count_t *cc = f->call_counts->data[j];
+
+            if (ctx.max_count < cc->count)
+                ctx.max_count = cc->count;
+        }
+    }
+
+    int ret = _inline_select(ast, &ctx, functions);
+    if (ret < 0)
+        goto end;
+
     for (i = 0; i < functions->size; i++) {
-        int ret = _optimize_inline2(ast, functions->data[i]);
+        ret = _optimize_inline2(ast, functions->data[i], &ctx);
         if (ret < 0) {
             loge("\n");
-            return ret;
+            goto end;
         }
     }
 
-    return 0;
+end:
+    hash_clear(&ctx.approved);
+    return ret;
 }
 
 optimizer_t optimizer_inline =
@@ -0,0 +1,73 @@
+#include "optimizer.h"
+
+/*
+ * 插桩编译: 在每个基本块的开头插入一条 OP_3AC_COUNT，后端把它翻译成对计数器数组第 bb->index 项的 +1
+ *
+ * 计数器数组是每个函数一个的全局变量 f->prof_counters，长度为 f->nb_basic_blocks，
+ * parse_write_elf() 把所有函数的计数器放进单独的 scf_prof 段，运行时在退出前把这个段原样写到文件里，
+ * 所以计数按 (函数名, 基本块 index) 对应，index 和 generate_loads_saves 给基本块的编号一致
+ *
+ * 只跳过跳转块: 它们只有一条跳转，前面比较指令的标志位要一直保持到这里，不能在中间插入加法
+ */
+
+static int _optimize_instrument(ast_t *ast, function_t *f, vector_t *functions) {
+    if (!ast || !f)
+        return -EINVAL;
+
+    if (!ast->instrument)
+        return 0;
+
+    list_t *bb_list_head = &f->basic_block_list_head;
+    list_t *l;
+
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    dag_node_t *dn;
+    variable_t *v;
+    type_t *t = NULL;
+
+    if (list_empty(bb_list_head))
+        return 0;
+
+    int ret = ast_find_type_type(&t, ast, VAR_U64);
+    if (ret < 0)
+        return ret;
+
+    v = VAR_ALLOC_BY_TYPE(f->node.w, t, 0, 0, NULL);
+    if (!v)
+        return -ENOMEM;
+    v->global_flag = 1;
+
+    dn = dag_node_alloc(v->type, v, NULL);
+    variable_free(v);
+    v = NULL;
+    if (!dn)
+        return -ENOMEM;
+    list_add_tail(&f->dag_list_head, &dn->list);
+
+    for (l = list_head(bb_list_head); l != list_sentinel(bb_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        if (bb->jmp_flag)
+            continue;
+
+        c = mc_3ac_alloc_by_src(OP_3AC_COUNT, dn);
+        if (!c)
+            return -ENOMEM;
+
+        c->basic_block = bb;
+        list_add_front(&bb->code_list_head, &c->list);
+    }
+
+    f->prof_counters = dn->var;
+    return 0;
+}
+
+optimizer_t optimizer_instrument =
+    {
+        .name = "instrument",
+
+        .optimize = _optimize_instrument,
+
+        .flags = OPTIMIZER_LOCAL,
+};
@@ -0,0 +1,880 @@
+#include "optimizer.h"
+#include "utils_hash.h"
+
+// 循环不变量外提(LICM)：源操作数在循环里都不变的纯计算移到循环的 pre 块，每次进入循环只算一次。
+// 归纳变量的强度削弱：循环里随基本归纳变量 i 线性变化的 t = i * k、t = &a[i]，
+// 在 pre 里算出初值，i 每次改变的地方跟着给 t 加上步长，循环里的乘法变成加法，数组下标变成指针递增。
+// 只处理地址没有被取过的局部标量，它们只能被本函数里的三地址码直接改写。
+// 外提到 pre 的值通过 pre 的 dn_loads 在整个循环里保持活跃，和循环里的变量一起分配寄存器
+
+typedef struct {
+    function_t *f;
+    bb_group_t *loop;
+
+    hash_t taken;   // 取过地址的变量
+    hash_t fdefs;   // variable_t -> 定义它的三地址码，整个函数
+    hash_t defs;    // variable_t -> 定义它的三地址码，只含还在循环里的
+    hash_t outside; // 循环外用到的变量
+} licm_t;
+
+static uint32_t _licm_hash(const void *p) {
+    return (uint32_t)(((uintptr_t)p >> 4) * 2654435761u);
+}
+
+static variable_t *_operand_var(mc_3ac_operand_t *operand) {
+    if (!operand || !operand->dag_node)
+        return NULL;
+    return operand->dag_node->var;
+}
+
+static int _licm_count(hash_t *h, variable_t *v) {
+    int pos = -1;
+    int n = 0;
+
+    while (hash_next(h, v, _licm_hash(v), &pos))
+        n++;
+    return n;
+}
+
+static int _licm_add_unique(hash_t *h, variable_t *v) {
+    if (!v || hash_find(h, v, _licm_hash(v)))
+        return 0;
+
+    return hash_add(h, v, _licm_hash(v), v);
+}
+
+static int _licm_add_operands(hash_t *h, vector_t *operands) {
+    int i;
+
+    if (!operands)
+        return 0;
+
+    for (i = 0; i < operands->size; i++) {
+        int ret = _licm_add_unique(h, _operand_var(operands->data[i]));
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// 自增、自减和出栈直接改写源操作数
+static int _licm_src_updated(mc_3ac_code_t *c) {
+    switch (c->op->type) {
+    case OP_INC:
+    case OP_DEC:
+    case OP_INC_POST:
+    case OP_DEC_POST:
+    case OP_3AC_INC:
+    case OP_3AC_DEC:
+    case OP_3AC_POP:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int _licm_add_defs(hash_t *h, mc_3ac_code_t *c) {
+    variable_t *v;
+    int ret;
+    int i;
+
+    if (c->dsts) {
+        for (i = 0; i < c->dsts->size; i++) {
+            v = _operand_var(c->dsts->data[i]);
+            if (!v)
+                continue;
+
+            ret = hash_add(h, v, _licm_hash(v), c);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    if (c->srcs && _licm_src_updated(c)) {
+        for (i = 0; i < c->srcs->size; i++) {
+            v = _operand_var(c->srcs->data[i]);
+            if (!v)
+                continue;
+
+            ret = hash_add(h, v, _licm_hash(v), c);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int _licm_code_uses(mc_3ac_code_t *c, variable_t *v) {
+    int i;
+
+    if (c->srcs) {
+        for (i = 0; i < c->srcs->size; i++) {
+            if (_operand_var(c->srcs->data[i]) == v)
+                return 1;
+        }
+    }
+
+    if (c->dsts) {
+        for (i = 0; i < c->dsts->size; i++) {
+            if (_operand_var(c->dsts->data[i]) == v)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// &a[i] 只取基址数组的地址，下标和元素大小只是用到它们的值
+static int _licm_find_taken(licm_t *l) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *h = &l->f->basic_block_list_head;
+    list_t *l1;
+    list_t *l2;
+
+    for (l1 = list_head(h); l1 != list_sentinel(h); l1 = list_next(l1)) {
+        bb = list_data(l1, basic_block_t, list);
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            int ret = _licm_add_defs(&l->fdefs, c);
+            if (ret < 0)
+                return ret;
+
+            if (!c->srcs || 0 == c->srcs->size)
+                continue;
+
+            switch (c->op->type) {
+            case OP_3AC_ADDRESS_OF_ARRAY_INDEX:
+                ret = _licm_add_unique(&l->taken, _operand_var(c->srcs->data[0]));
+                break;
+
+            case OP_ADDRESS_OF:
+            case OP_3AC_LEA:
+            case OP_3AC_ADDRESS_OF_POINTER:
+                ret = _licm_add_operands(&l->taken, c->srcs);
+                break;
+            default:
+                break;
+            }
+
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+// 循环里的定义和循环外的使用，循环的块用 visit_flag 标记
+static int _licm_loop_init(licm_t *l, bb_group_t *loop) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *h = &l->f->basic_block_list_head;
+    list_t *l1;
+    list_t *l2;
+
+    int ret;
+    int i;
+
+    hash_clear(&l->defs);
+    hash_clear(&l->outside);
+
+    l->loop = loop;
+
+    basic_block_visit_flag(h, 0);
+
+    for (i = 0; i < loop->body->size; i++) {
+        bb = loop->body->data[i];
+        bb->visit_flag = 1;
+    }
+
+    for (l1 = list_head(h); l1 != list_sentinel(h); l1 = list_next(l1)) {
+        bb = list_data(l1, basic_block_t, list);
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (bb->visit_flag) {
+                ret = _licm_add_defs(&l->defs, c);
+            } else {
+                ret = _licm_add_operands(&l->outside, c->srcs);
+                if (ret < 0)
+                    return ret;
+
+                ret = _licm_add_operands(&l->outside, c->dsts);
+            }
+
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+// 循环里没有被改写的值，数组名的值是它的地址
+static int _licm_invariant(licm_t *l, mc_3ac_operand_t *operand) {
+    variable_t *v = _operand_var(operand);
+    if (!v)
+        return 0;
+
+    // 有名字的 const 变量也可能在循环里初始化
+    if (variable_const(v))
+        return 0 == _licm_count(&l->defs, v);
+
+    if (v->member_flag || v->vla_flag)
+        return 0;
+
+    if (v->nb_dimentions > 0)
+        return 0 == _licm_count(&l->defs, v);
+
+    if (v->global_flag || v->static_flag || v->extern_flag)
+        return 0;
+
+    if (!v->local_flag && !v->tmp_flag && !v->arg_flag)
+        return 0;
+
+    if (variable_is_struct(v) || hash_find(&l->taken, v, _licm_hash(v)))
+        return 0;
+
+    return 0 == _licm_count(&l->defs, v);
+}
+
+// 外提的值只在循环里有一个定义，循环外不用，否则移动定义会改变循环外看到的值
+static int _licm_dst_movable(licm_t *l, variable_t *v) {
+    if (!v->local_flag && !v->tmp_flag)
+        return 0;
+
+    if (v->global_flag || v->static_flag || v->extern_flag || v->member_flag || v->arg_flag)
+        return 0;
+
+    if (v->const_flag || v->const_literal_flag || v->vla_flag || v->auto_gc_flag)
+        return 0;
+
+    if (hash_find(&l->taken, v, _licm_hash(v)) || hash_find(&l->outside, v, _licm_hash(v)))
+        return 0;
+
+    return 1 == _licm_count(&l->fdefs, v);
+}
+
+// 不会出异常的纯计算，执行路径上原来没有它也可以提前算
+static int _licm_pure(mc_3ac_code_t *c) {
+    if (!c->dsts || 1 != c->dsts->size || !c->srcs)
+        return 0;
+
+    switch (c->op->type) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_SHL:
+    case OP_SHR:
+    case OP_BIT_AND:
+    case OP_BIT_OR:
+    case OP_BIT_XOR:
+        return 2 == c->srcs->size;
+
+    case OP_NEG:
+    case OP_BIT_NOT:
+    case OP_TYPE_CAST:
+    case OP_ASSIGN:
+        return 1 == c->srcs->size;
+
+    case OP_3AC_ADDRESS_OF_ARRAY_INDEX:
+        return 3 == c->srcs->size;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static int _licm_can_hoist(licm_t *l, mc_3ac_code_t *c) {
+    if (!_licm_pure(c))
+        return 0;
+
+    variable_t *v = _operand_var(c->dsts->data[0]);
+    if (!v)
+        return 0;
+
+    if (!variable_integer(v) || variable_float(v) || v->nb_dimentions > 0 || variable_is_struct(v))
+        return 0;
+
+    if (!_licm_dst_movable(l, v))
+        return 0;
+
+    int i;
+    for (i = 0; i < c->srcs->size; i++) {
+        mc_3ac_operand_t *src = c->srcs->data[i];
+        variable_t *vs = _operand_var(src);
+
+        if (!vs || variable_float(vs))
+            return 0;
+
+        if (!_licm_invariant(l, src))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int _licm_used_in_loop(licm_t *l, variable_t *v) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *l2;
+
+    int i;
+    for (i = 0; i < l->loop->body->size; i++) {
+        bb = l->loop->body->data[i];
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (_licm_code_uses(c, v))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// pre 里的代码用到的循环外的值要在 pre 里加载，临时变量重新加载
+static int _licm_pre_srcs(licm_t *l, mc_3ac_code_t *c) {
+    basic_block_t *pre = l->loop->pre;
+    mc_3ac_operand_t *src;
+    mc_3ac_code_t *def;
+    dag_node_t *dn;
+    variable_t *v;
+
+    int ret;
+    int i;
+
+    for (i = 0; i < c->srcs->size; i++) {
+        src = c->srcs->data[i];
+        dn = src->dag_node;
+        v = dn->var;
+
+        if (variable_const(v) || v->nb_dimentions > 0 || !dn_through_bb(dn))
+            continue;
+
+        def = hash_find(&l->fdefs, v, _licm_hash(v));
+        if (def && def->basic_block == pre && 1 == _licm_count(&l->fdefs, v))
+            continue;
+
+        if (v->tmp_flag)
+            ret = vector_add_unique(pre->dn_reloads, dn);
+        else
+            ret = vector_add_unique(pre->dn_loads, dn);
+        if (ret < 0)
+            return ret;
+
+        ret = vector_add_unique(pre->entry_dn_actives, dn);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+// dst 改由 pre 定义：pre 里写回内存，循环里用的话放进 pre 的 dn_loads 在整个循环里保持活跃，
+// 原来所在的块不再定义它
+static int _licm_pre_dst(licm_t *l, dag_node_t *dn, basic_block_t *from) {
+    basic_block_t *pre = l->loop->pre;
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *l2;
+
+    int ret;
+    int i;
+
+    if (from) {
+        vector_del(from->dn_saves, dn);
+        vector_del(from->dn_resaves, dn);
+        vector_del(from->dn_updateds, dn);
+    }
+
+    ret = vector_add_unique(pre->dn_resaves, dn);
+    if (ret < 0)
+        return ret;
+
+    ret = vector_add_unique(pre->dn_updateds, dn);
+    if (ret < 0)
+        return ret;
+
+    ret = vector_add_unique(pre->exit_dn_actives, dn);
+    if (ret < 0)
+        return ret;
+
+    if (!_licm_used_in_loop(l, dn->var))
+        return 0;
+
+    ret = vector_add_unique(pre->dn_loads, dn);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < l->loop->body->size; i++) {
+        bb = l->loop->body->data[i];
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (c->dsts && c->dsts->size > 0 && _operand_var(c->dsts->data[0]) == dn->var)
+                break;
+
+            if (!_licm_code_uses(c, dn->var))
+                continue;
+
+            vector_del(bb->dn_reloads, dn);
+
+            ret = vector_add_unique(bb->entry_dn_actives, dn);
+            if (ret < 0)
+                return ret;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void _licm_move_to_pre(licm_t *l, mc_3ac_code_t *c) {
+    basic_block_t *pre = l->loop->pre;
+
+    list_del(&c->list);
+    list_add_tail(&pre->code_list_head, &c->list);
+    c->basic_block = pre;
+}
+
+static int _licm_hoist(licm_t *l, int *pcount) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    variable_t *v;
+    list_t *l2;
+
+    int changed;
+    int ret;
+    int i;
+
+    do {
+        changed = 0;
+
+        for (i = 0; i < l->loop->body->size; i++) {
+            bb = l->loop->body->data[i];
+
+            for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head);) {
+                c = list_data(l2, mc_3ac_code_t, list);
+                l2 = list_next(l2);
+
+                if (!_licm_can_hoist(l, c))
+                    continue;
+
+                v = _operand_var(c->dsts->data[0]);
+
+                _licm_move_to_pre(l, c);
+
+                hash_del(&l->defs, v, _licm_hash(v), c);
+
+                ret = _licm_pre_srcs(l, c);
+                if (ret < 0)
+                    return ret;
+
+                ret = _licm_pre_dst(l, ((mc_3ac_operand_t *)c->dsts->data[0])->dag_node, bb);
+                if (ret < 0)
+                    return ret;
+
+                (*pcount)++;
+                changed = 1;
+            }
+        }
+    } while (changed);
+
+    return 0;
+}
+
+static int64_t _licm_const_value(variable_t *v) {
+    if (variable_size(v) > 4)
+        return v->data.i64;
+    return v->data.i;
+}
+
+// 循环里唯一的定义是 i += c、i -= c、++i、--i 的整型变量，返回这个定义和步长
+static mc_3ac_code_t *_licm_basic_iv(licm_t *l, variable_t *v, int64_t *pstep) {
+    if (!type_is_integer(v->type) || v->nb_pointers > 0 || v->nb_dimentions > 0)
+        return NULL;
+
+    if (v->tmp_flag || (!v->local_flag && !v->arg_flag))
+        return NULL;
+
+    if (v->global_flag || v->static_flag || v->extern_flag || v->member_flag || v->const_flag)
+        return NULL;
+
+    if (hash_find(&l->taken, v, _licm_hash(v)) || 1 != _licm_count(&l->defs, v))
+        return NULL;
+
+    mc_3ac_code_t *u = hash_find(&l->defs, v, _licm_hash(v));
+    variable_t *vc;
+
+    switch (u->op->type) {
+    case OP_3AC_INC:
+    case OP_3AC_DEC:
+        if (!u->srcs || 1 != u->srcs->size || _operand_var(u->srcs->data[0]) != v)
+            return NULL;
+
+        *pstep = OP_3AC_INC == u->op->type ? 1 : -1;
+        return u;
+
+    case OP_ADD_ASSIGN:
+    case OP_SUB_ASSIGN:
+        if (!u->dsts || 1 != u->dsts->size || _operand_var(u->dsts->data[0]) != v)
+            return NULL;
+
+        if (!u->srcs || 1 != u->srcs->size)
+            return NULL;
+
+        vc = _operand_var(u->srcs->data[0]);
+        if (!vc || !variable_const_integer(vc))
+            return NULL;
+
+        *pstep = _licm_const_value(vc);
+        if (OP_SUB_ASSIGN == u->op->type)
+            *pstep = -*pstep;
+        return u;
+    default:
+        break;
+    }
+
+    return NULL;
+}
+
+// 结果是地址的下标运算：&a[i]，多维数组和结构体数组的 a[i]
+static int _licm_index_address(mc_3ac_code_t *c) {
+    if (!c->dsts || 1 != c->dsts->size || !c->srcs || 3 != c->srcs->size)
+        return 0;
+
+    if (OP_3AC_ADDRESS_OF_ARRAY_INDEX == c->op->type)
+        return 1;
+
+    if (OP_ARRAY_INDEX != c->op->type)
+        return 0;
+
+    variable_t *vb = _operand_var(c->srcs->data[0]);
+
+    return vb && (vb->nb_dimentions > 1 || (vb->type >= STRUCT && 0 == vb->nb_pointers));
+}
+
+// t 随 i 线性变化：t = i * k 或者 t = &base[i]，返回 i 的下标，k 的下标放在 *pk
+static int _licm_derived_iv(licm_t *l, mc_3ac_code_t *c, int *pk) {
+    variable_t *v;
+    int i;
+
+    if (_licm_index_address(c)) {
+        if (!_licm_invariant(l, c->srcs->data[0]))
+            return -1;
+
+        v = _operand_var(c->srcs->data[2]);
+        if (!v || !variable_const_integer(v))
+            return -1;
+
+        *pk = 2;
+        return 1;
+    }
+
+    if (OP_MUL != c->op->type || !c->dsts || 1 != c->dsts->size || !c->srcs || 2 != c->srcs->size)
+        return -1;
+
+    v = _operand_var(c->dsts->data[0]);
+    if (!v || !type_is_integer(v->type) || v->nb_pointers > 0 || v->nb_dimentions > 0)
+        return -1;
+
+    for (i = 0; i < 2; i++) {
+        variable_t *vk = _operand_var(c->srcs->data[1 - i]);
+
+        if (vk && variable_const_integer(vk) && variable_size(vk) == variable_size(v)) {
+            *pk = 1 - i;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// t 只在 m 所在的块里、m 之后用到，中间没有改 i，这样在 i 改变的地方同步更新 t 不会改变用到的值
+static int _licm_uses_follow(licm_t *l, mc_3ac_code_t *m, mc_3ac_code_t *u, variable_t *t) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *l2;
+
+    int seen = 0;
+    int updated = 0;
+    int i;
+
+    for (i = 0; i < l->loop->body->size; i++) {
+        bb = l->loop->body->data[i];
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (c == m) {
+                seen = 1;
+                continue;
+            }
+
+            if (c == u && seen) {
+                updated = 1;
+                continue;
+            }
+
+            if (!_licm_code_uses(c, t))
+                continue;
+
+            if (bb != m->basic_block || !seen || updated)
+                return 0;
+        }
+
+        if (bb == m->basic_block)
+            seen = 0;
+    }
+
+    return 1;
+}
+
+// 步长 step * k 的常量，类型和 k 相同
+static int _licm_step_const(dag_node_t **pdn, licm_t *l, variable_t *vk, int64_t step) {
+    int64_t k = _licm_const_value(vk);
+    int64_t d;
+
+    *pdn = NULL;
+
+    if (__builtin_mul_overflow(step, k, &d))
+        return 0;
+
+    if (variable_size(vk) <= 4 && (d < INT32_MIN || d > INT32_MAX))
+        return 0;
+
+    variable_t *v = variable_clone(vk);
+    if (!v)
+        return -ENOMEM;
+
+    if (variable_size(v) > 4)
+        v->data.i64 = d;
+    else
+        v->data.i = (int32_t)d;
+
+    dag_node_t *dn = dag_node_alloc(v->type, v, NULL);
+    variable_free(v);
+    v = NULL;
+    if (!dn)
+        return -ENOMEM;
+
+    list_add_tail(&l->f->dag_list_head, &dn->list);
+
+    *pdn = dn;
+    return 0;
+}
+
+static int _licm_strength_reduce(licm_t *l, mc_3ac_code_t *m, int *pcount) {
+    mc_3ac_operand_t *src;
+    mc_3ac_code_t *u;
+    mc_3ac_code_t *a;
+    dag_node_t *dn_step;
+    dag_node_t *dn;
+    variable_t *vi;
+    variable_t *vk;
+    variable_t *t;
+
+    int64_t step;
+    int k;
+
+    int i = _licm_derived_iv(l, m, &k);
+    if (i < 0)
+        return 0;
+
+    dn = ((mc_3ac_operand_t *)m->dsts->data[0])->dag_node;
+    t = dn->var;
+    vi = _operand_var(m->srcs->data[i]);
+    vk = _operand_var(m->srcs->data[k]);
+
+    if (!vi || (!t->tmp_flag && !t->local_flag))
+        return 0;
+
+    if (t->global_flag || t->static_flag || t->extern_flag || t->member_flag || t->arg_flag || t->vla_flag)
+        return 0;
+
+    if (hash_find(&l->taken, t, _licm_hash(t)) || hash_find(&l->outside, t, _licm_hash(t)))
+        return 0;
+
+    if (1 != _licm_count(&l->fdefs, t))
+        return 0;
+
+    u = _licm_basic_iv(l, vi, &step);
+    if (!u)
+        return 0;
+
+    // i 比 t 窄时，无符号的 i 回绕以后 t 就不等于 i * k 了，有符号的回绕本来就是未定义的
+    if (variable_size(vi) < variable_size(vk) && !variable_signed(vi))
+        return 0;
+
+    if (!_licm_uses_follow(l, m, u, t))
+        return 0;
+
+    int ret = _licm_step_const(&dn_step, l, vk, step);
+    if (ret < 0 || !dn_step)
+        return ret;
+
+    a = mc_3ac_alloc_by_dst(OP_ADD_ASSIGN, dn);
+    if (!a)
+        return -ENOMEM;
+
+    a->srcs = vector_alloc();
+    if (!a->srcs) {
+        mc_3ac_code_free(a);
+        return -ENOMEM;
+    }
+
+    src = mc_3ac_operand_alloc();
+    if (!src) {
+        mc_3ac_code_free(a);
+        return -ENOMEM;
+    }
+    src->dag_node = dn_step;
+
+    if (vector_add(a->srcs, src) < 0) {
+        mc_3ac_operand_free(src);
+        mc_3ac_code_free(a);
+        return -ENOMEM;
+    }
+
+    basic_block_t *bb = m->basic_block;
+    basic_block_t *bu = u->basic_block;
+
+    list_add_front(&u->list, &a->list);
+    a->basic_block = bu;
+
+    _licm_move_to_pre(l, m);
+
+    // t 现在由 pre 和循环里的 a 定义，不再是循环不变量
+    hash_del(&l->defs, t, _licm_hash(t), m);
+
+    ret = hash_add(&l->defs, t, _licm_hash(t), a);
+    if (ret < 0)
+        return ret;
+
+    ret = hash_add(&l->fdefs, t, _licm_hash(t), a);
+    if (ret < 0)
+        return ret;
+
+    ret = _licm_pre_srcs(l, m);
+    if (ret < 0)
+        return ret;
+
+    ret = _licm_pre_dst(l, dn, bb);
+    if (ret < 0)
+        return ret;
+
+    // t 在 i 改变的块里更新，写回内存，和 pre 里的初值一样
+    ret = vector_add_unique(bu->dn_resaves, dn);
+    if (ret < 0)
+        return ret;
+
+    ret = vector_add_unique(bu->dn_updateds, dn);
+    if (ret < 0)
+        return ret;
+
+    ret = vector_add_unique(bu->entry_dn_actives, dn);
+    if (ret < 0)
+        return ret;
+
+    ret = vector_add_unique(bu->exit_dn_actives, dn);
+    if (ret < 0)
+        return ret;
+
+    (*pcount)++;
+    return 0;
+}
+
+static int _licm_strength_reduce_loop(licm_t *l, int *pcount) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *l2;
+
+    int ret;
+    int i;
+
+    for (i = 0; i < l->loop->body->size; i++) {
+        bb = l->loop->body->data[i];
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head);) {
+            c = list_data(l2, mc_3ac_code_t, list);
+            l2 = list_next(l2);
+
+            ret = _licm_strength_reduce(l, c, pcount);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int _optimize_licm(ast_t *ast, function_t *f, vector_t *functions) {
+    if (!f)
+        return -EINVAL;
+
+    if (list_empty(&f->basic_block_list_head) || 0 == f->bb_loops->size)
+        return 0;
+
+    if (f->vla_flag)
+        return 0;
+
+    licm_t l = {0};
+    bb_group_t *loop;
+
+    int nb_hoisted = 0;
+    int nb_reduced = 0;
+    int ret;
+    int i;
+
+    l.f = f;
+
+    ret = _licm_find_taken(&l);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i < f->bb_loops->size; i++) {
+        loop = f->bb_loops->data[i];
+
+        if (!loop->pre)
+            continue;
+
+        ret = _licm_loop_init(&l, loop);
+        if (ret < 0)
+            goto end;
+
+        ret = _licm_hoist(&l, &nb_hoisted);
+        if (ret < 0)
+            goto end;
+
+        ret = _licm_strength_reduce_loop(&l, &nb_reduced);
+        if (ret < 0)
+            goto end;
+    }
+
+    logd("%s(), hoisted: %d, reduced: %d\n", f->node.w->text->data, nb_hoisted, nb_reduced);
+
+end:
+    basic_block_visit_flag(&f->basic_block_list_head, 0);
+
+    hash_clear(&l.taken);
+    hash_clear(&l.fdefs);
+    hash_clear(&l.defs);
+    hash_clear(&l.outside);
+    return ret;
+}
+
+optimizer_t optimizer_licm =
+    {
+        .name = "licm",
+
+        .optimize = _optimize_licm,
+
+        .flags = OPTIMIZER_LOCAL,
+};
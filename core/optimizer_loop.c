@@ -87,6 +87,20 @@ static int _loop_index_cmp(const void *p0, const void *p1) {
     return 0;
 }
 
+// 查表跳转块做循环入口时 pre 没地方放: pre 放在入口后面靠顺序执行进循环，查表跳转不会顺序执行
+static int _bbg_jmp_table_entry(bb_group_t *bbg) {
+    basic_block_t *bb;
+    int i;
+
+    for (i = 0; i < bbg->entries->size; i++) {
+        bb = bbg->entries->data[i];
+
+        if (bb->jmp_table_flag)
+            return 1;
+    }
+    return 0;
+}
+
 static int _bb_dfs_loop(list_t *bb_list_head, vector_t *loops) {
     if (!bb_list_head || !loops)
         return -EINVAL;
@@ -108,22 +122,16 @@ static int _bb_dfs_loop(list_t *bb_list_head, vector_t *loops) {
             continue;
 
         int ret;
+        int i;
 
-        int i = 0;
-        int j = 0;
-        while (i < bb->nexts->size && j < bb->dominators->size) {
-            basic_block_t *next = bb->nexts->data[i];
-            basic_block_t *dom = bb->dominators->data[j];
+        // bb -> next 是回边当且仅当 next 支配 bb，沿支配树往上查
+        for (i = 0; i < bb->nexts->size; i++) {
+            basic_block_t *dom = bb->nexts->data[i];
 
-            if (next->dfo < dom->dfo) {
-                ++i;
+            if (!basic_block_dominates(dom, bb))
                 continue;
-            }
 
-            if (next->dfo > dom->dfo) {
-                ++j;
-                continue;
-            }
+            bb->back_flag = 1;
 
             bb_group_t *bbg = bb_group_alloc();
             if (!bbg)
@@ -143,16 +151,16 @@ static int _bb_dfs_loop(list_t *bb_list_head, vector_t *loops) {
             }
             logd("bbg: %p, entries: %d, exits: %d\n", bbg, bbg->entries->size, bbg->exits->size);
 
+            if (_bbg_jmp_table_entry(bbg)) {
+                bb_group_free(bbg);
+                continue;
+            }
+
             ret = vector_add(loops, bbg);
             if (ret < 0) {
                 bb_group_free(bbg);
                 return ret;
             }
-
-            bb->back_flag = 1;
-
-            ++i;
-            ++j;
         }
     }
 
@@ -395,6 +403,31 @@ static int _bb_loop_layers(function_t *f) {
     return 0;
 }
 
+// 查表跳转的目标不在 jcc 块里，要改跳转表
+static void _bb_jmp_table_retarget(basic_block_t *bb, basic_block_t *from, basic_block_t *to) {
+    mc_3ac_operand_t *dst;
+    mc_3ac_code_t *c;
+    list_t *l;
+    int i;
+
+    if (!bb->jmp_table_flag)
+        return;
+
+    for (l = list_head(&bb->code_list_head); l != list_sentinel(&bb->code_list_head); l = list_next(l)) {
+        c = list_data(l, mc_3ac_code_t, list);
+
+        if (!c->jmp_table)
+            continue;
+
+        for (i = 0; i < c->jmp_table->targets->size; i++) {
+            dst = c->jmp_table->targets->data[i];
+
+            if (dst->bb == from)
+                dst->bb = to;
+        }
+    }
+}
+
 static int _bb_loop_add_pre_post(function_t *f) {
     bb_group_t *bbg;
     basic_block_t *bb;
@@ -572,6 +605,8 @@ static int _bb_loop_add_pre_post(function_t *f) {
                     if (dst->bb == exit)
                         dst->bb = post;
                 }
+
+                _bb_jmp_table_retarget(bb, exit, post);
             }
 
             bb->loop_flag = 1;
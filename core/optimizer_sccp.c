@@ -0,0 +1,1102 @@
+#include "optimizer.h"
+#include "utils_hash.h"
+
+// 稀疏条件常量传播(SCCP)：只沿着可能执行的边传播常量，基本块的入口相当于 SSA 的 phi，
+// 对所有可执行的前驱边取格的交，跳转条件确定以后只有一条出边可执行。
+// 中间表示不是 SSA，所以以变量为单位在每个基本块的入口、出口各记一份格值，
+// 只跟踪地址没有被取过的局部整型标量，它们只能被本函数里的三地址码直接改写
+
+#define SCCP_TOP    0 // 还没有见到定义
+#define SCCP_CONST  1
+#define SCCP_BOTTOM 2 // 不是常量
+
+typedef struct {
+    int state;
+    int64_t value;
+} sccp_value_t;
+
+// 最后一条 cmp / teq 设置的标志，jcc 和 setcc 据此求值，teq 的 b 是 0
+typedef struct {
+    int state;
+    int64_t a;
+    int64_t b;
+    int is_unsigned;
+} sccp_flags_t;
+
+typedef struct {
+    basic_block_t *bb;
+
+    sccp_value_t *in;
+    sccp_value_t *out;
+
+    vector_t *succs; // 可能执行的出边的目标块
+
+    uint32_t executable : 1;
+    uint32_t visited : 1;
+    uint32_t in_queue : 1;
+    uint32_t cfg_changed : 1; // 后面的跳转改过，出边要重新连接
+} sccp_bb_t;
+
+typedef struct {
+    function_t *f;
+
+    hash_t vars; // variable_t -> 下标 + 1
+    int nb_vars;
+
+    hash_t bbs; // basic_block_t -> sccp_bb_t
+    sccp_bb_t *bb_states;
+    int nb_bbs;
+
+    vector_t *queue;
+} sccp_t;
+
+static uint32_t _sccp_hash(const void *p) {
+    return (uint32_t)(((uintptr_t)p >> 4) * 2654435761u);
+}
+
+static sccp_bb_t *_sccp_bb(sccp_t *s, basic_block_t *bb) {
+    return hash_find(&s->bbs, bb, _sccp_hash(bb));
+}
+
+static int _sccp_var_trackable(variable_t *v) {
+    if (!type_is_integer(v->type) || v->nb_pointers > 0 || v->nb_dimentions > 0)
+        return 0;
+
+    if (v->const_flag || v->const_literal_flag)
+        return 0;
+
+    if (v->global_flag || v->static_flag || v->extern_flag || v->member_flag || v->arg_flag)
+        return 0;
+
+    if (!v->local_flag && !v->tmp_flag)
+        return 0;
+
+    int size = variable_size(v);
+
+    return 1 == size || 2 == size || 4 == size || 8 == size;
+}
+
+// 字面量和编译时算出来的常量，有名字的 const 变量可能用运行时的值初始化，不算
+static int _sccp_var_const(variable_t *v) {
+    if (!type_is_integer(v->type) || v->nb_pointers > 0 || v->nb_dimentions > 0)
+        return 0;
+
+    if (v->const_literal_flag)
+        return 1;
+
+    return v->const_flag && !v->w
+           && !v->local_flag && !v->tmp_flag && !v->arg_flag
+           && !v->global_flag && !v->static_flag && !v->extern_flag;
+}
+
+static int _sccp_var_index(sccp_t *s, variable_t *v) {
+    if (!v)
+        return -1;
+
+    intptr_t i = (intptr_t)hash_find(&s->vars, v, _sccp_hash(v));
+    return i - 1;
+}
+
+static variable_t *_operand_var(mc_3ac_operand_t *operand) {
+    if (!operand || !operand->dag_node)
+        return NULL;
+    return operand->dag_node->var;
+}
+
+static int _sccp_add_operands(sccp_t *s, vector_t *operands, hash_t *taken) {
+    variable_t *v;
+    int i;
+
+    if (!operands)
+        return 0;
+
+    for (i = 0; i < operands->size; i++) {
+        v = _operand_var(operands->data[i]);
+
+        if (!v || !_sccp_var_trackable(v))
+            continue;
+
+        if (hash_find(taken, v, _sccp_hash(v)) || _sccp_var_index(s, v) >= 0)
+            continue;
+
+        int ret = hash_add(&s->vars, v, _sccp_hash(v), (void *)(intptr_t)(++s->nb_vars));
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+// 给要跟踪的变量编号，取过地址的变量可能通过指针改写，不跟踪
+static int _sccp_find_vars(sccp_t *s) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    variable_t *v;
+    list_t *l;
+    list_t *l2;
+    hash_t taken;
+
+    int ret = 0;
+    int i;
+
+    hash_init(&taken);
+
+    for (l = list_head(&s->f->basic_block_list_head); l != list_sentinel(&s->f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (OP_ADDRESS_OF != c->op->type
+                && OP_3AC_LEA != c->op->type
+                && OP_3AC_ADDRESS_OF_ARRAY_INDEX != c->op->type
+                && OP_3AC_ADDRESS_OF_POINTER != c->op->type)
+                continue;
+
+            if (!c->srcs)
+                continue;
+
+            for (i = 0; i < c->srcs->size; i++) {
+                v = _operand_var(c->srcs->data[i]);
+
+                if (v && !hash_find(&taken, v, _sccp_hash(v))) {
+                    ret = hash_add(&taken, v, _sccp_hash(v), v);
+                    if (ret < 0)
+                        goto end;
+                }
+            }
+        }
+    }
+
+    for (l = list_head(&s->f->basic_block_list_head); l != list_sentinel(&s->f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            ret = _sccp_add_operands(s, c->dsts, &taken);
+            if (ret < 0)
+                goto end;
+
+            ret = _sccp_add_operands(s, c->srcs, &taken);
+            if (ret < 0)
+                goto end;
+        }
+    }
+
+end:
+    hash_clear(&taken);
+    return ret;
+}
+
+// 把 x 截断到 v 的宽度，再按 v 的符号扩展到 64 位
+static int64_t _sccp_normalize(variable_t *v, int64_t x) {
+    int bits = variable_size(v) * 8;
+
+    if (bits >= 64)
+        return x;
+
+    if (type_is_unsigned(v->type))
+        return (int64_t)((uint64_t)x & ((1ULL << bits) - 1));
+
+    return (int64_t)((uint64_t)x << (64 - bits)) >> (64 - bits);
+}
+
+static sccp_value_t _sccp_eval(sccp_t *s, sccp_value_t *vals, mc_3ac_operand_t *operand) {
+    sccp_value_t r = {SCCP_BOTTOM, 0};
+
+    variable_t *v = _operand_var(operand);
+    if (!v)
+        return r;
+
+    if (_sccp_var_const(v)) {
+        r.state = SCCP_CONST;
+
+        if (variable_size(v) > 4)
+            r.value = v->data.i64;
+        else
+            r.value = _sccp_normalize(v, v->data.i);
+        return r;
+    }
+
+    int i = _sccp_var_index(s, v);
+    if (i >= 0)
+        r = vals[i];
+    return r;
+}
+
+static void _sccp_set(sccp_t *s, sccp_value_t *vals, mc_3ac_operand_t *operand, sccp_value_t r) {
+    variable_t *v = _operand_var(operand);
+
+    int i = _sccp_var_index(s, v);
+    if (i < 0)
+        return;
+
+    if (SCCP_CONST == r.state)
+        r.value = _sccp_normalize(v, r.value);
+    vals[i] = r;
+}
+
+static void _sccp_set_bottom(sccp_t *s, sccp_value_t *vals, vector_t *operands) {
+    sccp_value_t r = {SCCP_BOTTOM, 0};
+    int i;
+
+    if (operands) {
+        for (i = 0; i < operands->size; i++)
+            _sccp_set(s, vals, operands->data[i], r);
+    }
+}
+
+static int _sccp_meet(sccp_value_t *dst, const sccp_value_t *src) {
+    if (SCCP_TOP == src->state || SCCP_BOTTOM == dst->state)
+        return 0;
+
+    if (SCCP_TOP == dst->state) {
+        *dst = *src;
+        return 1;
+    }
+
+    if (SCCP_CONST == src->state && src->value == dst->value)
+        return 0;
+
+    dst->state = SCCP_BOTTOM;
+    return 1;
+}
+
+// 除 0、溢出、移位超出宽度等未定义的情况不折叠，返回 -1
+static int _sccp_calculate(int op_type, int64_t a, int64_t b, int is_unsigned, int64_t *pr) {
+    uint64_t ua = a;
+    uint64_t ub = b;
+
+    switch (op_type) {
+    case OP_ADD:
+    case OP_ADD_ASSIGN:
+        *pr = (int64_t)(ua + ub);
+        break;
+    case OP_SUB:
+    case OP_SUB_ASSIGN:
+        *pr = (int64_t)(ua - ub);
+        break;
+    case OP_MUL:
+    case OP_MUL_ASSIGN:
+        *pr = (int64_t)(ua * ub);
+        break;
+
+    case OP_DIV:
+    case OP_DIV_ASSIGN:
+    case OP_MOD:
+    case OP_MOD_ASSIGN:
+        if (0 == b)
+            return -1;
+
+        if (is_unsigned) {
+            if (OP_DIV == op_type || OP_DIV_ASSIGN == op_type)
+                *pr = (int64_t)(ua / ub);
+            else
+                *pr = (int64_t)(ua % ub);
+        } else {
+            if (INT64_MIN == a && -1 == b)
+                return -1;
+
+            if (OP_DIV == op_type || OP_DIV_ASSIGN == op_type)
+                *pr = a / b;
+            else
+                *pr = a % b;
+        }
+        break;
+
+    case OP_SHL:
+    case OP_SHL_ASSIGN:
+    case OP_SHR:
+    case OP_SHR_ASSIGN:
+        if (b < 0 || b >= 64)
+            return -1;
+
+        if (OP_SHL == op_type || OP_SHL_ASSIGN == op_type)
+            *pr = (int64_t)(ua << b);
+        else if (is_unsigned)
+            *pr = (int64_t)(ua >> b);
+        else
+            *pr = a >> b;
+        break;
+
+    case OP_BIT_AND:
+    case OP_AND_ASSIGN:
+        *pr = a & b;
+        break;
+    case OP_BIT_OR:
+    case OP_OR_ASSIGN:
+        *pr = a | b;
+        break;
+    case OP_BIT_XOR:
+        *pr = a ^ b;
+        break;
+
+    case OP_EQ:
+        *pr = a == b;
+        break;
+    case OP_NE:
+        *pr = a != b;
+        break;
+    case OP_LT:
+        *pr = is_unsigned ? ua < ub : a < b;
+        break;
+    case OP_GT:
+        *pr = is_unsigned ? ua > ub : a > b;
+        break;
+    case OP_LE:
+        *pr = is_unsigned ? ua <= ub : a <= b;
+        break;
+    case OP_GE:
+        *pr = is_unsigned ? ua >= ub : a >= b;
+        break;
+
+    default:
+        return -1;
+    }
+
+    return 0;
+}
+
+static int _sccp_binary_op(int op_type) {
+    switch (op_type) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_DIV:
+    case OP_MOD:
+    case OP_SHL:
+    case OP_SHR:
+    case OP_BIT_AND:
+    case OP_BIT_OR:
+    case OP_BIT_XOR:
+    case OP_EQ:
+    case OP_NE:
+    case OP_LT:
+    case OP_GT:
+    case OP_LE:
+    case OP_GE:
+        return 1;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static sccp_value_t _sccp_binary(int op_type, sccp_value_t a, sccp_value_t b, int is_unsigned) {
+    sccp_value_t r = {SCCP_BOTTOM, 0};
+
+    if (SCCP_BOTTOM == a.state || SCCP_BOTTOM == b.state)
+        return r;
+
+    if (SCCP_TOP == a.state || SCCP_TOP == b.state) {
+        r.state = SCCP_TOP;
+        return r;
+    }
+
+    if (_sccp_calculate(op_type, a.value, b.value, is_unsigned, &r.value) < 0)
+        return r;
+
+    r.state = SCCP_CONST;
+    return r;
+}
+
+static sccp_value_t _sccp_unary(int op_type, sccp_value_t a) {
+    if (SCCP_CONST != a.state)
+        return a;
+
+    switch (op_type) {
+    case OP_NEG:
+        a.value = (int64_t)(0 - (uint64_t)a.value);
+        break;
+    case OP_BIT_NOT:
+        a.value = ~a.value;
+        break;
+    case OP_LOGIC_NOT:
+        a.value = !a.value;
+        break;
+    default:
+        a.state = SCCP_BOTTOM;
+        break;
+    }
+    return a;
+}
+
+static int _sccp_operand_unsigned(mc_3ac_operand_t *operand) {
+    variable_t *v = _operand_var(operand);
+
+    return v && type_is_unsigned(v->type);
+}
+
+// cmp 按较宽的操作数比较，宽度相同时有一个无符号就按无符号比较
+static void _sccp_cmp(sccp_t *s, sccp_value_t *vals, mc_3ac_code_t *c, sccp_flags_t *flags) {
+    flags->state = SCCP_BOTTOM;
+
+    if (!c->srcs || c->srcs->size < 1 || c->srcs->size > 2)
+        return;
+
+    mc_3ac_operand_t *src0 = c->srcs->data[0];
+    mc_3ac_operand_t *src1 = c->srcs->size > 1 ? c->srcs->data[1] : NULL;
+
+    sccp_value_t a = _sccp_eval(s, vals, src0);
+    sccp_value_t b = {SCCP_CONST, 0};
+
+    if (src1)
+        b = _sccp_eval(s, vals, src1);
+
+    if (SCCP_CONST != a.state || SCCP_CONST != b.state)
+        return;
+
+    variable_t *v0 = _operand_var(src0);
+    variable_t *v1 = _operand_var(src1);
+
+    int size0 = variable_size(v0);
+    int size1 = v1 ? variable_size(v1) : 0;
+
+    flags->is_unsigned = 0;
+
+    if (size0 > size1)
+        flags->is_unsigned = type_is_unsigned(v0->type);
+    else if (size1 > size0)
+        flags->is_unsigned = type_is_unsigned(v1->type);
+    else
+        flags->is_unsigned = type_is_unsigned(v0->type) || type_is_unsigned(v1->type);
+
+    int size = size0 > size1 ? size0 : size1;
+
+    flags->a = a.value;
+    flags->b = b.value;
+
+    if (size < 8) {
+        uint64_t mask = (1ULL << (size * 8)) - 1;
+
+        if (flags->is_unsigned) {
+            flags->a &= mask;
+            flags->b &= mask;
+        }
+    }
+
+    flags->state = SCCP_CONST;
+}
+
+// jcc / setcc 的条件，确定时返回 0 或 1，否则返回 -1
+static int _sccp_cond(int op_type, const sccp_flags_t *flags) {
+    if (SCCP_CONST != flags->state)
+        return -1;
+
+    int64_t a = flags->a;
+    int64_t b = flags->b;
+
+    int is_unsigned = flags->is_unsigned;
+
+    switch (op_type) {
+    case OP_3AC_JZ:
+    case OP_3AC_SETZ:
+        return a == b;
+    case OP_3AC_JNZ:
+    case OP_3AC_SETNZ:
+        return a != b;
+    case OP_3AC_JGT:
+    case OP_3AC_SETGT:
+        return is_unsigned ? (uint64_t)a > (uint64_t)b : a > b;
+    case OP_3AC_JLT:
+    case OP_3AC_SETLT:
+        return is_unsigned ? (uint64_t)a < (uint64_t)b : a < b;
+    case OP_3AC_JGE:
+    case OP_3AC_SETGE:
+        return is_unsigned ? (uint64_t)a >= (uint64_t)b : a >= b;
+    case OP_3AC_JLE:
+    case OP_3AC_SETLE:
+        return is_unsigned ? (uint64_t)a <= (uint64_t)b : a <= b;
+    default:
+        break;
+    }
+
+    return -1;
+}
+
+// 从入口的格值算出口的格值，flags 是块里最后一条 cmp / teq 的结果
+static void _sccp_transfer(sccp_t *s, sccp_bb_t *sb, sccp_value_t *vals, sccp_flags_t *flags) {
+    mc_3ac_operand_t *dst;
+    mc_3ac_code_t *c;
+    sccp_value_t r;
+    list_t *l;
+
+    basic_block_t *bb = sb->bb;
+
+    flags->state = SCCP_BOTTOM;
+
+    for (l = list_head(&bb->code_list_head); l != list_sentinel(&bb->code_list_head); l = list_next(l)) {
+        c = list_data(l, mc_3ac_code_t, list);
+
+        int type = c->op->type;
+
+        dst = NULL;
+        if (c->dsts && 1 == c->dsts->size)
+            dst = c->dsts->data[0];
+
+        if (OP_3AC_CMP == type || OP_3AC_TEQ == type) {
+            _sccp_cmp(s, vals, c, flags);
+
+        } else if (type_is_setcc(type) && dst) {
+            int cond = _sccp_cond(type, flags);
+
+            r.state = cond < 0 ? SCCP_BOTTOM : SCCP_CONST;
+            r.value = cond;
+            _sccp_set(s, vals, dst, r);
+
+        } else if (OP_ASSIGN == type && dst && c->srcs && 1 == c->srcs->size) {
+            _sccp_set(s, vals, dst, _sccp_eval(s, vals, c->srcs->data[0]));
+
+        } else if (type_is_binary_assign(type) && dst && c->srcs && 1 == c->srcs->size) {
+            r = _sccp_binary(type, _sccp_eval(s, vals, dst), _sccp_eval(s, vals, c->srcs->data[0]),
+                             _sccp_operand_unsigned(dst));
+            _sccp_set(s, vals, dst, r);
+
+        } else if (_sccp_binary_op(type) && dst && c->srcs && 2 == c->srcs->size) {
+            r = _sccp_binary(type, _sccp_eval(s, vals, c->srcs->data[0]), _sccp_eval(s, vals, c->srcs->data[1]),
+                             OP_EQ <= type && type <= OP_GE ? _sccp_operand_unsigned(c->srcs->data[0]) : _sccp_operand_unsigned(dst));
+            _sccp_set(s, vals, dst, r);
+
+        } else if ((OP_NEG == type || OP_BIT_NOT == type || OP_LOGIC_NOT == type)
+                   && dst && c->srcs && 1 == c->srcs->size) {
+            _sccp_set(s, vals, dst, _sccp_unary(type, _sccp_eval(s, vals, c->srcs->data[0])));
+
+        } else if (OP_TYPE_CAST == type && dst && c->srcs && 1 == c->srcs->size) {
+            _sccp_set(s, vals, dst, _sccp_eval(s, vals, c->srcs->data[0]));
+
+        } else {
+            // 自增、自减和出栈、加载直接改写源操作数
+            if (OP_INC == type || OP_DEC == type
+                || OP_INC_POST == type || OP_DEC_POST == type
+                || OP_3AC_INC == type || OP_3AC_DEC == type
+                || OP_3AC_POP == type
+                || OP_3AC_LOAD == type || OP_3AC_RELOAD == type)
+                _sccp_set_bottom(s, vals, c->srcs);
+
+            _sccp_set_bottom(s, vals, c->dsts);
+        }
+    }
+}
+
+static mc_3ac_code_t *_bb_jmp(basic_block_t *bb) {
+    return list_data(list_head(&bb->code_list_head), mc_3ac_code_t, list);
+}
+
+static basic_block_t *_jmp_dst(mc_3ac_code_t *c) {
+    mc_3ac_operand_t *dst = c->dsts->data[0];
+    return dst->bb;
+}
+
+static int _sccp_add_succ(sccp_t *s, sccp_bb_t *sb, basic_block_t *bb2) {
+    if (!bb2 || !vector_find(sb->bb->nexts, bb2)) {
+        logd("bb: %p, unexpected edge to %p\n", sb->bb, bb2);
+        return -EINVAL;
+    }
+
+    if (vector_find(sb->succs, bb2))
+        return 0;
+
+    return vector_add(sb->succs, bb2);
+}
+
+// 按条件确定可能执行的出边，后面跟着跳转块时逐条求值，条件确定的 jcc 只走一边
+static int _sccp_succs(sccp_t *s, sccp_bb_t *sb, sccp_flags_t *flags) {
+    basic_block_t *bb = sb->bb;
+    basic_block_t *bb2;
+    mc_3ac_code_t *c;
+    list_t *l;
+    list_t *sentinel = list_sentinel(&s->f->basic_block_list_head);
+
+    int ret;
+    int i;
+
+    l = list_next(&bb->list);
+
+    if (l == sentinel || !list_data(l, basic_block_t, list)->jmp_flag) {
+        for (i = 0; i < bb->nexts->size; i++) {
+            ret = _sccp_add_succ(s, sb, bb->nexts->data[i]);
+            if (ret < 0)
+                return ret;
+        }
+        return 0;
+    }
+
+    for (; l != sentinel; l = list_next(l)) {
+        bb2 = list_data(l, basic_block_t, list);
+
+        if (!bb2->jmp_flag)
+            return _sccp_add_succ(s, sb, bb2);
+
+        c = _bb_jmp(bb2);
+
+        if (OP_GOTO == c->op->type)
+            return _sccp_add_succ(s, sb, _jmp_dst(c));
+
+        int cond = _sccp_cond(c->op->type, flags);
+
+        if (0 != cond) {
+            ret = _sccp_add_succ(s, sb, _jmp_dst(c));
+            if (ret < 0)
+                return ret;
+
+            if (1 == cond)
+                return 0;
+        }
+    }
+
+    return 0;
+}
+
+// 结构体里有填充，不能用 memcmp()
+static int _sccp_same(const sccp_value_t *a, const sccp_value_t *b, int n) {
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (a[i].state != b[i].state)
+            return 0;
+
+        if (SCCP_CONST == a[i].state && a[i].value != b[i].value)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int _sccp_push(sccp_t *s, basic_block_t *bb) {
+    sccp_bb_t *sb = _sccp_bb(s, bb);
+    assert(sb);
+
+    sb->executable = 1;
+
+    if (sb->in_queue)
+        return 0;
+
+    sb->in_queue = 1;
+    return vector_add(s->queue, sb);
+}
+
+static int _sccp_solve(sccp_t *s) {
+    sccp_flags_t flags;
+    basic_block_t *prev;
+    sccp_bb_t *sb;
+    sccp_bb_t *sb2;
+
+    size_t size = s->nb_vars * sizeof(sccp_value_t);
+
+    sccp_value_t *in = calloc(s->nb_vars + 1, sizeof(sccp_value_t));
+    if (!in)
+        return -ENOMEM;
+
+    int ret = _sccp_push(s, s->bb_states[0].bb);
+
+    while (ret >= 0 && s->queue->size > 0) {
+        sb = s->queue->data[--s->queue->size];
+        sb->in_queue = 0;
+
+        // 入口块之外，未定义的变量是 TOP，汇合处只看可执行的前驱边
+        memset(in, 0, size);
+
+        int i;
+        for (i = 0; i < sb->bb->prevs->size; i++) {
+            prev = sb->bb->prevs->data[i];
+            sb2 = _sccp_bb(s, prev);
+
+            if (!sb2 || !sb2->visited || !vector_find(sb2->succs, sb->bb))
+                continue;
+
+            int j;
+            for (j = 0; j < s->nb_vars; j++)
+                _sccp_meet(&in[j], &sb2->out[j]);
+        }
+
+        if (sb->visited && _sccp_same(in, sb->in, s->nb_vars))
+            continue;
+
+        memcpy(sb->in, in, size);
+        memcpy(sb->out, in, size);
+
+        _sccp_transfer(s, sb, sb->out, &flags);
+        sb->visited = 1;
+
+        ret = _sccp_succs(s, sb, &flags);
+        if (ret < 0)
+            break;
+
+        for (i = 0; i < sb->succs->size; i++) {
+            ret = _sccp_push(s, sb->succs->data[i]);
+            if (ret < 0)
+                break;
+        }
+    }
+
+    free(in);
+    return ret;
+}
+
+static void _sccp_del_bb(function_t *f, basic_block_t *bb) {
+    basic_block_t *bb2;
+
+    if (bb->jmp_flag)
+        assert(0 == vector_del(f->jmps, _bb_jmp(bb)));
+
+    if (bb->jmp_table_flag) // 查表跳转总在块的最后
+        assert(0 == vector_del(f->jmp_tables, list_data(list_tail(&bb->code_list_head), mc_3ac_code_t, list)));
+
+    while (bb->prevs->size > 0) {
+        bb2 = bb->prevs->data[0];
+
+        vector_del(bb2->nexts, bb);
+        vector_del(bb->prevs, bb2);
+    }
+
+    while (bb->nexts->size > 0) {
+        bb2 = bb->nexts->data[0];
+
+        vector_del(bb2->prevs, bb);
+        vector_del(bb->nexts, bb2);
+    }
+
+    list_del(&bb->list);
+    basic_block_free(bb);
+}
+
+// 条件确定的 jcc 改成 goto 或者删掉，一定执行的跳转后面的跳转块都删掉
+static int _sccp_fold_jmps(sccp_t *s, sccp_bb_t *sb) {
+    sccp_flags_t flags;
+    basic_block_t *bb2;
+    mc_3ac_code_t *c;
+    list_t *l;
+    list_t *sentinel = list_sentinel(&s->f->basic_block_list_head);
+
+    int taken = 0;
+    int nb_jcc = 0;
+
+    sccp_value_t *vals = calloc(s->nb_vars + 1, sizeof(sccp_value_t));
+    if (!vals)
+        return -ENOMEM;
+
+    memcpy(vals, sb->in, s->nb_vars * sizeof(sccp_value_t));
+
+    _sccp_transfer(s, sb, vals, &flags);
+    free(vals);
+
+    for (l = list_next(&sb->bb->list); l != sentinel;) {
+        bb2 = list_data(l, basic_block_t, list);
+        l = list_next(l);
+
+        if (!bb2->jmp_flag)
+            break;
+
+        c = _bb_jmp(bb2);
+
+        if (taken) {
+            _sccp_del_bb(s->f, bb2);
+            sb->cfg_changed = 1;
+            continue;
+        }
+
+        if (OP_GOTO == c->op->type) {
+            taken = 1;
+            continue;
+        }
+
+        int cond = _sccp_cond(c->op->type, &flags);
+
+        if (1 == cond) {
+            logd("bb: %p, %s always taken\n", sb->bb, c->op->name);
+
+            c->op = mc_3ac_find_operator(OP_GOTO);
+            bb2->jcc_flag = 0;
+
+            sb->cfg_changed = 1;
+            taken = 1;
+
+        } else if (0 == cond) {
+            logd("bb: %p, %s never taken\n", sb->bb, c->op->name);
+
+            _sccp_del_bb(s->f, bb2);
+            sb->cfg_changed = 1;
+        } else
+            nb_jcc++;
+    }
+
+    if (!sb->cfg_changed || nb_jcc > 0)
+        return 0;
+
+    // 没有 jcc 再用标志了，后面也没有 setcc 的 cmp / teq 可以删掉
+    for (l = list_tail(&sb->bb->code_list_head); l != list_sentinel(&sb->bb->code_list_head); l = list_prev(l)) {
+        c = list_data(l, mc_3ac_code_t, list);
+
+        if (type_is_setcc(c->op->type))
+            break;
+
+        if (OP_3AC_CMP == c->op->type || OP_3AC_TEQ == c->op->type) {
+            list_del(&c->list);
+            mc_3ac_code_free(c);
+            break;
+        }
+    }
+
+    sb->bb->cmp_flag = 0;
+
+    for (l = list_head(&sb->bb->code_list_head); l != list_sentinel(&sb->bb->code_list_head); l = list_next(l)) {
+        c = list_data(l, mc_3ac_code_t, list);
+
+        if (OP_3AC_CMP == c->op->type || OP_3AC_TEQ == c->op->type) {
+            sb->bb->cmp_flag = 1;
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// 跳转改过的块按剩下的跳转重新连接出边，和 3ac.c 里连接基本块的规则一样
+static int _sccp_reconnect(sccp_t *s, basic_block_t *bb) {
+    basic_block_t *bb2;
+    mc_3ac_code_t *c;
+    list_t *l;
+    list_t *sentinel = list_sentinel(&s->f->basic_block_list_head);
+
+    int ret;
+
+    while (bb->nexts->size > 0) {
+        bb2 = bb->nexts->data[0];
+
+        vector_del(bb2->prevs, bb);
+        vector_del(bb->nexts, bb2);
+    }
+
+    for (l = list_next(&bb->list); l != sentinel; l = list_next(l)) {
+        bb2 = list_data(l, basic_block_t, list);
+
+        if (!bb2->jmp_flag)
+            return basic_block_connect(bb, bb2);
+
+        c = _bb_jmp(bb2);
+
+        ret = basic_block_connect(bb, _jmp_dst(c));
+        if (ret < 0)
+            return ret;
+
+        if (!bb2->jcc_flag) {
+            // 只剩一条跳到紧接着的块的 goto，去掉跳转直接顺序执行
+            l = list_next(l);
+
+            if (l != sentinel && list_prev(&bb2->list) == &bb->list
+                && list_data(l, basic_block_t, list) == _jmp_dst(c)) {
+                assert(0 == vector_del(s->f->jmps, c));
+
+                list_del(&bb2->list);
+                basic_block_free(bb2);
+            }
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+static int _sccp_apply(sccp_t *s) {
+    basic_block_t *bb;
+    sccp_bb_t *sb;
+    sccp_bb_t *decision = NULL;
+    list_t *l;
+    list_t *bb_list_head = &s->f->basic_block_list_head;
+
+    int ret;
+    int i;
+
+    for (i = 0; i < s->nb_bbs; i++) {
+        sb = &s->bb_states[i];
+
+        if (!sb->executable || sb->bb->jmp_flag)
+            continue;
+
+        l = list_next(&sb->bb->list);
+        if (l == list_sentinel(bb_list_head) || !list_data(l, basic_block_t, list)->jmp_flag)
+            continue;
+
+        ret = _sccp_fold_jmps(s, sb);
+        if (ret < 0)
+            return ret;
+    }
+
+    // 删掉不可达的块，不可达的块后面的跳转块也一起删掉
+    for (l = list_head(bb_list_head); l != list_sentinel(bb_list_head);) {
+        bb = list_data(l, basic_block_t, list);
+        l = list_next(l);
+
+        if (bb->jmp_flag) {
+            if (decision && decision->executable)
+                continue;
+
+        } else {
+            decision = _sccp_bb(s, bb);
+            assert(decision);
+
+            if (decision->executable || bb->end_flag || &bb->list == list_head(bb_list_head))
+                continue;
+
+            logd("bb: %p, index: %d, unreachable\n", bb, bb->index);
+        }
+
+        _sccp_del_bb(s->f, bb);
+    }
+
+    for (l = list_head(bb_list_head); l != list_sentinel(bb_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        sb = _sccp_bb(s, bb);
+        if (!sb || !sb->cfg_changed)
+            continue;
+
+        ret = _sccp_reconnect(s, bb);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int _sccp_init(sccp_t *s, function_t *f) {
+    basic_block_t *bb;
+    sccp_bb_t *sb;
+    list_t *l;
+
+    int ret;
+
+    s->f = f;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l))
+        s->nb_bbs++;
+
+    s->bb_states = calloc(s->nb_bbs, sizeof(sccp_bb_t));
+    if (!s->bb_states)
+        return -ENOMEM;
+
+    s->queue = vector_alloc();
+    if (!s->queue)
+        return -ENOMEM;
+
+    ret = _sccp_find_vars(s);
+    if (ret < 0)
+        return ret;
+
+    sb = s->bb_states;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        sb->bb = bb;
+        sb->in = calloc(s->nb_vars + 1, sizeof(sccp_value_t));
+        sb->out = calloc(s->nb_vars + 1, sizeof(sccp_value_t));
+        sb->succs = vector_alloc();
+
+        if (!sb->in || !sb->out || !sb->succs)
+            return -ENOMEM;
+
+        ret = hash_add(&s->bbs, bb, _sccp_hash(bb), sb);
+        if (ret < 0)
+            return ret;
+        sb++;
+    }
+
+    return 0;
+}
+
+static void _sccp_close(sccp_t *s) {
+    int i;
+
+    if (s->bb_states) {
+        for (i = 0; i < s->nb_bbs; i++) {
+            sccp_bb_t *sb = &s->bb_states[i];
+
+            if (sb->in)
+                free(sb->in);
+            if (sb->out)
+                free(sb->out);
+            if (sb->succs)
+                vector_free(sb->succs);
+        }
+
+        free(s->bb_states);
+    }
+
+    if (s->queue)
+        vector_free(s->queue);
+
+    hash_clear(&s->vars);
+    hash_clear(&s->bbs);
+}
+
+// 跳转的目标都是普通块、第一个块不是跳转块时才能按上面的规则找出边
+static int _sccp_cfg_supported(function_t *f) {
+    basic_block_t *bb;
+    mc_3ac_code_t *c;
+    list_t *l;
+
+    if (f->vla_flag)
+        return 0;
+
+    bb = list_data(list_head(&f->basic_block_list_head), basic_block_t, list);
+    if (bb->jmp_flag)
+        return 0;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        if (!bb->jmp_flag)
+            continue;
+
+        c = _bb_jmp(bb);
+
+        if (!c->dsts || 1 != c->dsts->size || !_jmp_dst(c) || _jmp_dst(c)->jmp_flag)
+            return 0;
+    }
+
+    return 1;
+}
+
+static int _optimize_sccp(ast_t *ast, function_t *f, vector_t *functions) {
+    if (!f)
+        return -EINVAL;
+
+    if (list_empty(&f->basic_block_list_head))
+        return 0;
+
+    if (!_sccp_cfg_supported(f))
+        return 0;
+
+    logd("------- %s() ------\n", f->node.w->text->data);
+
+    sccp_t s = {0};
+
+    int ret = _sccp_init(&s, f);
+    if (ret < 0)
+        goto end;
+
+    ret = _sccp_solve(&s);
+    if (ret < 0) {
+        // 控制流图和跳转对不上时不做任何修改
+        if (-EINVAL == ret)
+            ret = 0;
+        goto end;
+    }
+
+    ret = _sccp_apply(&s);
+
+end:
+    _sccp_close(&s);
+    return ret;
+}
+
+optimizer_t optimizer_sccp =
+    {
+        .name = "sccp",
+
+        .optimize = _optimize_sccp,
+
+        .flags = OPTIMIZER_LOCAL,
+};
@@ -48,18 +48,69 @@ scope_t *scope_alloc(lex_word_t *w, const char *name) {
     return scope;
 }
 
+// 把名字 id 对应的 data 加入索引，id 为空(匿名)时不需要索引
+static int _scope_index_add(hash_t *h, string_t *id, void *data) {
+    if (!id)
+        return 0;
+
+    int ret = hash_add(h, id, string_intern_hash(id), data);
+    if (ret < 0) {
+        loge("index '%s' failed\n", id->data);
+        return ret;
+    }
+    return 0;
+}
+
+// vars 可能被直接 vector_add，查找前把还没进索引的补上
+// 失败时 nb_indexed_vars 停在失败的变量上，下次再补
+static int _scope_index_vars(scope_t *scope) {
+    while (scope->nb_indexed_vars < scope->vars->size) {
+        variable_t *v = scope->vars->data[scope->nb_indexed_vars];
+
+        if (v->w) {
+            int ret = _scope_index_add(&scope->var_index, lex_word_id(v->w), v);
+            if (ret < 0)
+                return ret;
+
+            if (scope->globals) {
+                ret = _scope_index_add(&scope->globals->variables, lex_word_id(v->w), v);
+                if (ret < 0) {
+                    hash_del(&scope->var_index, lex_word_id(v->w), string_intern_hash(lex_word_id(v->w)), v);
+                    return ret;
+                }
+            }
+        }
+
+        scope->nb_indexed_vars++;
+    }
+    return 0;
+}
+
 // push 变量
-void scope_push_var(scope_t *scope, variable_t *var) {
+int scope_push_var(scope_t *scope, variable_t *var) {
     assert(scope);
     assert(var);
-    vector_add(scope->vars, var);
+
+    int ret = vector_add(scope->vars, var);
+    if (ret < 0)
+        return ret;
+
+    return _scope_index_vars(scope);
 }
 
 // push 类型
-void scope_push_type(scope_t *scope, type_t *t) {
+int scope_push_type(scope_t *scope, type_t *t) {
     assert(scope);
     assert(t);
     list_add_front(&scope->type_list_head, &t->list);
+
+    int ret = _scope_index_add(&scope->type_index, t->id, t);
+    if (ret < 0)
+        return ret;
+
+    if (scope->globals)
+        return _scope_index_add(&scope->globals->types, t->id, t);
+    return 0;
 }
 
 // push 操作
@@ -70,17 +121,27 @@ void scope_push_operator(scope_t *scope, function_t *op) {
 }
 
 // push 函数
-void scope_push_function(scope_t *scope, function_t *f) {
+int scope_push_function(scope_t *scope, function_t *f) {
     assert(scope);
     assert(f);
     list_add_front(&scope->function_list_head, &f->list);
+
+    int ret = _scope_index_add(&scope->function_index, lex_word_id(f->node.w), f);
+    if (ret < 0)
+        return ret;
+
+    if (scope->globals)
+        return _scope_index_add(&scope->globals->functions, lex_word_id(f->node.w), f);
+    return 0;
 }
 
 // push 标签
-void scope_push_label(scope_t *scope, label_t *l) {
+int scope_push_label(scope_t *scope, label_t *l) {
     assert(scope);
     assert(l);
     list_add_front(&scope->label_list_head, &l->list);
+
+    return _scope_index_add(&scope->label_index, lex_word_id(l->w), l);
 }
 
 // 释放范围
@@ -99,23 +160,24 @@ void scope_free(scope_t *scope) {
         list_clear(&scope->type_list_head, type_t, list, type_free);
         list_clear(&scope->function_list_head, function_t, list, function_free);
 
+        hash_clear(&scope->var_index);
+        hash_clear(&scope->type_index);
+        hash_clear(&scope->function_index);
+        hash_clear(&scope->label_index);
+
         free(scope);
     }
 }
 
-// 寻找类型
-type_t *scope_find_type(scope_t *scope, const char *name) {
-    type_t *t;
-    list_t *l;
-    // 遍历类型列表
-    for (l = list_head(&scope->type_list_head); l != list_sentinel(&scope->type_list_head); l != list_next(l)) {
-        t = list_data(l, type_t, list);
+// 寻找类型，类型链表是头插的，同名时取最后 push 的
+type_t *scope_find_type_id(scope_t *scope, string_t *id) {
+    if (!id)
+        return NULL;
+    return hash_find_last(&scope->type_index, id, string_intern_hash(id));
+}
 
-        if (!strcmp(name, t->name->data)) {
-            return t;
-        }
-    }
-    return NULL;
+type_t *scope_find_type(scope_t *scope, const char *name) {
+    return scope_find_type_id(scope, string_intern_find_cstr(name));
 }
 
 type_t *scope_find_type_type(scope_t *scope, const int type) {
@@ -131,62 +193,94 @@ type_t *scope_find_type_type(scope_t *scope, const int type) {
     return NULL;
 }
 
-// 寻找变量
+// 寻找变量，vars 按声明顺序排列，同名时取最先声明的
+variable_t *scope_find_variable_id(scope_t *scope, string_t *id) {
+    if (!id)
+        return NULL;
+
+    // 补索引失败(内存不足)时还没进索引的变量找不到，按没找到处理
+    if (_scope_index_vars(scope) < 0)
+        return NULL;
+
+    return hash_find(&scope->var_index, id, string_intern_hash(id));
+}
+
 variable_t *scope_find_variable(scope_t *scope, const char *name) {
-    variable_t *v;
-    int i;
-    for (i = 0; i < scope->vars->size; i++) {
-        v = scope->vars->data[i];
+    // 直接 vector_add 的变量补索引时才驻留名字，先补索引再查名字
+    if (_scope_index_vars(scope) < 0)
+        return NULL;
 
-        if (v->w && !strcmp(name, v->w->text->data))
-            return v;
-    }
-    return NULL;
+    return scope_find_variable_id(scope, string_intern_find_cstr(name));
+}
+
+// 寻找函数，函数链表是头插的，同名(重载)时取最后 push 的
+function_t *scope_find_function_id(scope_t *scope, string_t *id) {
+    if (!id)
+        return NULL;
+    return hash_find_last(&scope->function_index, id, string_intern_hash(id));
 }
 
-// 寻找函数
 function_t *scope_find_function(scope_t *scope, const char *name) {
+    return scope_find_function_id(scope, string_intern_find_cstr(name));
+}
+
+// 把名字为 id 的函数按函数链表的顺序(后 push 的在前)放进 fs，返回个数
+static int _scope_functions_by_id(scope_t *scope, string_t *id, vector_t *fs) {
     function_t *f;
-    list_t *l;
+    int pos = -1;
 
-    for (l = list_head(&scope->function_list_head); l != list_sentinel(&scope->function_list_head); l = list_next(l)) {
-        f = list_data(l, function_t, list);
+    if (!id)
+        return 0;
+
+    uint32_t hash = string_intern_hash(id);
 
-        if (!strcmp(name, f->node.w->text->data))
-            return f;
+    while ((f = hash_next(&scope->function_index, id, hash, &pos))) {
+        int ret = vector_add_front(fs, f);
+        if (ret < 0)
+            return ret;
     }
-    return NULL;
+
+    return fs->size;
 }
 
 // 寻找相同函数
 function_t *scope_find_same_function(scope_t *scope, function_t *f0) {
     function_t *f1;
-    list_t *l;
+    string_t *id = lex_word_id(f0->node.w);
+    uint32_t hash;
+    int pos = -1;
 
-    for (l = list_head(&scope->function_list_head); l != list_sentinel(&scope->function_list_head); l = list_next(l)) {
-        f1 = list_data(l, function_t, list);
+    if (!id)
+        return NULL;
+    hash = string_intern_hash(id);
 
+    function_t *same = NULL;
+
+    // 索引里同名函数按 push 的先后排列，取最后一个相同的，和遍历头插链表的结果一致
+    while ((f1 = hash_next(&scope->function_index, id, hash, &pos))) {
         if (function_same(f0, f1))
-            return f1;
+            same = f1;
     }
-    return NULL;
+    return same;
 }
 
 function_t *scope_find_proper_function(scope_t *scope, const char *name, vector_t *argv) {
+    string_t *id = string_intern_find_cstr(name);
     function_t *f;
-    list_t *l;
+    function_t *proper = NULL;
+    int pos = -1;
 
-    for (l = list_head(&scope->function_list_head); l != list_sentinel(&scope->function_list_head); l = list_next(l)) {
-        f = list_data(l, function_t, list);
+    if (!id)
+        return NULL;
 
-        if (strcmp(f->node.w->text->data, name))
-            continue;
+    uint32_t hash = string_intern_hash(id);
 
+    while ((f = hash_next(&scope->function_index, id, hash, &pos))) {
         if (function_same_argv(f->argv, argv))
-            return f;
+            proper = f;
     }
 
-    return NULL;
+    return proper;
 }
 
 int scope_find_overloaded_functions(vector_t **pfunctions, scope_t *scope, const int op_type, vector_t *argv) {
@@ -224,25 +318,18 @@ int scope_find_overloaded_functions(vector_t **pfunctions, scope_t *scope, const
 }
 
 int scope_find_like_functions(vector_t **pfunctions, scope_t *scope, const char *name, vector_t *argv) {
-    function_t *f;
     vector_t *vec;
-    list_t *l;
 
     vec = vector_alloc();
     if (!vec)
         return -ENOMEM;
 
-    for (l = list_head(&scope->function_list_head); l != list_sentinel(&scope->function_list_head); l = list_next(l)) {
-        f = list_data(l, function_t, list);
-
-        if (strcmp(f->node.w->text->data, name))
-            continue;
-        int ret = vector_add(vec, f);
-        if (ret < 0) {
-            vector_free(vec);
-            return ret;
-        }
+    int ret = _scope_functions_by_id(scope, string_intern_find_cstr(name), vec);
+    if (ret < 0) {
+        vector_free(vec);
+        return ret;
     }
+
     if (0 == vec->size) {
         vector_free(vec);
         return -404;
@@ -253,15 +340,12 @@ int scope_find_like_functions(vector_t **pfunctions, scope_t *scope, const char
 }
 
 // 寻找标签
-label_t *scope_find_label(scope_t *scope, const char *name) {
-    label_t *label;
-    list_t *l;
-
-    for (l = list_head(&scope->label_list_head); l != list_sentinel(&scope->label_list_head); l = list_next(l)) {
-        label = list_data(l, label_t, list);
+label_t *scope_find_label_id(scope_t *scope, string_t *id) {
+    if (!id)
+        return NULL;
+    return hash_find_last(&scope->label_index, id, string_intern_hash(id));
+}
 
-        if (!strcmp(name, label->w->text->data))
-            return label;
-    }
-    return NULL;
+label_t *scope_find_label(scope_t *scope, const char *name) {
+    return scope_find_label_id(scope, string_intern_find_cstr(name));
 }
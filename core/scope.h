@@ -3,6 +3,7 @@
 
 #include "utils_list.h"
 #include "utils_vector.h"
+#include "utils_hash.h"
 #include "lex_word.h"
 #include "core_types.h"
 // -------------------------
@@ -10,6 +11,15 @@
 // 作用域 (Scope) 定义   语义分析的核心阶段，保证变量/函数/类型的查找规则符合语言语义
 // -------------------------
 
+// 全局符号索引，由 ast 持有；根块和文件块的作用域 push 符号时同步加进来，
+// 这样按名字查全局函数/变量/类型不用再遍历整棵语法树
+typedef struct
+{
+    hash_t functions;
+    hash_t variables;
+    hash_t types;
+} symbol_index_t;
+
 // 作用域结构体，表示一个“变量/类型/函数/标签”等符号的可见范围
 struct scope_s
 {
@@ -23,6 +33,15 @@ struct scope_s
     list_t operator_list_head;// 运算符重载列表（如果语言支持 operator overloading）
     list_t function_list_head;// 函数链表（当前作用域定义的函数）
     list_t label_list_head;// 标签链表（如 goto 标签）
+
+    // 按驻留名字建立的哈希索引，由 scope_push_* 维护，查找时不用遍历上面的数组和链表
+    hash_t var_index;
+    hash_t type_index;
+    hash_t function_index;
+    hash_t label_index;
+    int nb_indexed_vars;// 已经进入 var_index 的 vars 个数，vars 被直接追加时查找前补上
+
+    symbol_index_t* globals;// 根块、文件块的作用域指向 ast 的全局符号索引，其它作用域为 NULL
 };
 
 
@@ -41,11 +60,11 @@ void scope_free(scope_t* scope);
 // -------------------------
 
 // 添加一个变量到作用域中
-void scope_push_var(scope_t* scope,variable_t* var);
+int scope_push_var(scope_t* scope,variable_t* var);
 
 
 // 添加一个类型到作用域中
-void scope_push_type(scope_t* scope,type_t* t);
+int scope_push_type(scope_t* scope,type_t* t);
 
 
 // 添加一个运算符重载到作用域中
@@ -53,7 +72,7 @@ void scope_push_operator(scope_t* scope,function_t* op);
 
 
 // 添加一个函数到作用域中
-void scope_push_function(scope_t* scope,function_t* f);
+int scope_push_function(scope_t* scope,function_t* f);
 
 
 // -------------------------
@@ -69,6 +88,12 @@ type_t* scope_find_type_type(scope_t* scope,const int type);
 // 按名字查找变量
 variable_t* scope_find_variable(scope_t* scope, const char* name);
 
+// 按驻留后的名字查找，block_find_* 沿作用域链查找时只需驻留一次
+type_t* scope_find_type_id(scope_t* scope, string_t* id);
+variable_t* scope_find_variable_id(scope_t* scope, string_t* id);
+function_t* scope_find_function_id(scope_t* scope, string_t* id);
+label_t* scope_find_label_id(scope_t* scope, string_t* id);
+
 // 按名字查找函数
 function_t* scope_find_function(scope_t* scope, const char* name);
 
@@ -89,7 +114,7 @@ int scope_find_like_functions(vector_t** pfunctions, scope_t* scope, const char*
 // -------------------------
 
 // 向作用域中添加一个 label
-void scope_push_label(scope_t* scope, label_t* l);
+int scope_push_label(scope_t* scope, label_t* l);
 
 // 按名字查找 label
 label_t* scope_find_label(scope_t* scope, const char* name);
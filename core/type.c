@@ -16,6 +16,13 @@ type_t *type_alloc(lex_word_t *w, const char *name, int type, int size) {
         return NULL;
     }
 
+    t->id = string_intern(t->name);
+    if (!t->id) {
+        string_free(t->name);
+        free(t);
+        return NULL;
+    }
+
     if (w) {
         t->w = lex_word_clone(w);
         if (!t->w) {
@@ -34,6 +34,7 @@ struct type_s
     scope_t* scope;        // 类型所在的作用域（方便查找类型/符号）
 
     string_t* name;        // 类型名（如 "MyStruct"、"int"）
+    string_t* id;          // name 驻留后的结果，按名字查找时直接比较指针
 
     list_t list;           // 链表节点（方便把多个类型挂在 type_list 里）
 
@@ -1,20 +1,32 @@
 #include"coroutine.h"
 
-co_thread_t* __co_thread = NULL;
+__thread co_thread_t* __co_thread = NULL;
 
 int  __co_task_run(co_task_t* task);
-void __asm_co_task_yield(co_task_t* task, uintptr_t* task_rip, uintptr_t* task_rsp, uintptr_t task_rsp0);
+void __co_task_yield(co_task_t* task);
 
-int64_t gettime()
-{
-	struct timeval tv;
+int        __co_runq_push(co_runq_t* q, co_task_t* task);
+co_task_t* __co_runq_pop (co_runq_t* q);
+int64_t    __co_runq_size(co_runq_t* q);
 
-	gettimeofday(&tv, NULL);
+void       __co_inbox_push(co_thread_t* thread, co_task_t* task);
+co_task_t* __co_inbox_take(co_thread_t* thread);
 
-	int64_t time = tv.tv_sec * 1000LL * 1000LL + tv.tv_usec;
+co_thread_t* __co_sched_select(co_sched_t* sched);
+int          __co_thread_steal(co_thread_t* thread);
 
-	return time;
-}
+void __co_thread_wake    (co_thread_t* thread);
+void __co_sched_wake_all (co_sched_t*  sched);
+void __co_sched_wake_idle(co_thread_t* thread);
+
+void    __co_wheel_init  (co_wheel_t*  w, int64_t now);
+void    __co_timer_add   (co_thread_t* thread, co_task_t* task, int64_t time);
+void    __co_timer_del   (co_thread_t* thread, co_task_t* task);
+void    __co_timer_expire(co_thread_t* thread, int64_t now, list_t* due);
+int64_t __co_timer_next  (co_thread_t* thread);
+int     __co_timerfd_arm (co_thread_t* thread, int64_t usec);
+
+void __asm_co_task_entry();
 
 int co_thread_open (co_thread_t** pthread)
 {
@@ -28,8 +40,43 @@ int co_thread_open (co_thread_t** pthread)
 		return -1;
 	}
 
-	rbtree_init(&thread->timers);
+	thread->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (-1 == thread->tfd) {
+		loge("errno: %d\n", errno);
+		return -1;
+	}
+
+	thread->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (-1 == thread->efd) {
+		loge("errno: %d\n", errno);
+		return -1;
+	}
+
+	// timerfd 和 eventfd 的事件 data.ptr 指向线程里对应的 fd, 和任务区分开
+	struct epoll_event ev;
+	ev.events   = EPOLLIN;
+	ev.data.ptr = &thread->tfd;
+
+	if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->tfd, &ev) < 0) {
+		loge("errno: %d\n", errno);
+		return -1;
+	}
+
+	ev.data.ptr = &thread->efd;
+
+	if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->efd, &ev) < 0) {
+		loge("errno: %d\n", errno);
+		return -1;
+	}
+
+	__co_wheel_init(&thread->wheel, gettime());
+
 	list_init  (&thread->tasks);
+	list_init  (&thread->ready_tasks);
+	list_init  (&thread->stack_pool);
+
+	thread->stack_mode = CO_STACK_COPY;
+	thread->stack_size = CO_STACK_SIZE;
 
 	__co_thread = thread;
 
@@ -37,10 +84,151 @@ int co_thread_open (co_thread_t** pthread)
 	return 0;
 }
 
+static void _co_stack_pool_free(co_thread_t* thread)
+{
+	while (!list_empty(&thread->stack_pool)) {
+		co_stack_t* s = list_data(list_head(&thread->stack_pool), co_stack_t, list);
+
+		list_del(&s->list);
+
+		munmap(s->base, s->size);
+		free(s);
+	}
+	thread->n_stacks = 0;
+}
+
 int co_thread_close(co_thread_t*  thread)
 {
-	loge("\n");
-	return -1;
+	if (!thread)
+		return -EINVAL;
+
+	if (thread->n_tasks > 0) {
+		loge("thread %p still has %d tasks\n", thread, thread->n_tasks);
+		return -EINVAL;
+	}
+
+	_co_stack_pool_free(thread);
+
+	close(thread->tfd);
+	close(thread->efd);
+	close(thread->epfd);
+
+	if (__co_thread == thread)
+		__co_thread = NULL;
+
+	free(thread);
+	return 0;
+}
+
+// 只能在线程还没有任务时修改, 池里旧大小的栈全部释放
+int co_thread_set_stack(co_thread_t* thread, int mode, size_t stack_size)
+{
+	if (!thread)
+		return -EINVAL;
+
+	if (CO_STACK_COPY != mode && CO_STACK_MMAP != mode)
+		return -EINVAL;
+
+	if (thread->n_tasks > 0) {
+		loge("thread %p already has %d tasks\n", thread, thread->n_tasks);
+		return -EINVAL;
+	}
+
+	_co_stack_pool_free(thread);
+
+	thread->stack_mode = mode;
+
+	if (stack_size > 0)
+		thread->stack_size = stack_size;
+	return 0;
+}
+
+static co_stack_t* _co_stack_alloc(co_thread_t* thread)
+{
+	co_stack_t* s;
+
+	if (!list_empty(&thread->stack_pool)) {
+		s = list_data(list_head(&thread->stack_pool), co_stack_t, list);
+
+		list_del(&s->list);
+		thread->n_stacks--;
+		return s;
+	}
+
+	s = malloc(sizeof(co_stack_t));
+	if (!s)
+		return NULL;
+
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	s->size = (thread->stack_size + page - 1) & ~(page - 1);
+	s->size += page;
+
+	s->base = mmap(NULL, s->size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (MAP_FAILED == s->base) {
+		loge("mmap stack, size: %ld, errno: %d\n", s->size, errno);
+		free(s);
+		return NULL;
+	}
+
+	// 栈向下生长, 溢出时碰到保护页直接 SIGSEGV, 不会悄悄写坏别的任务的栈
+	if (mprotect(s->base, page, PROT_NONE) < 0) {
+		loge("mprotect guard page, errno: %d\n", errno);
+		munmap(s->base, s->size);
+		free(s);
+		return NULL;
+	}
+
+	return s;
+}
+
+static void _co_stack_free(co_thread_t* thread, co_stack_t* s)
+{
+	if (thread && thread->n_stacks < CO_STACK_POOL_MAX) {
+		list_add_front(&thread->stack_pool, &s->list);
+		thread->n_stacks++;
+		return;
+	}
+
+	munmap(s->base, s->size);
+	free(s);
+}
+
+/* 第一次运行前把参数区 stack_data 拷到新栈的顶部, 下面放一个 __asm_co_stack_switch() 的返回帧,
+ * 切过去时弹出的 rbx, r12, r13 是任务函数, n_floats 和 task, 然后 ret 到 __asm_co_task_entry
+ *
+ * 低地址: mxcsr/fpu cw, r15, r14, r13, r12, rbx, rbp, ret, stack_data... 高地址
+ */
+int __co_stack_init(co_task_t* task)
+{
+	co_stack_t* s = _co_stack_alloc(task->thread);
+	if (!s)
+		return -ENOMEM;
+
+	uintptr_t  top   = (uintptr_t)(s->base + s->size);
+	uintptr_t  args  = (top - task->stack_len) & ~0xfUL;
+	uintptr_t* frame = (uintptr_t*)args - 8;
+
+	memcpy((void*)args, task->stack_data, task->stack_len);
+
+	frame[0] = 0x1f80 | (0x037fULL << 32); // 默认的 mxcsr 和 x87 控制字
+	frame[1] = 0;
+	frame[2] = 0;
+	frame[3] = (uintptr_t)task;
+	frame[4] = task->n_floats;
+	frame[5] = task->rip;
+	frame[6] = 0;
+	frame[7] = (uintptr_t)__asm_co_task_entry;
+
+	task->stack = s;
+	task->rsp   = (uintptr_t)frame;
+
+	free(task->stack_data);
+	task->stack_data     = NULL;
+	task->stack_len      = 0;
+	task->stack_capacity = 0;
+	return 0;
 }
 
 int co_task_alloc(co_task_t** ptask, uintptr_t funcptr, const char* fmt, uintptr_t rdx, uintptr_t rcx, uintptr_t r8, uintptr_t r9, uintptr_t* rsp,
@@ -160,37 +348,68 @@ int co_task_alloc(co_task_t** ptask, uintptr_t funcptr, const char* fmt, uintptr
 	return 0;
 }
 
-static int _co_timer_cmp(rbtree_node_t* node0, void* data)
+static void _co_fd_free(co_thread_t* thread, co_fd_t* cf)
 {
-	co_task_t* task0 = (co_task_t*)node0;
-	co_task_t* task1 = (co_task_t*)data;
+	if (thread && epoll_ctl(thread->epfd, EPOLL_CTL_DEL, cf->fd, NULL) < 0 && ENOENT != errno && EBADF != errno)
+		loge("EPOLL_CTL_DEL fd: %d, errno: %d\n", cf->fd, errno);
 
-	if (task0->time < task1->time)
-		return -1;
-	else if (task0->time > task1->time)
-		return 1;
-	return 0;
+	while (cf->read_bufs) {
+		co_buf_t* b = cf->read_bufs;
+
+		cf->read_bufs = b->next;
+		free(b);
+	}
+
+	free(cf);
 }
 
 void co_task_free(co_task_t* task)
 {
+	int i;
+	for (i = 0; i < task->n_fds; i++)
+		_co_fd_free(task->thread, task->fds[i]);
+
+	if (task->fds)
+		free(task->fds);
+
 	if (task->stack_data)
 		free(task->stack_data);
 
+	if (task->stack)
+		_co_stack_free(task->thread, task->stack);
+
 	free(task);
 }
 
+// 调度器里的线程加任务时选任务最少的线程, 不是当前线程的通过收件箱交给它
 void co_thread_add_task(co_thread_t* thread, co_task_t* task)
 {
-	task->time = gettime();
+	co_sched_t* sched = thread->sched;
 
-	rbtree_insert(&thread->timers, &task->timer, _co_timer_cmp);
+	if (sched) {
+		thread = __co_sched_select(sched);
 
-	list_add_tail(&thread->tasks,  &task->list);
+		// 任务会在线程间迁移, 不挂在某个线程的 tasks 链表上
+		list_init(&task->list);
+
+		__atomic_add_fetch(&sched->n_tasks, 1, __ATOMIC_RELAXED);
+	} else
+		list_add_tail(&thread->tasks, &task->list);
+
+	__atomic_add_fetch(&thread->n_tasks, 1, __ATOMIC_RELAXED);
 
 	task->thread = thread;
+	task->time   = 0;
+
+	if (thread != __co_thread) {
+		__co_inbox_push(thread, task);
+		return;
+	}
 
-	thread->n_tasks++;
+	task->ready_flag = 1;
+
+	if (__co_runq_push(&thread->runq, task) < 0)
+		list_add_tail(&thread->ready_tasks, &task->ready);
 }
 
 int __async(uintptr_t funcptr, const char* fmt, uintptr_t rdx, uintptr_t rcx, uintptr_t r8, uintptr_t r9, uintptr_t* rsp,
@@ -220,7 +439,7 @@ int __save_stack(co_task_t* task)
 {
 	task->stack_len = task->rsp0 - task->rsp;
 
-	logi("task: %p, stack_len: %ld, start: %#lx, end: %#lx, task->rip: %#lx\n",
+	logd("task: %p, stack_len: %ld, start: %#lx, end: %#lx, task->rip: %#lx\n",
 			task, task->stack_len, task->rsp, task->rsp0, task->rip);
 
 	if (task->stack_len > task->stack_capacity) {
@@ -238,27 +457,26 @@ int __save_stack(co_task_t* task)
 	return 0;
 }
 
-void __async_msleep(int64_t msec)
+void __async_usleep(int64_t usec)
 {
 	co_thread_t* thread = __co_thread;
 	co_task_t*   task   = thread->current;
 
-	if (task->time > 0)
-		rbtree_delete(&thread->timers, &task->timer);
+	__co_timer_add(thread, task, gettime() + usec);
 
-	int64_t time = gettime();
-	task->time = time + 1000 * msec;
+	logd("task->rip: %#lx, task->rsp: %#lx\n", task->rip, task->rsp);
 
-	rbtree_insert(&thread->timers, &task->timer, _co_timer_cmp);
-
-	loge("task->rip: %#lx, task->rsp: %#lx\n", task->rip, task->rsp);
+	__co_task_yield(task);
+}
 
-	__asm_co_task_yield(task, &task->rip, &task->rsp, task->rsp0);
+void __async_msleep(int64_t msec)
+{
+	__async_usleep(msec * 1000LL);
 }
 
-static size_t _co_read_from_bufs(co_task_t* task, void* buf, size_t count)
+static size_t _co_read_from_bufs(co_fd_t* cf, void* buf, size_t count)
 {
-	co_buf_t** pp = &task->read_bufs;
+	co_buf_t** pp = &cf->read_bufs;
 
 	size_t pos = 0;
 
@@ -290,7 +508,8 @@ static size_t _co_read_from_bufs(co_task_t* task, void* buf, size_t count)
 	return pos;
 }
 
-static int _co_read_to_bufs(co_task_t* task)
+// 读到 EAGAIN 为止, 返回 1 表示对端已关闭
+static int _co_read_to_bufs(co_fd_t* cf)
 {
 	co_buf_t*  b = NULL;
 
@@ -302,27 +521,31 @@ static int _co_read_to_bufs(co_task_t* task)
 				return -ENOMEM;
 			}
 
-			b->len = 0;
-			b->pos = 0;
+			b->next = NULL;
+			b->len  = 0;
+			b->pos  = 0;
 
-			co_buf_t** pp = &task->read_bufs;
+			co_buf_t** pp = &cf->read_bufs;
 
 			while (*pp)
 				pp = &(*pp)->next;
 			*pp = b;
 		}
 
-		int ret = read(task->fd, b->data + b->len, 4096 - b->len);
+		int ret = read(cf->fd, b->data + b->len, 4096 - b->len);
 		if (ret < 0) {
 			if (EINTR == errno)
 				continue;
-			else if (EAGAIN == errno)
+			else if (EAGAIN == errno) {
+				// 边沿触发, 读空以后要等下一个 EPOLLIN
+				cf->ready_events &= ~EPOLLIN;
 				break;
-			else {
+			} else {
 				loge("\n");
 				return -errno;
 			}
-		}
+		} else if (0 == ret)
+			return 1;
 
 		b->len += ret;
 		if (4096 == b->len)
@@ -332,37 +555,85 @@ static int _co_read_to_bufs(co_task_t* task)
 	return 0;
 }
 
-static int _co_add_event(int fd, uint32_t events)
+static int _co_find_fd(co_task_t* task, int fd)
 {
-	co_thread_t*  thread = __co_thread;
-	co_task_t*    task   = thread->current;
+	int i;
+	for (i = 0; i < task->n_fds; i++) {
+		if (task->fds[i]->fd == fd)
+			return i;
+	}
+
+	return -1;
+}
+
+/* fd 一直注册到任务结束或者 __async_close(), 同时等读写, 边沿触发, 所以同一个 fd 上连续的读写不再调用 epoll_ctl(),
+ * 交替使用几个 fd 的任务(比如代理)每个 fd 都只注册一次
+ *
+ * 就绪状态缓存在 cf->ready_events 里: 刚注册时假定可读可写, 先直接读写, 遇到 EAGAIN 清掉对应的位再等 epoll
+ */
+static int _co_add_event(co_thread_t* thread, co_task_t* task, int fd, co_fd_t** pcf)
+{
+	int i = _co_find_fd(task, fd);
+	if (i >= 0) {
+		*pcf = task->fds[i];
+		return 0;
+	}
+
+	if (task->n_fds >= task->fds_capacity) {
+		int n = task->fds_capacity > 0 ? task->fds_capacity * 2 : 2;
+
+		void* p = realloc(task->fds, n * sizeof(co_fd_t*));
+		if (!p)
+			return -ENOMEM;
+
+		task->fds          = p;
+		task->fds_capacity = n;
+	}
+
+	co_fd_t* cf = calloc(1, sizeof(co_fd_t));
+	if (!cf)
+		return -ENOMEM;
 
 	struct epoll_event ev;
-	ev.events   = events | EPOLLET | EPOLLRDHUP;
-	ev.data.ptr = task;
+	ev.events   = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+	ev.data.ptr = cf;
 
 	if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
 
-		if (EEXIST != errno) {
-			loge("\n");
-			return -errno;
-		}
-
-		if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
-			loge("\n");
+		if (EEXIST != errno || epoll_ctl(thread->epfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+			loge("fd: %d, errno: %d\n", fd, errno);
+			free(cf);
 			return -errno;
 		}
 	}
 
-	task->fd     = fd;
-	task->events = 0;
+	cf->task         = task;
+	cf->fd           = fd;
+	cf->ready_events = EPOLLIN | EPOLLOUT;
+
+	task->fds[task->n_fds++] = cf;
+
+	*pcf = cf;
 	return 0;
 }
 
+// 只有在这里等着这个 fd 的任务才会被它的 epoll 事件唤醒, 其它时候来的事件只记到 ready_events 里
+static void _co_wait_io(co_task_t* task, co_fd_t* cf)
+{
+	task->wait_fd      = cf;
+	task->wait_io_flag = 1;
+
+	__co_task_yield(task);
+
+	task->wait_io_flag = 0;
+	task->wait_fd      = NULL;
+}
+
 int __async_connect(int fd, const struct sockaddr *addr, socklen_t addrlen, int64_t msec)
 {
 	co_thread_t*  thread = __co_thread;
 	co_task_t*    task   = thread->current;
+	co_fd_t*      cf     = NULL;
 
 	int flags = fcntl(fd, F_GETFL);
 	flags |= O_NONBLOCK;
@@ -383,25 +654,22 @@ int __async_connect(int fd, const struct sockaddr *addr, socklen_t addrlen, int6
 			return 0;
 	}
 
-	if (task->time > 0)
-		rbtree_delete(&thread->timers, &task->timer);
-
-	int64_t time = gettime() + msec * 1000LL;
-	task->time   = time;
-
-	rbtree_insert(&thread->timers, &task->timer, _co_timer_cmp);
+	__co_timer_add(thread, task, gettime() + msec * 1000LL);
 
-	int ret = _co_add_event(fd, EPOLLOUT);
+	int ret = _co_add_event(thread, task, fd, &cf);
 	if (ret < 0) {
 		loge("\n");
+		__co_timer_del(thread, task);
 		return ret;
 	}
 
-	__asm_co_task_yield(task, &task->rip, &task->rsp, task->rsp0);
+	cf->events = 0;
+
+	_co_wait_io(task, cf);
 
 	int err = -ETIMEDOUT;
 
-	if (task->events & EPOLLOUT) {
+	if (cf->events & EPOLLOUT) {
 
 		socklen_t errlen = sizeof(err);
 
@@ -416,15 +684,7 @@ int __async_connect(int fd, const struct sockaddr *addr, socklen_t addrlen, int6
 		logi("err: %d\n", err);
 	}
 
-	if (epoll_ctl(thread->epfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
-		loge("EPOLL_CTL_DEL fd: %d, errno: %d\n", fd, errno);
-		return -errno;
-	}
-
-	if (task->time > 0) {
-		rbtree_delete(&thread->timers, &task->timer);
-		task->time = 0;
-	}
+	__co_timer_del(thread, task);
 
 	return err;
 }
@@ -433,46 +693,53 @@ int __async_read(int fd, void* buf, size_t count, int64_t msec)
 {
 	co_thread_t*  thread = __co_thread;
 	co_task_t*    task   = thread->current;
+	co_fd_t*      cf     = NULL;
 
-	int ret = _co_add_event(fd, EPOLLIN);
+	int ret = _co_add_event(thread, task, fd, &cf);
 	if (ret < 0) {
 		loge("\n");
 		return ret;
 	}
 
-	if (task->time > 0)
-		rbtree_delete(&thread->timers, &task->timer);
+	int64_t time = 0;
+	size_t  pos  = 0;
 
-	int64_t time = gettime() + msec * 1000LL;
-	task->time   = time;
+	while (1) {
+		size_t len = _co_read_from_bufs(cf, buf + pos, count - pos);
+		pos += len;
 
-	rbtree_insert(&thread->timers, &task->timer, _co_timer_cmp);
+		if (pos == count)
+			break;
 
-	size_t pos = 0;
+		if (cf->ready_events & EPOLLIN) {
+			ret = _co_read_to_bufs(cf);
+			if (ret < 0) {
+				loge("\n");
+				return ret;
+			}
 
-	while (1) {
-		int ret = _co_read_to_bufs(task);
-		if (ret < 0) {
-			loge("\n");
-			return ret;
+			if (cf->read_bufs && cf->read_bufs->pos < cf->read_bufs->len)
+				continue;
+
+			if (1 == ret) {
+				pos += _co_read_from_bufs(cf, buf + pos, count - pos);
+				break;
+			}
 		}
 
-		size_t len = _co_read_from_bufs(task, buf + pos, count - pos);
-		pos += len;
+		// 需要等的时候才设定时器
+		if (0 == time) {
+			time = gettime() + msec * 1000LL;
 
-		if (pos == count)
-			break;
+			__co_timer_add(thread, task, time);
 
-		if (time < gettime())
+		} else if (time < gettime())
 			break;
 
-		__asm_co_task_yield(task, &task->rip, &task->rsp, task->rsp0);
+		_co_wait_io(task, cf);
 	}
 
-	if (epoll_ctl(thread->epfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
-		loge("EPOLL_CTL_DEL fd: %d, errno: %d\n", fd, errno);
-		return -errno;
-	}
+	__co_timer_del(thread, task);
 
 	return pos;
 }
@@ -481,8 +748,9 @@ int __async_write(int fd, void* buf, size_t count)
 {
 	co_thread_t*  thread = __co_thread;
 	co_task_t*    task   = thread->current;
+	co_fd_t*      cf     = NULL;
 
-	int ret = _co_add_event(fd, EPOLLOUT);
+	int ret = _co_add_event(thread, task, fd, &cf);
 	if (ret < 0) {
 		loge("\n");
 		return ret;
@@ -491,12 +759,17 @@ int __async_write(int fd, void* buf, size_t count)
 	size_t pos = 0;
 
 	while (pos < count) {
-		int ret = write(task->fd, buf + pos, count - pos);
+		if (!(cf->ready_events & EPOLLOUT)) {
+			_co_wait_io(task, cf);
+			continue;
+		}
+
+		int ret = write(fd, buf + pos, count - pos);
 		if (ret < 0) {
 			if (EINTR == errno)
 				continue;
 			else if (EAGAIN == errno)
-				__asm_co_task_yield(task, &task->rip, &task->rsp, task->rsp0);
+				cf->ready_events &= ~EPOLLOUT;
 			else {
 				loge("\n");
 				return -errno;
@@ -505,18 +778,38 @@ int __async_write(int fd, void* buf, size_t count)
 			pos += ret;
 	}
 
-	if (epoll_ctl(thread->epfd, EPOLL_CTL_DEL, fd, NULL) < 0) {
-		loge("EPOLL_CTL_DEL fd: %d, errno: %d\n", fd, errno);
-		return -errno;
+	return pos;
+}
+
+int __async_close(int fd)
+{
+	co_thread_t*  thread = __co_thread;
+	co_task_t*    task   = thread ? thread->current : NULL;
+
+	if (task) {
+		int i = _co_find_fd(task, fd);
+
+		if (i >= 0) {
+			_co_fd_free(thread, task->fds[i]);
+
+			task->fds[i] = task->fds[--task->n_fds];
+		}
 	}
 
-	return pos;
+	return close(fd);
 }
 
 void __async_exit()
 {
-	if (__co_thread)
+	if (__co_thread) {
 		__co_thread->exit_flag = 1;
+
+		if (__co_thread->sched) {
+			__atomic_store_n(&__co_thread->sched->exit_flag, 1, __ATOMIC_RELEASE);
+
+			__co_sched_wake_all(__co_thread->sched);
+		}
+	}
 }
 
 int __async_loop()
@@ -526,18 +819,123 @@ int __async_loop()
 
 #define CO_TASK_DELETE(task) \
 	do { \
-		if (task->time > 0) { \
-			rbtree_delete(&thread->timers, &task->timer); \
-			task->time = 0; \
-		} \
+		__co_timer_del(thread, task); \
 		\
 		list_del(&task->list); \
-		thread->n_tasks--; \
+		__atomic_sub_fetch(&thread->n_tasks, 1, __ATOMIC_RELAXED); \
+		\
+		if (thread->sched && 0 == __atomic_sub_fetch(&thread->sched->n_tasks, 1, __ATOMIC_RELEASE)) \
+			__co_sched_wake_all(thread->sched); \
 		\
 		co_task_free(task); \
 		task = NULL; \
 	} while (0)
 
+// 每轮 epoll_wait 之间最多从运行队列里跑这么多次任务
+#define CO_RUN_BUDGET 256
+
+static void _co_thread_run_task(co_thread_t* thread, co_task_t* task)
+{
+	int ret = __co_task_run(task);
+
+	if (ret < 0) {
+		loge("ret: %d, thread: %p, task: %p\n", ret, thread, task);
+
+		CO_TASK_DELETE(task);
+
+	} else if (CO_OK == ret) {
+		logi("ret: %d, thread: %p, task: %p\n", ret, thread, task);
+
+		CO_TASK_DELETE(task);
+	}
+}
+
+// 用过 fd 的任务一直注册在本线程的 epoll 里, 直到 __async_close(), 拷贝模式运行过的任务的栈只能拷回本线程的栈上, 都不能迁移
+int __co_task_pinned(co_task_t* task)
+{
+	return task->n_fds > 0 || (!task->stack && task->rsp0);
+}
+
+// 就绪的任务都放进运行队列, 不在这里直接运行:
+// 拷贝模式的任务每次都要在同一个栈深度上恢复, 所以只在 co_thread_run() 里的两个地方运行任务
+static void _co_thread_ready(co_thread_t* thread, co_task_t* task)
+{
+	task->ready_flag = 1;
+
+	if (__co_runq_push(&thread->runq, task) < 0)
+		list_add_tail(&thread->ready_tasks, &task->ready);
+
+	if (thread->sched && __co_runq_size(&thread->runq) > 1)
+		__co_sched_wake_idle(thread);
+}
+
+static void _co_thread_timers(co_thread_t* thread)
+{
+	list_t due;
+	list_init(&due);
+
+	__co_timer_expire(thread, gettime(), &due);
+
+	while (!list_empty(&due)) {
+		co_task_t* task = list_data(list_head(&due), co_task_t, timer);
+
+		list_del(&task->timer);
+		task->time = 0;
+
+		_co_thread_ready(thread, task);
+	}
+}
+
+/* epoll_wait() 的超时: 有可运行的任务时不等, 否则等到下一个定时器到期, 没有定时器时一直等 fd 事件,
+ * 调度器里的线程也一样, 有新任务或者该结束时别的线程写 eventfd 叫醒它
+ *
+ * epoll_wait() 只能精确到 ms, 不到 1ms 的部分用 timerfd
+ */
+static int _co_thread_timeout(co_thread_t* thread)
+{
+	if (__co_runq_size(&thread->runq) > 0 || !list_empty(&thread->ready_tasks))
+		return 0;
+
+	int64_t next    = __co_timer_next(thread);
+	int     timeout = -1;
+
+	if (next >= 0) {
+		int64_t delta = next - gettime();
+
+		if (delta <= 0)
+			return 0;
+
+		if (delta < CO_WHEEL_TICK) {
+			if (__co_timerfd_arm(thread, delta) < 0)
+				return 0;
+
+		} else if (delta / 1000 < INT_MAX)
+			timeout = delta / 1000;
+		else
+			timeout = INT_MAX;
+	}
+
+	return timeout;
+}
+
+static int _co_thread_done(co_thread_t* thread)
+{
+	if (thread->exit_flag)
+		return 1;
+
+	if (thread->sched) {
+		if (__atomic_load_n(&thread->sched->exit_flag, __ATOMIC_ACQUIRE))
+			return 1;
+
+		// 本线程没有任务时还可以去偷, 所有线程都没有任务才结束
+		return 0 == __atomic_load_n(&thread->sched->n_tasks, __ATOMIC_ACQUIRE);
+	}
+
+	assert(thread->n_tasks >= 0);
+
+	return 0 == thread->n_tasks;
+}
+
 int co_thread_run(co_thread_t* thread)
 {
 	if (!thread)
@@ -549,12 +947,24 @@ int co_thread_run(co_thread_t* thread)
 	if (!events)
 		return -ENOMEM;
 
-	while (!thread->exit_flag) {
+	while (!_co_thread_done(thread)) {
 
-		assert(thread->n_tasks >= 0);
+		// 先清 wake_flag 再看收件箱, 之后加进来的任务会再写一次 eventfd
+		__atomic_store_n(&thread->wake_flag, 0, __ATOMIC_SEQ_CST);
 
-		if (0 == thread->n_tasks)
-			break;
+		co_task_t* task = __co_inbox_take(thread);
+
+		while (task) {
+			co_task_t* next = task->inbox_next;
+
+			task->inbox_next = NULL;
+
+			_co_thread_ready(thread, task);
+			task = next;
+		}
+
+		if (thread->sched && 0 == __co_runq_size(&thread->runq))
+			__co_thread_steal(thread);
 
 		if (n_tasks < thread->n_tasks + 1) {
 			n_tasks = thread->n_tasks + 1;
@@ -568,61 +978,81 @@ int co_thread_run(co_thread_t* thread)
 			events = p;
 		}
 
-		int ret = epoll_wait(thread->epfd, events, n_tasks, 10);
+		int timeout = _co_thread_timeout(thread);
+
+		if (thread->sched && 0 != timeout) {
+			__atomic_store_n(&thread->idle_flag, 1, __ATOMIC_SEQ_CST);
+			__atomic_add_fetch(&thread->sched->n_idle, 1, __ATOMIC_RELAXED);
+		}
+
+		int ret = epoll_wait(thread->epfd, events, n_tasks, timeout);
+
+		if (thread->sched && __atomic_exchange_n(&thread->idle_flag, 0, __ATOMIC_SEQ_CST))
+			__atomic_sub_fetch(&thread->sched->n_idle, 1, __ATOMIC_RELAXED);
+
 		if (ret < 0) {
+			if (EINTR == errno)
+				continue;
+
 			loge("errno: %d\n", errno);
 
 			free(events);
 			return -1;
 		}
 
+		// 先把这一批事件都记到 fd 上, 再运行等着的任务:
+		// 任务运行时可能关掉别的 fd, 它后面的事件的 data.ptr 就失效了
 		int i;
 		for (i = 0; i < ret; i++) {
 
-			co_task_t* task = events[i].data.ptr;
-			assert(task);
+			void* p = events[i].data.ptr;
 
-			task->events = events[i].events;
+			events[i].data.ptr = NULL;
 
-			int ret2 = __co_task_run(task);
+			if (p == &thread->tfd || p == &thread->efd) {
+				uint64_t n;
 
-			if (ret2 < 0) {
-				loge("ret2: %d, thread: %p, task: %p\n", ret2, thread, task);
+				if (read(*(int*)p, &n, sizeof(n)) < 0 && EAGAIN != errno)
+					loge("timerfd/eventfd read, errno: %d\n", errno);
+				continue;
+			}
 
-				CO_TASK_DELETE(task);
+			co_fd_t* cf = p;
 
-			} else if (CO_OK == ret2) {
-				logi("ret2: %d, thread: %p, task: %p\n", ret2, thread, task);
+			cf->events        = events[i].events;
+			cf->ready_events |= events[i].events;
 
-				CO_TASK_DELETE(task);
-			}
-		}
+			task = cf->task;
 
-		while (1) {
-			co_task_t* task = (co_task_t*) rbtree_min(&thread->timers, thread->timers.root);
-			if (!task)
-				break;
+			// 已经在运行队列里的, 等轮到它再运行
+			if (task->wait_io_flag && task->wait_fd == cf && !task->ready_flag)
+				events[i].data.ptr = task;
+		}
 
-			if (task->time > gettime())
-				break;
+		// 一个任务只等一个 fd, 同一个 fd 一批里只来一次事件, 所以每个任务最多出现一次
+		for (i = 0; i < ret; i++) {
+			if (events[i].data.ptr)
+				_co_thread_run_task(thread, events[i].data.ptr);
+		}
 
-			rbtree_delete(&thread->timers, &task->timer);
-			task->time = 0;
+		int budget = CO_RUN_BUDGET;
 
-			int ret2 = __co_task_run(task);
+		while (budget-- > 0) {
+			_co_thread_timers(thread);
 
-			if (ret2 < 0) {
-				loge("ret2: %d, thread: %p, task: %p\n", ret2, thread, task);
+			task = __co_runq_pop(&thread->runq);
+			if (!task) {
+				if (list_empty(&thread->ready_tasks))
+					break;
 
-				CO_TASK_DELETE(task);
+				task = list_data(list_head(&thread->ready_tasks), co_task_t, ready);
+				list_del(&task->ready);
+			}
 
-			} else if (CO_OK == ret2) {
-				logi("ret2: %d, thread: %p, task: %p\n", ret2, thread, task);
+			task->ready_flag = 0;
 
-				CO_TASK_DELETE(task);
-			}
+			_co_thread_run_task(thread, task);
 		}
-
 	}
 
 	logi("async exit\n");
@@ -2,7 +2,6 @@
 #define COROUTINE_H
 
 #include"utils_list.h"
-#include"rbtree.h"
 
 #include<sys/types.h>
 #include<sys/socket.h>
@@ -11,14 +10,24 @@
 
 #include<sys/epoll.h>
 #include<sys/time.h>
+#include<sys/timerfd.h>
+#include<sys/eventfd.h>
+#include<sys/mman.h>
 #include<fcntl.h>
+#include<pthread.h>
 
 typedef struct co_task_s    co_task_t;
 typedef struct co_thread_s  co_thread_t;
 
 typedef struct co_buf_s     co_buf_t;
+typedef struct co_fd_s      co_fd_t;
+typedef struct co_stack_s   co_stack_t;
+typedef struct co_runq_s    co_runq_t;
+typedef struct co_sched_s   co_sched_t;
+typedef struct co_wheel_s   co_wheel_t;
 
-extern         co_thread_t* __co_thread;
+// 每个系统线程有自己的 co_thread_t
+extern __thread co_thread_t* __co_thread;
 
 struct co_buf_s
 {
@@ -29,18 +38,75 @@ struct co_buf_s
 	uint8_t            data[0];
 };
 
+// 任务用过的一个 fd, 一直注册在线程的 epoll 里, 直到 __async_close() 或者任务结束, epoll 事件的 data.ptr 指向它
+struct co_fd_s
+{
+	co_task_t*     task;
+	int                fd;
+
+	uint32_t           events;       // 最近一次 epoll 给的事件
+	uint32_t           ready_events; // 缓存的就绪状态, 读写遇到 EAGAIN 时清掉对应的位
+
+	co_buf_t*      read_bufs;    // 从这个 fd 多读出来的数据
+};
+
 #define CO_ERROR   -1
 #define CO_OK       0
 #define CO_CONTINUE 1
 
+// 任务栈的两种模式:
+// CO_STACK_COPY, 任务在线程栈上运行, 每次切出时把栈拷走, 切回时再拷回来
+// CO_STACK_MMAP, 每个任务有自己的 mmap 栈, 切换时只交换 rsp 和 callee-saved 寄存器
+#define CO_STACK_COPY 0
+#define CO_STACK_MMAP 1
+
+#define CO_STACK_SIZE      (256 * 1024)
+#define CO_STACK_POOL_MAX  1024
+
+struct co_stack_s
+{
+	list_t         list;
+
+	uint8_t*           base; // 整个映射, 最低的一页是保护页
+	size_t             size;
+};
+
+#define CO_RUNQ_SIZE 4096
+
+// Chase-Lev 队列, 所属线程在 bottom 端 push, 所属线程和偷的线程都从 top 端取
+struct co_runq_s
+{
+	int64_t            top;
+	int64_t            bottom;
+
+	co_task_t*     tasks[CO_RUNQ_SIZE];
+};
+
+// 分层时间轮: 第 0 层一格 1ms, 上一层的一格是下一层转一圈,
+// 5 层 64 格能放 2^30 ms 以内的定时器, 更远的先放在最远的格子里, 转到时再放一次
+#define CO_WHEEL_BITS    6
+#define CO_WHEEL_SLOTS   (1 << CO_WHEEL_BITS)
+#define CO_WHEEL_LEVELS  5
+#define CO_WHEEL_TICK    1000 // us
+
+struct co_wheel_s
+{
+	list_t         slots[CO_WHEEL_LEVELS][CO_WHEEL_SLOTS];
+
+	int64_t            tick; // 下一个要处理的格子, 单位 CO_WHEEL_TICK
+	int                n_timers;
+};
+
 struct co_task_s
 {
-	rbtree_node_t  timer;
-	int64_t            time;
+	list_t         timer;
+	int64_t            time; // 到期时间, us, 不在时间轮里时为 0
 
 	list_t         list;
+	list_t         ready; // 运行队列满时挂在 thread->ready_tasks 上
 
 	co_thread_t*   thread;
+	co_task_t*     inbox_next;
 
 	uintptr_t          rip;
 	uintptr_t          rsp;
@@ -53,31 +119,67 @@ struct co_task_s
 	int                n_floats;
 	int                err;
 
-	uint32_t           events;
-	int                fd;
+	co_stack_t*    stack;
+	uint32_t           finish_flag;
 
-	co_buf_t*      read_bufs;
+	uint32_t           wait_io_flag;
+	uint32_t           ready_flag;
+
+	co_fd_t**      fds; // 交替使用几个 fd 的任务, 每个 fd 各自注册, 各自缓存读到的数据
+	int                n_fds;
+	int                fds_capacity;
+
+	co_fd_t*       wait_fd; // wait_io_flag 时在等的 fd
 };
 
 struct co_thread_s
 {
 	int                epfd;
+	int                tfd; // 不到 1ms 的定时用 timerfd
+	int                efd; // 别的线程往收件箱里加了任务, 或者调度器要结束时, 写这个 eventfd 唤醒 epoll_wait()
 
-	rbtree_t       timers;
+	co_wheel_t     wheel;
 
 	list_t         tasks;
 	int                n_tasks;
 
 	co_task_t*     current;
 
+	co_runq_t      runq;
+	list_t         ready_tasks;
+	co_task_t*     inbox; // 其它线程加进来的任务, 无锁栈
+
+	co_sched_t*    sched;
+	int                index;
+	pthread_t          tid;
+	uint32_t           wake_flag; // 已经写过 efd, 本线程还没看收件箱
+	uint32_t           idle_flag; // 在 epoll_wait() 里等, 别的线程任务多时可以叫醒它来偷
+
+	int                stack_mode;
+	size_t             stack_size;
+	list_t         stack_pool;
+	int                n_stacks;
+
+	uint32_t           exit_flag;
+};
+
+struct co_sched_s
+{
+	co_thread_t**  threads;
+	int                n_threads;
+
+	int                n_tasks;
+	int                n_idle;
 	uint32_t           exit_flag;
 };
 
 void __async_exit();
 void __async_msleep(int64_t msec);
+void __async_usleep(int64_t usec);
 int  __async_read (int fd, void* buf, size_t count, int64_t msec);
 int  __async_write(int fd, void* buf, size_t count);
 int  __async_connect(int fd, const struct sockaddr *addr, socklen_t addrlen, int64_t msec);
+int  __async_close(int fd);
 int  __async_loop();
 
 
@@ -88,6 +190,13 @@ void co_thread_add_task(co_thread_t* thread, co_task_t* task);
 
 int  co_thread_run(co_thread_t*  thread);
 
+int  co_thread_set_stack(co_thread_t* thread, int mode, size_t stack_size);
+
+int  co_sched_open (co_sched_t** psched, int n_threads);
+int  co_sched_close(co_sched_t*  sched);
+
+int  co_sched_run(co_sched_t* sched);
+
 int  co_task_alloc(co_task_t** ptask, uintptr_t funcptr, const char* fmt, uintptr_t rdx, uintptr_t rcx, uintptr_t r8, uintptr_t r9, uintptr_t* rsp,
 		double xmm0, double xmm1, double xmm2, double xmm3, double xmm4, double xmm5, double xmm6, double xmm7);
 
@@ -0,0 +1,96 @@
+#include"coroutine.h"
+
+// 切换延迟测试: 任务先递归占用 depth KB 的栈, 再反复 __async_msleep(0) 让出,
+// 拷贝模式每次切换的开销随栈深度增长, mmap 模式应该基本不变
+
+#define BENCH_SWITCHES 20000
+
+static int64_t bench_ns = 0;
+
+static int64_t _bench_time()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int _bench_loop(int n)
+{
+	int64_t t0 = _bench_time();
+	int     i;
+
+	for (i = 0; i < n; i++)
+		__async_msleep(0);
+
+	bench_ns = _bench_time() - t0;
+	return 0;
+}
+
+static int _bench_deep(int depth, int n)
+{
+	volatile uint8_t buf[1024];
+
+	buf[0] = depth;
+
+	if (depth > 0) {
+		int ret = _bench_deep(depth - 1, n);
+
+		return ret + buf[0] - (uint8_t)depth;
+	}
+
+	return _bench_loop(n);
+}
+
+static int _bench_task(long depth, long n)
+{
+	return _bench_deep(depth, n);
+}
+
+int main()
+{
+	co_thread_t* thread = NULL;
+
+	int depths[] = {0, 1, 4, 16, 64};
+	int modes[]  = {CO_STACK_COPY, CO_STACK_MMAP};
+	int i;
+	int j;
+
+	int ret = co_thread_open(&thread);
+	if (ret < 0) {
+		loge("\n");
+		return -1;
+	}
+
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+
+		ret = co_thread_set_stack(thread, modes[i], 0);
+		if (ret < 0) {
+			loge("\n");
+			return -1;
+		}
+
+		for (j = 0; j < sizeof(depths) / sizeof(depths[0]); j++) {
+
+			ret = __async((uintptr_t)_bench_task, "dd", depths[j], BENCH_SWITCHES, 0, 0, NULL,
+					0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+			if (ret < 0) {
+				loge("\n");
+				return -1;
+			}
+
+			ret = co_thread_run(thread);
+			if (ret < 0) {
+				loge("\n");
+				return -1;
+			}
+
+			printf("%s, stack depth: %2dKB, %8.1lf ns / switch\n",
+					CO_STACK_COPY == modes[i] ? "copy" : "mmap",
+					depths[j], (double)bench_ns / BENCH_SWITCHES);
+		}
+	}
+
+	return 0;
+}
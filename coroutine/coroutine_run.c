@@ -3,14 +3,46 @@
 uintptr_t __asm_co_task_run(uintptr_t* task_rsp, void* stack_data,
 		uintptr_t task_rip, intptr_t stack_len, uintptr_t* task_rsp0, int n_floats);
 
+void __asm_co_task_yield(co_task_t* task, uintptr_t* task_rip, uintptr_t* task_rsp, uintptr_t task_rsp0);
+
+void __asm_co_stack_switch(uintptr_t* save_rsp, uintptr_t rsp);
+
+int  __co_stack_init(co_task_t* task);
+
+static int _co_task_run_stack(co_task_t* task)
+{
+	if (!task->stack) {
+		int ret = __co_stack_init(task);
+		if (ret < 0) {
+			loge("task %p, stack init error: %d\n", task, ret);
+			return ret;
+		}
+	}
+
+	__asm_co_stack_switch(&task->rsp0, task->rsp);
+
+	if (task->err) {
+		loge("task %p error: %d, task->time: %ld\n", task, task->err, task->time);
+		return task->err;
+
+	} else if (task->finish_flag)
+		return CO_OK;
+
+	return CO_CONTINUE;
+}
+
 int __co_task_run(co_task_t* task)
 {
 	task->thread->current = task;
 
 	task->err = 0;
 
+	// 已经有独立栈的, 或者还没运行过且线程是 mmap 模式的
+	if (task->stack || (CO_STACK_MMAP == task->thread->stack_mode && 0 == task->rsp0))
+		return _co_task_run_stack(task);
+
 	uintptr_t rsp1 = 0;
-	logw("task %p, rsp0: %#lx, rsp1: %#lx\n", task, task->rsp0, rsp1);
+	logd("task %p, rsp0: %#lx, rsp1: %#lx\n", task, task->rsp0, rsp1);
 
 	rsp1 = __asm_co_task_run(&task->rsp, task->stack_data, task->rip,
 			task->stack_len, &task->rsp0, task->n_floats);
@@ -23,6 +55,22 @@ int __co_task_run(co_task_t* task)
 	} else if (task->rsp0 == rsp1)
 		return CO_OK;
 
-	logi("task %p running, rsp0: %#lx, rsp1: %#lx\n", task, task->rsp0, rsp1);
+	logd("task %p running, rsp0: %#lx, rsp1: %#lx\n", task, task->rsp0, rsp1);
 	return CO_CONTINUE;
 }
+
+void __co_task_yield(co_task_t* task)
+{
+	if (task->stack)
+		__asm_co_stack_switch(&task->rsp, task->rsp0);
+	else
+		__asm_co_task_yield(task, &task->rip, &task->rsp, task->rsp0);
+}
+
+// 独立栈的任务函数返回后从 __asm_co_task_entry 进到这里, 切回线程栈后不会再回来
+void __co_task_exit(co_task_t* task)
+{
+	task->finish_flag = 1;
+
+	__asm_co_stack_switch(&task->rsp, task->rsp0);
+}
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include"coroutine.h"
+
+#include<sched.h>
+
+/*
+ * N:M 调度: 每个核一个 co_thread_t, 各自有 epoll fd, 定时器和运行队列
+ *
+ * 不能迁移的任务(见 coroutine.c 的 __co_task_pinned()): 用过 fd 的任务一直注册在本线程的 epoll 里,
+ * 拷贝模式运行过的任务的栈只能拷回本线程的栈上, 它们也在运行队列里, 偷到了就通过收件箱还给原来的线程
+ *
+ * 队列空的线程从其它线程的队列 top 端偷一半过来, 任务迁移后 task->thread 和两边的 n_tasks 跟着改
+ *
+ * 空闲的线程在 epoll_wait() 里一直等, 往它的收件箱里加任务, 别的线程的队列里积压了任务,
+ * 或者所有任务都结束了, 都写它的 eventfd 把它叫醒
+ */
+
+int __co_task_pinned(co_task_t* task);
+
+int __co_runq_push(co_runq_t* q, co_task_t* task)
+{
+	int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED);
+	int64_t t = __atomic_load_n(&q->top,    __ATOMIC_ACQUIRE);
+
+	if (b - t >= CO_RUNQ_SIZE)
+		return -1;
+
+	__atomic_store_n(&q->tasks[b & (CO_RUNQ_SIZE - 1)], task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	__atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+int64_t __co_runq_size(co_runq_t* q)
+{
+	int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+	int64_t t = __atomic_load_n(&q->top,    __ATOMIC_ACQUIRE);
+
+	return b > t ? b - t : 0;
+}
+
+static co_task_t* _co_runq_steal(co_runq_t* q)
+{
+	int64_t t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+
+	if (t >= b)
+		return NULL;
+
+	co_task_t* task = __atomic_load_n(&q->tasks[t & (CO_RUNQ_SIZE - 1)], __ATOMIC_RELAXED);
+
+	if (!__atomic_compare_exchange_n(&q->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+
+	return task;
+}
+
+// 所属线程也从 top 端取, 先进先出, 反复让出的任务不会饿死队列里别的任务
+co_task_t* __co_runq_pop(co_runq_t* q)
+{
+	while (__co_runq_size(q) > 0) {
+		co_task_t* task = _co_runq_steal(q);
+		if (task)
+			return task;
+	}
+
+	return NULL;
+}
+
+// 一次唤醒只写一次 eventfd, 线程看收件箱之前清掉 wake_flag
+void __co_thread_wake(co_thread_t* thread)
+{
+	if (__atomic_exchange_n(&thread->wake_flag, 1, __ATOMIC_SEQ_CST))
+		return;
+
+	uint64_t n = 1;
+
+	if (write(thread->efd, &n, sizeof(n)) < 0 && EAGAIN != errno)
+		loge("eventfd write, errno: %d\n", errno);
+}
+
+void __co_sched_wake_all(co_sched_t* sched)
+{
+	int i;
+	for (i = 0; i < sched->n_threads; i++) {
+		co_thread_t* thread = sched->threads[i];
+
+		if (thread != __co_thread)
+			__co_thread_wake(thread);
+	}
+}
+
+// thread 的队列里积压了任务, 叫醒一个空闲的线程来偷
+void __co_sched_wake_idle(co_thread_t* thread)
+{
+	co_sched_t* sched = thread->sched;
+
+	if (__atomic_load_n(&sched->n_idle, __ATOMIC_RELAXED) <= 0)
+		return;
+
+	int i;
+	for (i = 1; i < sched->n_threads; i++) {
+		co_thread_t* idle = sched->threads[(thread->index + i) % sched->n_threads];
+
+		if (__atomic_exchange_n(&idle->idle_flag, 0, __ATOMIC_SEQ_CST)) {
+			__atomic_sub_fetch(&sched->n_idle, 1, __ATOMIC_RELAXED);
+
+			__co_thread_wake(idle);
+			return;
+		}
+	}
+}
+
+void __co_inbox_push(co_thread_t* thread, co_task_t* task)
+{
+	co_task_t* head = __atomic_load_n(&thread->inbox, __ATOMIC_RELAXED);
+
+	do {
+		task->inbox_next = head;
+	} while (!__atomic_compare_exchange_n(&thread->inbox, &head, task, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+	if (thread != __co_thread)
+		__co_thread_wake(thread);
+}
+
+// 取走整个收件箱, 按加入的顺序返回
+co_task_t* __co_inbox_take(co_thread_t* thread)
+{
+	co_task_t* task = __atomic_exchange_n(&thread->inbox, NULL, __ATOMIC_SEQ_CST);
+	co_task_t* prev = NULL;
+
+	while (task) {
+		co_task_t* next = task->inbox_next;
+
+		task->inbox_next = prev;
+		prev = task;
+		task = next;
+	}
+
+	return prev;
+}
+
+co_thread_t* __co_sched_select(co_sched_t* sched)
+{
+	co_thread_t* min = sched->threads[0];
+	int          n   = __atomic_load_n(&min->n_tasks, __ATOMIC_RELAXED);
+	int          i;
+
+	for (i = 1; i < sched->n_threads; i++) {
+		co_thread_t* thread = sched->threads[i];
+
+		int n2 = __atomic_load_n(&thread->n_tasks, __ATOMIC_RELAXED);
+		if (n2 < n) {
+			n   = n2;
+			min = thread;
+		}
+	}
+
+	return min;
+}
+
+int __co_thread_steal(co_thread_t* thread)
+{
+	co_sched_t* sched = thread->sched;
+
+	int n = 0;
+	int i;
+
+	for (i = 1; i < sched->n_threads && 0 == n; i++) {
+
+		co_thread_t* victim = sched->threads[(thread->index + i) % sched->n_threads];
+
+		int64_t half = (__co_runq_size(&victim->runq) + 1) / 2;
+
+		while (half-- > 0) {
+			co_task_t* task = _co_runq_steal(&victim->runq);
+			if (!task)
+				break;
+
+			if (__co_task_pinned(task)) {
+				__co_inbox_push(victim, task);
+				continue;
+			}
+
+			__atomic_sub_fetch(&victim->n_tasks, 1, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&thread->n_tasks, 1, __ATOMIC_RELAXED);
+
+			task->thread = thread;
+
+			if (__co_runq_push(&thread->runq, task) < 0)
+				__co_inbox_push(thread, task);
+			n++;
+		}
+	}
+
+	if (n > 0) {
+		logd("thread %d stole %d tasks\n", thread->index, n);
+	}
+	return n;
+}
+
+int co_sched_open(co_sched_t** psched, int n_threads)
+{
+	if (!psched)
+		return -EINVAL;
+
+	if (n_threads <= 0) {
+		n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+		if (n_threads <= 0)
+			n_threads = 1;
+	}
+
+	co_sched_t* sched = calloc(1, sizeof(co_sched_t));
+	if (!sched)
+		return -ENOMEM;
+
+	sched->threads = calloc(n_threads, sizeof(co_thread_t*));
+	if (!sched->threads) {
+		free(sched);
+		return -ENOMEM;
+	}
+
+	int i;
+	for (i = 0; i < n_threads; i++) {
+		co_thread_t* thread = NULL;
+
+		int ret = co_thread_open(&thread);
+		if (ret < 0) {
+			co_sched_close(sched);
+			return ret;
+		}
+		sched->threads[sched->n_threads++] = thread;
+
+		// 迁移后任务在别的线程的栈上恢复, 所以只能用独立栈
+		ret = co_thread_set_stack(thread, CO_STACK_MMAP, 0);
+		if (ret < 0) {
+			co_sched_close(sched);
+			return ret;
+		}
+
+		thread->sched = sched;
+		thread->index = i;
+	}
+
+	// 调用者的 __async() 和 co_sched_run() 都用 0 号线程
+	__co_thread = sched->threads[0];
+
+	*psched = sched;
+	return 0;
+}
+
+int co_sched_close(co_sched_t* sched)
+{
+	if (!sched)
+		return -EINVAL;
+
+	int i;
+	for (i = 0; i < sched->n_threads; i++) {
+
+		int ret = co_thread_close(sched->threads[i]);
+		if (ret < 0)
+			return ret;
+
+		sched->threads[i] = NULL;
+	}
+
+	free(sched->threads);
+	free(sched);
+	return 0;
+}
+
+static void* _co_sched_thread(void* arg)
+{
+	co_thread_t* thread = arg;
+
+	__co_thread = thread;
+
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_cpus > 0) {
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(thread->index % n_cpus, &set);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			logw("thread %d, set affinity failed\n", thread->index);
+	}
+
+	int ret = co_thread_run(thread);
+	if (ret < 0)
+		loge("thread %d, ret: %d\n", thread->index, ret);
+
+	return NULL;
+}
+
+// 0 号线程在调用者的线程上运行, 所有任务结束或者 __async_exit() 后返回
+int co_sched_run(co_sched_t* sched)
+{
+	if (!sched)
+		return -EINVAL;
+
+	int i;
+	for (i = 1; i < sched->n_threads; i++) {
+		co_thread_t* thread = sched->threads[i];
+
+		if (pthread_create(&thread->tid, NULL, _co_sched_thread, thread) != 0) {
+			loge("pthread_create, errno: %d\n", errno);
+
+			__atomic_store_n(&sched->exit_flag, 1, __ATOMIC_RELEASE);
+			__co_sched_wake_all(sched);
+
+			while (--i >= 1)
+				pthread_join(sched->threads[i]->tid, NULL);
+			return -1;
+		}
+	}
+
+	__co_thread = sched->threads[0];
+
+	int ret = co_thread_run(sched->threads[0]);
+
+	for (i = 1; i < sched->n_threads; i++)
+		pthread_join(sched->threads[i]->tid, NULL);
+
+	return ret;
+}
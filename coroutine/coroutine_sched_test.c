@@ -0,0 +1,278 @@
+#include"coroutine.h"
+
+#include<sys/types.h>
+#include<sys/socket.h>
+#include<fcntl.h>
+
+#define SCHED_THREADS  4
+
+// 多线程调度的回归测试: 偷任务, 用过 fd 的任务不迁移, 空闲线程被 eventfd 叫醒
+
+#define STRESS_TASKS   2000
+#define STRESS_STEPS   50
+
+static long stress_done     = 0;
+static long stress_steps    = 0;
+static long stress_migrated = 0;
+
+static int _stress_worker(long id, long n)
+{
+	long i;
+
+	for (i = 0; i < n; i++) {
+		co_thread_t* thread = __co_thread;
+
+		if (0 == i % 3)
+			__async_usleep(i % 7 * 100);
+		else
+			__async_msleep(0);
+
+		// 没有 fd 的任务可以被偷到别的线程
+		if (thread != __co_thread)
+			__atomic_add_fetch(&stress_migrated, 1, __ATOMIC_RELAXED);
+
+		__atomic_add_fetch(&stress_steps, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_add_fetch(&stress_done, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static int _stress_spawner(long n, long steps)
+{
+	long i;
+
+	for (i = 0; i < n; i++) {
+		int ret = __async((uintptr_t)_stress_worker, "dd", i, steps, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+		if (ret < 0) {
+			loge("\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int _sched_stress()
+{
+	co_sched_t* sched = NULL;
+
+	int ret = co_sched_open(&sched, SCHED_THREADS);
+	if (ret < 0)
+		return ret;
+
+	ret = __async((uintptr_t)_stress_spawner, "dd", STRESS_TASKS, STRESS_STEPS, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+	if (ret < 0)
+		return ret;
+
+	int64_t t0 = gettime();
+
+	ret = co_sched_run(sched);
+	if (ret < 0)
+		return ret;
+
+	printf("stress: %ld tasks, %ld steps, %ld migrated, %ld ms\n",
+			stress_done, stress_steps, stress_migrated, (long)(gettime() - t0) / 1000);
+
+	if (STRESS_TASKS != stress_done || STRESS_TASKS * STRESS_STEPS != stress_steps) {
+		loge("tasks: %ld, steps: %ld\n", stress_done, stress_steps);
+		return -1;
+	}
+
+	return co_sched_close(sched);
+}
+
+#define IO_PAIRS 200
+#define IO_MSGS  500
+
+static int  io_fds[IO_PAIRS][2];
+static long io_ok     = 0;
+static long io_errors = 0;
+
+static int _io_writer(long k)
+{
+	co_thread_t* thread = NULL;
+	uint32_t     v;
+	long         i;
+
+	for (i = 0; i < IO_MSGS; i++) {
+		v = i;
+
+		if (__async_write(io_fds[k][0], &v, sizeof(v)) != sizeof(v)) {
+			__atomic_add_fetch(&io_errors, 1, __ATOMIC_RELAXED);
+			return -1;
+		}
+
+		// 注册过 fd 以后任务就固定在这个线程上
+		if (!thread)
+			thread = __co_thread;
+		else if (thread != __co_thread) {
+			loge("pair %ld, writer moved from %p to %p\n", k, thread, __co_thread);
+			__atomic_add_fetch(&io_errors, 1, __ATOMIC_RELAXED);
+			return -1;
+		}
+
+		if (0 == i % 10)
+			__async_msleep(0);
+	}
+
+	return __async_close(io_fds[k][0]);
+}
+
+static int _io_reader(long k)
+{
+	co_thread_t* thread = NULL;
+	uint32_t     v;
+	long         i;
+
+	__async_msleep(k % 5);
+
+	for (i = 0; i < IO_MSGS; i++) {
+		int ret = __async_read(io_fds[k][1], &v, sizeof(v), 5000);
+
+		if (ret != sizeof(v) || v != i) {
+			loge("pair %ld, i: %ld, ret: %d, v: %u\n", k, i, ret, v);
+			__atomic_add_fetch(&io_errors, 1, __ATOMIC_RELAXED);
+			return -1;
+		}
+
+		if (!thread)
+			thread = __co_thread;
+		else if (thread != __co_thread) {
+			loge("pair %ld, reader moved from %p to %p\n", k, thread, __co_thread);
+			__atomic_add_fetch(&io_errors, 1, __ATOMIC_RELAXED);
+			return -1;
+		}
+	}
+
+	__atomic_add_fetch(&io_ok, 1, __ATOMIC_RELAXED);
+
+	return __async_close(io_fds[k][1]);
+}
+
+static int _sched_io()
+{
+	co_sched_t* sched = NULL;
+
+	int ret = co_sched_open(&sched, SCHED_THREADS);
+	if (ret < 0)
+		return ret;
+
+	long k;
+	for (k = 0; k < IO_PAIRS; k++) {
+
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, io_fds[k]) < 0) {
+			loge("socketpair, errno: %d\n", errno);
+			return -1;
+		}
+
+		fcntl(io_fds[k][0], F_SETFL, fcntl(io_fds[k][0], F_GETFL) | O_NONBLOCK);
+		fcntl(io_fds[k][1], F_SETFL, fcntl(io_fds[k][1], F_GETFL) | O_NONBLOCK);
+
+		ret = __async((uintptr_t)_io_reader, "d", k, 0, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+		if (ret < 0)
+			return ret;
+
+		ret = __async((uintptr_t)_io_writer, "d", k, 0, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+		if (ret < 0)
+			return ret;
+	}
+
+	int64_t t0 = gettime();
+
+	ret = co_sched_run(sched);
+	if (ret < 0)
+		return ret;
+
+	printf("io: %ld / %d pairs ok, %ld errors, %ld ms\n",
+			io_ok, IO_PAIRS, io_errors, (long)(gettime() - t0) / 1000);
+
+	if (IO_PAIRS != io_ok || io_errors > 0)
+		return -1;
+
+	return co_sched_close(sched);
+}
+
+// 别的线程都睡在没有超时的 epoll_wait() 里, 新任务要靠 eventfd 叫醒它们
+#define WAKE_ROUNDS     20
+#define WAKE_MAX_USEC   10000
+
+static int64_t wake_max   = 0;
+static long    wake_count = 0;
+
+static int _wake_child(long t0)
+{
+	int64_t d = gettime() - t0;
+
+	if (d > wake_max)
+		wake_max = d;
+
+	__atomic_add_fetch(&wake_count, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static int _wake_parent()
+{
+	int i;
+
+	for (i = 0; i < WAKE_ROUNDS; i++) {
+		__async_msleep(5);
+
+		int ret = __async((uintptr_t)_wake_child, "d", gettime(), 0, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+		if (ret < 0) {
+			loge("\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int _sched_wakeup()
+{
+	co_sched_t* sched = NULL;
+
+	int ret = co_sched_open(&sched, SCHED_THREADS);
+	if (ret < 0)
+		return ret;
+
+	ret = __async((uintptr_t)_wake_parent, "", 0, 0, 0, 0, NULL, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+	if (ret < 0)
+		return ret;
+
+	// 所有任务结束后空闲的线程也要被叫醒退出, 否则这里不会返回
+	ret = co_sched_run(sched);
+	if (ret < 0)
+		return ret;
+
+	printf("wakeup: %ld spawns, max latency %ld us\n", wake_count, (long)wake_max);
+
+	if (WAKE_ROUNDS != wake_count || wake_max > WAKE_MAX_USEC)
+		return -1;
+
+	return co_sched_close(sched);
+}
+
+int main()
+{
+	// 丢了唤醒的线程会一直睡, 超时就当失败
+	alarm(60);
+
+	if (_sched_stress() < 0) {
+		loge("stress test failed\n");
+		return -1;
+	}
+
+	if (_sched_io() < 0) {
+		loge("io test failed\n");
+		return -1;
+	}
+
+	if (_sched_wakeup() < 0) {
+		loge("wakeup test failed\n");
+		return -1;
+	}
+
+	printf("sched test ok\n");
+	return 0;
+}
@@ -0,0 +1,197 @@
+#include"coroutine.h"
+
+/*
+ * 每个线程一个分层时间轮, 加入和删除都是 O(1) 的链表操作
+ *
+ * 定时器按到期的 tick 和当前 tick 的差放到某一层: 差 < 64 放第 0 层, < 64^2 放第 1 层, ...,
+ * 格子的下标是到期 tick 在这一层的那 6 位. 第 0 层转到下标 0 时, 把第 1 层当前的格子重新放一次(级联),
+ * 第 1 层也到了下标 0 就继续级联第 2 层, 依此类推
+ *
+ * task->time 是精确到 us 的到期时间, 同一个 tick 里还没到期的留在格子里, 下次再看
+ */
+
+#define CO_WHEEL_MASK (CO_WHEEL_SLOTS - 1)
+
+void __co_wheel_init(co_wheel_t* w, int64_t now)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < CO_WHEEL_LEVELS; i++) {
+		for (j = 0; j < CO_WHEEL_SLOTS; j++)
+			list_init(&w->slots[i][j]);
+	}
+
+	w->tick     = now / CO_WHEEL_TICK;
+	w->n_timers = 0;
+}
+
+static void _co_wheel_place(co_wheel_t* w, co_task_t* task)
+{
+	int64_t t = task->time / CO_WHEEL_TICK;
+	int64_t d = t - w->tick;
+	int     level;
+
+	if (d < 0) {
+		t = w->tick;
+		d = 0;
+	}
+
+	for (level = 0; level < CO_WHEEL_LEVELS - 1; level++) {
+		if (d < 1LL << (CO_WHEEL_BITS * (level + 1)))
+			break;
+	}
+
+	if (d >= 1LL << (CO_WHEEL_BITS * CO_WHEEL_LEVELS))
+		t = w->tick + (1LL << (CO_WHEEL_BITS * CO_WHEEL_LEVELS)) - 1;
+
+	int i = (t >> (CO_WHEEL_BITS * level)) & CO_WHEEL_MASK;
+
+	list_add_tail(&w->slots[level][i], &task->timer);
+}
+
+static void _co_wheel_cascade(co_wheel_t* w, int level)
+{
+	if (level >= CO_WHEEL_LEVELS)
+		return;
+
+	int i = (w->tick >> (CO_WHEEL_BITS * level)) & CO_WHEEL_MASK;
+
+	list_t  h;
+	list_init(&h);
+	list_mov2(&h, &w->slots[level][i]);
+	list_init(&w->slots[level][i]);
+
+	while (!list_empty(&h)) {
+		co_task_t* task = list_data(list_head(&h), co_task_t, timer);
+
+		list_del(&task->timer);
+
+		_co_wheel_place(w, task);
+	}
+
+	if (0 == i)
+		_co_wheel_cascade(w, level + 1);
+}
+
+void __co_timer_add(co_thread_t* thread, co_task_t* task, int64_t time)
+{
+	co_wheel_t* w = &thread->wheel;
+
+	if (task->time > 0)
+		list_del(&task->timer);
+	else
+		w->n_timers++;
+
+	task->time = time;
+
+	_co_wheel_place(w, task);
+}
+
+void __co_timer_del(co_thread_t* thread, co_task_t* task)
+{
+	if (task->time > 0) {
+		list_del(&task->timer);
+		task->time = 0;
+
+		thread->wheel.n_timers--;
+	}
+}
+
+// 到期的任务挂到 due 上, 它们的 time 由调用者清零
+void __co_timer_expire(co_thread_t* thread, int64_t now, list_t* due)
+{
+	co_wheel_t* w  = &thread->wheel;
+	int64_t     nt = now / CO_WHEEL_TICK;
+
+	if (0 == w->n_timers) {
+		if (w->tick < nt)
+			w->tick = nt;
+		return;
+	}
+
+	while (w->tick <= nt) {
+		int i = w->tick & CO_WHEEL_MASK;
+
+		if (0 == i)
+			_co_wheel_cascade(w, 1);
+
+		list_t* h = &w->slots[0][i];
+		list_t* l = list_head(h);
+
+		while (l != list_sentinel(h)) {
+			co_task_t* task = list_data(l, co_task_t, timer);
+			l = list_next(l);
+
+			if (task->time <= now) {
+				list_del(&task->timer);
+				list_add_tail(due, &task->timer);
+
+				w->n_timers--;
+			}
+		}
+
+		if (w->tick == nt)
+			break;
+		w->tick++;
+	}
+}
+
+// 下一个到期时间的下界, us, 没有定时器时返回 -1
+// 第 0 层给出精确的时间, 更高的层给出级联的时间, 取各层中最早的, 到时级联以后再算
+int64_t __co_timer_next(co_thread_t* thread)
+{
+	co_wheel_t* w = &thread->wheel;
+
+	if (0 == w->n_timers)
+		return -1;
+
+	int64_t min = -1;
+	int     i;
+
+	for (i = 0; i < CO_WHEEL_SLOTS && min < 0; i++) {
+		list_t* h = &w->slots[0][(w->tick + i) & CO_WHEEL_MASK];
+		list_t* l;
+
+		for (l = list_head(h); l != list_sentinel(h); l = list_next(l)) {
+			co_task_t* task = list_data(l, co_task_t, timer);
+
+			if (min < 0 || task->time < min)
+				min = task->time;
+		}
+	}
+
+	int level;
+	for (level = 1; level < CO_WHEEL_LEVELS; level++) {
+
+		int64_t t = w->tick >> (CO_WHEEL_BITS * level);
+
+		for (i = 1; i <= CO_WHEEL_SLOTS; i++) {
+			if (!list_empty(&w->slots[level][(t + i) & CO_WHEEL_MASK])) {
+
+				int64_t c = ((t + i) << (CO_WHEEL_BITS * level)) * CO_WHEEL_TICK;
+
+				if (min < 0 || c < min)
+					min = c;
+				break;
+			}
+		}
+	}
+
+	return min;
+}
+
+int __co_timerfd_arm(co_thread_t* thread, int64_t usec)
+{
+	struct itimerspec its = {0};
+
+	its.it_value.tv_sec  = usec / 1000000;
+	its.it_value.tv_nsec = usec % 1000000 * 1000;
+
+	if (timerfd_settime(thread->tfd, 0, &its, NULL) < 0) {
+		loge("timerfd_settime, errno: %d\n", errno);
+		return -errno;
+	}
+
+	return 0;
+}
@@ -80,6 +80,12 @@ int __elf_file_open(elf_file_t** pfile)
 		goto text_relas_error;
 	}
 
+	ef->rodata_relas = vector_alloc();
+	if (!ef->rodata_relas) {
+		ret = -ENOMEM;
+		goto rodata_relas_error;
+	}
+
 	ef->data_relas = vector_alloc();
 	if (!ef->data_relas) {
 		ret = -ENOMEM;
@@ -112,6 +118,8 @@ debug_info_relas_error:
 debug_line_relas_error:
 	vector_free(ef->data_relas);
 data_relas_error:
+	vector_free(ef->rodata_relas);
+rodata_relas_error:
 	vector_free(ef->text_relas);
 text_relas_error:
 	vector_free(ef->syms);
@@ -225,10 +233,12 @@ int elf_file_close(elf_file_t* ef, void (*rela_free)(void*), void (*sym_free)(vo
 	string_free(ef->debug_str);
 
 	vector_clear(ef->text_relas,       rela_free);
+	vector_clear(ef->rodata_relas,     rela_free);
 	vector_clear(ef->data_relas,       rela_free);
 	vector_clear(ef->debug_line_relas, rela_free);
 
 	vector_free (ef->text_relas);
+	vector_free (ef->rodata_relas);
 	vector_free (ef->data_relas);
 	vector_free (ef->debug_line_relas);
 
@@ -298,6 +308,7 @@ int elf_file_read(elf_file_t* ef)
 	} while(0);
 
 	ELF_READ_RELAS(text);
+	ELF_READ_RELAS(rodata);
 	ELF_READ_RELAS(data);
 	ELF_READ_RELAS(debug_info);
 	ELF_READ_RELAS(debug_line);
@@ -400,6 +411,12 @@ static int ar_symbols(ar_file_t* ar)
 			goto error;
 		}
 
+		sym->id = string_intern(sym->name);
+		if (!sym->id) {
+			ret = -ENOMEM;
+			goto error;
+		}
+
 		j += k + 1;
 	}
 
@@ -584,6 +601,7 @@ static int merge_obj(elf_file_t* exec, elf_file_t* obj, const int bits)
 		} while (0)
 
 		MERGE_RELAS(exec->text_relas,       obj->text_relas,       exec->text->len);
+		MERGE_RELAS(exec->rodata_relas,     obj->rodata_relas,     exec->rodata->len);
 		MERGE_RELAS(exec->data_relas,       obj->data_relas,       exec->data->len);
 		MERGE_RELAS(exec->debug_line_relas, obj->debug_line_relas, exec->debug_line->len);
 		MERGE_RELAS(exec->debug_info_relas, obj->debug_info_relas, exec->debug_info->len);
@@ -691,7 +709,7 @@ static int _find_sym(elf_sym_t** psym, elf_rela_t* rela, vector_t* symbols, cons
 			if (STB_LOCAL == ELF64_ST_BIND(sym2->st_info))
 				continue;
 
-			if (!strcmp(sym2->name, sym->name)) {
+			if (elf_sym_id(sym2) == elf_sym_id(sym)) {
 				sym     = sym2;
 				sym_idx = j + 1;
 				n++;
@@ -723,7 +741,7 @@ static int _find_lib_sym(ar_file_t** par, uint32_t* poffset, uint32_t* psize, ve
 		for (k   = 0; k < ar->symbols->size; k++) {
 			asym =        ar->symbols->data[k];
 
-			if (!strcmp(sym->name, asym->name->data))
+			if (elf_sym_id(sym) == asym->id)
 				break;
 		}
 
@@ -826,7 +844,7 @@ static int _find_so_sym(elf_file_t** pso, vector_t* dlls, elf_sym_t* sym)
 			if (0 == sym2->st_shndx)
 				continue;
 
-			if (!strcmp(sym->name, sym2->name))
+			if (elf_sym_id(sym) == elf_sym_id(sym2))
 				break;
 		}
 
@@ -934,7 +952,7 @@ static int link_relas(elf_file_t* exec, char* afiles[], int nb_afiles, char* sof
 		for (j = 0; j < exec->dyn_syms->size; j++) {
 			sym2      = exec->dyn_syms->data[j];
 
-			if (!strcmp(sym2->name, sym->name))
+			if (elf_sym_id(sym2) == elf_sym_id(sym))
 				break;
 		}
 
@@ -1179,6 +1197,7 @@ int elf_link(vector_t* objs, vector_t* afiles, vector_t* sofiles, const char* sy
 	} while(0)
 
 	ADD_RELA_SECTION(text,       ELF_FILE_SHNDX(text));
+	ADD_RELA_SECTION(rodata,     ELF_FILE_SHNDX(rodata));
 	ADD_RELA_SECTION(data,       ELF_FILE_SHNDX(data));
 	ADD_RELA_SECTION(debug_info, ELF_FILE_SHNDX(debug_info));
 	ADD_RELA_SECTION(debug_line, ELF_FILE_SHNDX(debug_line));
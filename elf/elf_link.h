@@ -31,6 +31,7 @@ typedef struct {
 	vector_t*      syms;
 
 	vector_t*      text_relas;
+	vector_t*      rodata_relas; // switch 跳转表里的代码地址
 	vector_t*      data_relas;
 
 	vector_t*      debug_line_relas;
@@ -46,6 +47,7 @@ typedef struct {
 
 typedef struct {
 	string_t*      name;
+	string_t*      id;     // name 驻留后的结果
 	uint32_t           offset;
 
 } ar_sym_t;
@@ -4,12 +4,14 @@
 #include<elf.h>
 #include"utils_list.h"
 #include"utils_vector.h"
+#include"utils_string.h"
 
 typedef struct elf_context_s	elf_context_t;
 typedef struct elf_ops_s		elf_ops_t;
 
 typedef struct {
 	char*		name;
+	string_t*   id;      // name 驻留后的结果，按名字比较符号时直接比较指针
 	uint64_t    st_size;
 	Elf64_Addr  st_value;
 
@@ -19,6 +21,13 @@ typedef struct {
 	uint8_t     dyn_flag:1;
 } elf_sym_t;
 
+static inline string_t* elf_sym_id(elf_sym_t* sym)
+{
+	if (!sym->id && sym->name)
+		sym->id = string_intern_cstr(sym->name);
+	return sym->id;
+}
+
 typedef struct {
 	char*		name;
 
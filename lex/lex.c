@@ -1,5 +1,9 @@
 #include "lex.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
 // 关键词表
 static key_word_t key_words[] = {
     {"if", LEX_WORD_KEY_IF},
@@ -89,14 +93,65 @@ static escape_char_t escape_chars[] = {
     {'0', '\0'},
 };
 
-// 挨个关键字进行比对
-static int _find_key_word(const char *text) {
+// 关键字完美哈希: 由长度、首字符、末字符、倒数第 3 个字符计算槽位，
+// 系数是对 key_words[] 离线搜索得到的，保证所有关键字互不冲突，增删关键字后需要重新搜索
+#define KEY_WORD_HASH_SIZE 256
+#define KEY_WORD_MAX_LEN   9
+
+static uint8_t key_word_slots[KEY_WORD_HASH_SIZE]; // 槽位 -> key_words[] 下标 + 1，0 表示空槽
+static uint8_t key_word_lens [KEY_WORD_HASH_SIZE]; // 槽位里关键字的长度，先比长度再比字节，不会读过短的字面量
+static int key_word_slots_err = 0;
+
+static pthread_once_t key_word_once = PTHREAD_ONCE_INIT;
+
+static inline int _key_word_hash(const char *text, size_t len) {
+    const uint8_t *p = (const uint8_t *)text;
+
+    int mid = len >= 3 ? p[len - 3] : 0;
+
+    return (len + p[0] + 6 * p[len - 1] + 11 * mid) & (KEY_WORD_HASH_SIZE - 1);
+}
+
+// 由 lex_open() 通过 pthread_once() 调用一次，关键字太长或者槽位冲突时 lex_open() 返回错误
+static void _key_word_slots_init() {
     int i;
     for (i = 0; i < sizeof(key_words) / sizeof(key_words[0]); i++) {
-        if (!strcmp(key_words[i].text, text))
-            return key_words[i].type;
+        size_t len = strlen(key_words[i].text);
+        int h = _key_word_hash(key_words[i].text, len);
+
+        if (len > KEY_WORD_MAX_LEN) {
+            loge("key word '%s' longer than %d\n", key_words[i].text, KEY_WORD_MAX_LEN);
+            key_word_slots_err = -EINVAL;
+            return;
+        }
+
+        if (0 != key_word_slots[h]) {
+            loge("key word '%s' and '%s' in the same slot %d, search the hash coefficients again\n",
+                 key_words[i].text, key_words[key_word_slots[h] - 1].text, h);
+            key_word_slots_err = -EINVAL;
+            return;
+        }
+
+        key_word_slots[h] = i + 1;
+        key_word_lens[h] = len;
     }
+}
 
+// 查关键字，一次哈希 + 一次比较
+static int _find_key_word(const char *text, size_t len) {
+    if (0 == len || len > KEY_WORD_MAX_LEN)
+        return -1;
+
+    int h = _key_word_hash(text, len);
+    int i = key_word_slots[h];
+
+    if (0 == i || key_word_lens[h] != len)
+        return -1;
+
+    key_word_t *kw = &key_words[i - 1];
+
+    if (!memcmp(kw->text, text, len))
+        return kw->type;
     return -1;
 }
 
@@ -112,11 +167,48 @@ static int _find_escape_char(const int c) {
     return c;
 }
 
+// 把整个源文件映射到 lex->buf，mmap 失败时一次性 fread 进来
+// 管道等非普通文件以及空文件保持 buf 为 NULL，仍走 fgetc 逐字符读取
+static int _lex_load_file(lex_t *lex) {
+    struct stat st;
+
+    if (fstat(fileno(lex->fp), &st) < 0 || !S_ISREG(st.st_mode) || 0 == st.st_size)
+        return 0;
+
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(lex->fp), 0);
+    if (MAP_FAILED != p) {
+        lex->buf = p;
+        lex->buf_len = st.st_size;
+        lex->buf_mmap = 1;
+        return 0;
+    }
+
+    lex->buf = malloc(st.st_size);
+    if (!lex->buf)
+        return -ENOMEM;
+
+    if (fread(lex->buf, st.st_size, 1, lex->fp) != 1) {
+        loge("read file '%s' failed, errno: %d\n", lex->file->data, errno);
+
+        free(lex->buf);
+        lex->buf = NULL;
+        return -EIO;
+    }
+
+    lex->buf_len = st.st_size;
+    return 0;
+}
+
 // 根据参数 path 读取到 plex
 int lex_open(lex_t **plex, const char *path) { 
     if (!plex || !path)
         return -EINVAL; // 错误参数
 
+    // 关键字哈希表只建一次，多个线程同时打开文件也安全
+    pthread_once(&key_word_once, _key_word_slots_init);
+    if (key_word_slots_err < 0)
+        return key_word_slots_err;
+
     // 分配一个 lex_t 空间
     lex_t *lex = calloc(1, sizeof(lex_t));
     printf("%p",lex);
@@ -144,6 +236,15 @@ int lex_open(lex_t **plex, const char *path) {
         return -ENOMEM;
     }
 
+    // 普通文件整块读入，之后从 buf 直接解码，不再逐字符 fgetc + calloc
+    int ret = _lex_load_file(lex);
+    if (ret < 0) {
+        string_free(lex->file);
+        fclose(lex->fp);
+        free(lex);
+        return ret;
+    }
+
     // 个人习惯而言，有的喜欢用 0 作为开始，有的喜欢用 1 作为开始
     lex->nb_lines = 1;
     *plex = lex;
@@ -163,6 +264,13 @@ int lex_close(lex_t *lex) {
 
         string_free(lex->file);
 
+        if (lex->buf) {
+            if (lex->buf_mmap)
+                munmap(lex->buf, lex->buf_len);
+            else
+                free(lex->buf);
+        }
+
         fclose(lex->fp);
         free(lex);
     }
@@ -207,7 +315,7 @@ static int _lex_plus(lex_t *lex, lex_word_t **pword, char_t *c0) {
 
         *pword = w;
 
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else if ('=' == c1->c) { // 两个符号 +=
                                // 先分配一个 word
@@ -218,7 +326,7 @@ static int _lex_plus(lex_t *lex, lex_word_t **pword, char_t *c0) {
         lex->pos += 2;
         //
         *pword = w;
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else { // 一个char +
         _lex_push_char(lex, c1);
@@ -230,7 +338,7 @@ static int _lex_plus(lex_t *lex, lex_word_t **pword, char_t *c0) {
 
         *pword = w;
     }
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
     return 0;
 }
@@ -257,7 +365,7 @@ static int _lex_minus(lex_t *lex, lex_word_t **pword, char_t *c0) {
         lex->pos += 2;
 
         *pword = w;
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else if ('>' == c1->c) {
         lex_word_t *w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_ARROW);
@@ -265,7 +373,7 @@ static int _lex_minus(lex_t *lex, lex_word_t **pword, char_t *c0) {
         lex->pos += 2;
 
         *pword = w;
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else if ('=' == c1->c) {
         lex_word_t *w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_SUB_ASSIGN);
@@ -273,7 +381,7 @@ static int _lex_minus(lex_t *lex, lex_word_t **pword, char_t *c0) {
         lex->pos += 2;
 
         *pword = w;
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else {
         _lex_push_char(lex, c1);
@@ -286,7 +394,7 @@ static int _lex_minus(lex_t *lex, lex_word_t **pword, char_t *c0) {
         *pword = w;
     }
 
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
     return 0;
 }
@@ -304,7 +412,7 @@ static int _lex_number(lex_t *lex, lex_word_t **pword, char_t *c0) {
         s = string_cstr_len(c0->utf8, 1);
         lex->pos++;
 
-        free(c0);
+        _lex_free_char(lex, c0);
         c0 = NULL;
         // 吐出 第二个char
         c1 = _lex_pop_char(lex);
@@ -351,7 +459,7 @@ static int _lex_number(lex_t *lex, lex_word_t **pword, char_t *c0) {
             return _lex_number_base_8(lex, pword, s);
             break;
         }
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
         return ret;
     }
@@ -360,6 +468,7 @@ static int _lex_number(lex_t *lex, lex_word_t **pword, char_t *c0) {
     s = string_alloc();
     _lex_push_char(lex, c0);
     c0 = NULL;
+    return _lex_number_base_10(lex, pword, s);
 }
 
 // 标识符
@@ -367,7 +476,7 @@ static int _lex_identity(lex_t *lex, lex_word_t **pword, char_t *c0) {
     string_t *s = string_cstr_len(c0->utf8, c0->len);
 
     lex->pos += c0->len;
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
 
     while (1) {
@@ -381,7 +490,7 @@ static int _lex_identity(lex_t *lex, lex_word_t **pword, char_t *c0) {
             string_cat_cstr_len(s, c1->utf8, c1->len);
             lex->pos += c1->len;
 
-            free(c1);
+            _lex_free_char(lex, c1);
             c1 = NULL;
         } else {
             _lex_push_char(lex, c1);
@@ -407,11 +516,13 @@ static int _lex_identity(lex_t *lex, lex_word_t **pword, char_t *c0) {
             } else if (!strcmp(s->data, "__func__")) {
                 w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_CONST_STRING);
             } else {
-                int type = _find_key_word(s->data);
+                int type = _find_key_word(s->data, s->len);
 
-                if (-1 == type)
+                if (-1 == type) {
                     w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_ID);
-                else
+                    if (w)
+                        w->id = string_intern(s);
+                } else
                     w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, type);
             }
 
@@ -453,7 +564,7 @@ static int _lex_char(lex_t *lex, lex_word_t **pword, char_t *c0) {
         } else
             loge("const char lost 2nd ' in file: %s, line: %d\n", lex->file->data, lex->nb_lines);
 
-        free(c3);
+        _lex_free_char(lex, c3);
         c3 = NULL;
 
     } else if ('\'' == c2->c) {
@@ -469,9 +580,9 @@ static int _lex_char(lex_t *lex, lex_word_t **pword, char_t *c0) {
     } else
         loge("const char lost 2nd ' in file: %s, line: %d\n", lex->file->data, lex->nb_lines);
 
-    free(c0);
-    free(c1);
-    free(c2);
+    _lex_free_char(lex, c0);
+    _lex_free_char(lex, c1);
+    _lex_free_char(lex, c2);
 
     if (!w)
         return -1;
@@ -502,7 +613,7 @@ static int _lex_string(lex_t *lex, lex_word_t **pword, char_t *c0) {
             lex->pos++;
             *pword = w;
 
-            free(c1);
+            _lex_free_char(lex, c1);
             c1 = NULL;
             return 0;
 
@@ -515,8 +626,8 @@ static int _lex_string(lex_t *lex, lex_word_t **pword, char_t *c0) {
             string_cat_cstr_len(s, c2->utf8, c2->len);
             lex->pos += 1 + c2->len;
 
-            free(c2);
-            free(c1);
+            _lex_free_char(lex, c2);
+            _lex_free_char(lex, c1);
             c2 = NULL;
             c1 = NULL;
 
@@ -531,7 +642,7 @@ static int _lex_string(lex_t *lex, lex_word_t **pword, char_t *c0) {
                         string_cat_cstr_len(s, c1->utf8, 1);
                         lex->pos++;
 
-                        free(c1);
+                        _lex_free_char(lex, c1);
                         c1 = NULL;
                     } else {
                         _lex_push_char(lex, c1);
@@ -552,12 +663,31 @@ static int _lex_string(lex_t *lex, lex_word_t **pword, char_t *c0) {
             string_cat_cstr_len(d, c1->utf8, c1->len);
             lex->pos += c1->len;
 
-            free(c1);
+            _lex_free_char(lex, c1);
             c1 = NULL;
         }
     }
 }
 
+// 整块读入模式: 不用把整行字符取出再推回，只需记下宏定义行尾 '\n' 的位置
+static int _lex_macro_buf(lex_t *lex) {
+    size_t i = lex->buf_pos;
+
+    while (i < lex->buf_len) {
+        if ('\n' == lex->buf[i])
+            break;
+
+        // '\' 续行，跳过紧跟的字符
+        if ('\\' == lex->buf[i])
+            i++;
+        i++;
+    }
+
+    if (i < lex->buf_len)
+        lex->buf_lf = i + 1;
+    return 0;
+}
+
 // 宏定义
 static int _lex_macro(lex_t *lex) {
     char_t *h = NULL;
@@ -565,6 +695,9 @@ static int _lex_macro(lex_t *lex) {
     char_t *c;
     char_t *c2;
 
+    if (lex->buf)
+        return _lex_macro_buf(lex);
+
     while (1) {
         c = _lex_pop_char(lex);
         if (!c) {
@@ -620,7 +753,7 @@ static void _lex_drop_to(lex_t *lex, int c0, int c1) {
         }
 
         int tmp = c->c;
-        free(c);
+        _lex_free_char(lex, c);
         c = NULL;
 
         if ('\n' == tmp) {
@@ -635,7 +768,7 @@ static void _lex_drop_to(lex_t *lex, int c0, int c1) {
             c = _lex_pop_char(lex);
 
             if (c1 == c->c) {
-                free(c);
+                _lex_free_char(lex, c);
                 c = NULL;
                 break;
             }
@@ -671,14 +804,14 @@ int __lex_pop_word(lex_t *lex, lex_word_t **pword) {
                 w->text = string_cstr("LF");
                 *pword = w;
 
-                free(c);
+                _lex_free_char(lex, c);
                 c = NULL;
                 return 0;
             }
         } else
             lex->pos++;
 
-        free(c);
+        _lex_free_char(lex, c);
         c = _lex_pop_char(lex);
     }// 到这里，相当于一个单词结束了
 
@@ -689,7 +822,7 @@ int __lex_pop_word(lex_t *lex, lex_word_t **pword) {
 
         *pword = w;
 
-        free(c);
+        _lex_free_char(lex, c);
         c = NULL;
         return 0;
     }
@@ -728,8 +861,8 @@ int __lex_pop_word(lex_t *lex, lex_word_t **pword) {
             break;
         };
 
-        free(c);
-        free(c2);
+        _lex_free_char(lex, c);
+        _lex_free_char(lex, c2);
         c = NULL;
         c2 = NULL;
 
@@ -875,7 +1008,7 @@ int __lex_pop_word(lex_t *lex, lex_word_t **pword) {
     if ('#' == c->c) {
         w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_HASH);
 
-        free(c);
+        _lex_free_char(lex, c);
         c = _lex_pop_char(lex);
 
         if ('#' == c->c) {
@@ -883,7 +1016,7 @@ int __lex_pop_word(lex_t *lex, lex_word_t **pword) {
             w->text = string_cstr("##");
 
             lex->pos += 2;
-            free(c);
+            _lex_free_char(lex, c);
         } else {
             w->text = string_cstr("#");
 
@@ -1212,7 +1345,7 @@ static macro_t *__find_macro(lex_t *lex, lex_word_t *w) {
     for (i = lex->macros->size - 1; i >= 0; i--) {
         m = lex->macros->data[i];
 
-        if (!string_cmp(m->w->text, w->text))
+        if (lex_word_id(m->w) == lex_word_id(w))
             return m;
     }
 
@@ -1262,7 +1395,7 @@ static int __use_macro(lex_t *lex, macro_t *m, lex_word_t *use) {
             for (i = 0; i < m->argv->size; i++) {
                 w = m->argv->data[i];
 
-                if (!string_cmp(w->text, p->text))
+                if (lex_word_id(w) == lex_word_id(p))
                     break;
             }
 
@@ -1349,6 +1482,7 @@ static int __use_hash2(lex_t *lex, lex_word_t *prev) {
     switch (after->type) {
     case LEX_WORD_ID:
         ret = string_cat(prev->text, after->text);
+        prev->id = NULL;
         break;
 
     default:
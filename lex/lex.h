@@ -24,6 +24,9 @@ typedef struct
 #define UTF8_MAX 6
 #define UTF8_LF 1
 
+// 整块读入模式下，同时在用的 char_t 个数上限(词法分析最多同时持有 4 个字符)
+#define LEX_CHAR_RING 8
+
 // 表示一个字符单元
 /*
 一个字母的存储，而utf8存储的是他的码点
@@ -36,6 +39,7 @@ struct char_s {
                             // ‘a’ UTF-8 长度是1   ‘中’ UTF-8 长度是3
     uint8_t utf8[UTF8_MAX]; // 保存该字符的UTF-8 编码(字节序列)
     uint8_t flag;           // 保存字符的一些标记信息(是否是换行符、是否是空白、是否是标识符的一部分、是否是转义后的字符)
+    size_t offset;          // 整块读入模式下，该字符在 buf 中的起始偏移，push 回去时游标回退到这里
 };
 
 // 编译器前端 词法分析器lexer 的核心上下文结构体，用于保存 源代码扫描的状态
@@ -50,6 +54,15 @@ struct lex_s {
     FILE *fp; // 标准 C 的文件指针，指向正在读取的源代码文件
               // 从文件流中读字符，逐个填入 char_list
 
+    uint8_t *buf;    // 整块读入模式: 整个源文件的内容(mmap 映射或一次性读入)，为 NULL 时退回 fgetc 逐字符读取
+    size_t buf_len;  // buf 的字节数
+    size_t buf_pos;  // 解码游标，UTF-8 从这里开始解码，push 回字符就是把游标回退
+    size_t buf_lf;   // 宏定义所在行尾 '\n' 的偏移 + 1，解码到这里时打上 UTF8_LF 标记，0 表示没有
+    int buf_mmap;    // buf 是否由 mmap 得到，决定关闭时用 munmap 还是 free
+
+    char_t chars[LEX_CHAR_RING]; // 整块读入模式下循环复用的字符单元，不再为每个字符分配堆内存
+    int char_idx;                // 下一个可用的 chars[] 下标
+
     string_t *file; // 保存源代码的文件名
     int nb_lines;   // 记录源代码的总行数，用于错误信息、调试信息，lexer在扫描过程中会不断更新这个值
     int pos;        // 当前位置，通常表示在当前行或整个文件中的 字符索引
@@ -59,6 +72,8 @@ struct lex_s {
 char_t *_lex_pop_char(lex_t *lex);
 // 往 lex 推一个char
 void _lex_push_char(lex_t *lex, char_t *c);
+// 释放一个 char，整块读入模式下的字符不需要释放
+void _lex_free_char(lex_t *lex, char_t *c);
 
 // 打开 lex
 int lex_open(lex_t **plex, const char *path);
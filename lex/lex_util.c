@@ -17,6 +17,83 @@
     第二次 fgetc(fp) = 0xB8
     第三次 fgetc(fp) = 0xAD
 */
+// 整块读入模式: 从 buf 的游标处解码一个 UTF-8 字符，字符单元取自 lex->chars[] 循环复用
+static char_t *_lex_pop_char_buf(lex_t *lex) {
+    char_t *c = &lex->chars[lex->char_idx];
+
+    lex->char_idx = (lex->char_idx + 1) % LEX_CHAR_RING;
+
+    c->next = NULL;
+    c->offset = lex->buf_pos;
+    c->flag = 0;
+
+    if (lex->buf_pos >= lex->buf_len) {
+        c->c = EOF;
+        c->len = 0;
+        return c;
+    }
+
+    const uint8_t *p = lex->buf + lex->buf_pos;
+    int ret = p[0];
+
+    if (ret < 0x80) {
+        c->c = ret;
+        c->len = 1;
+        c->utf8[0] = ret;
+
+        if ('\n' == ret && lex->buf_pos + 1 == lex->buf_lf)
+            c->flag = UTF8_LF;
+
+        lex->buf_pos++;
+        return c;
+    }
+
+    if (0x6 == (ret >> 5)) {
+        c->c = ret & 0x1f;
+        c->len = 2;
+    } else if (0xe == (ret >> 4)) {
+        c->c = ret & 0xf;
+        c->len = 3;
+    } else if (0x1e == ret >> 3) {
+        c->c = ret & 0x7;
+        c->len = 4;
+    } else if (0x3e == (ret >> 2)) {
+        c->c = ret & 0x3;
+        c->len = 5;
+    } else if (0x7e == (ret >> 1)) {
+        c->c = ret & 0x1;
+        c->len = 6;
+    } else {
+        loge("utf8 first byte wrong %#x, file: %s, line: %d\n", ret, lex->file->data, lex->nb_lines);
+        return NULL;
+    }
+
+    if (lex->buf_pos + c->len > lex->buf_len) {
+        loge("utf8 char truncated at end of file: %s, line: %d\n", lex->file->data, lex->nb_lines);
+        return NULL;
+    }
+
+    c->utf8[0] = ret;
+
+    int i;
+    for (i = 1; i < c->len; i++) {
+        ret = p[i];
+
+        if (0x2 == (ret >> 6)) {
+            c->c <<= 6;
+            c->c |= ret & 0x3f;
+
+            c->utf8[i] = ret;
+        } else {
+            loge("utf8 byte[%d] wrong %#x, file: %s, line: %d\n", i + 1, ret, lex->file->data, lex->nb_lines);
+            return NULL;
+        }
+    }
+
+    lex->buf_pos += c->len;
+    return c;
+}
+
 // 从 lex_t 吐出一个char
 char_t *_lex_pop_char(lex_t *lex) {
     assert(lex);
@@ -24,6 +101,9 @@ char_t *_lex_pop_char(lex_t *lex) {
 
     char_t *c;
 
+    if (lex->buf)
+        return _lex_pop_char_buf(lex);
+
     if (lex->char_list) {
         c = lex->char_list;
         lex->char_list = c->next;
@@ -96,10 +176,24 @@ void _lex_push_char(lex_t *lex, char_t *c) {
     assert(lex);
     assert(c);
 
+    // 整块读入模式下 push 回去只是把游标回退到该字符的起始位置
+    if (lex->buf) {
+        assert(c->offset <= lex->buf_pos);
+        lex->buf_pos = c->offset;
+        return;
+    }
+
     c->next = lex->char_list;
     lex->char_list = c;
 }
 
+// 释放一个char_t
+void _lex_free_char(lex_t *lex, char_t *c) {
+    // chars[] 里的字符单元属于 lex 自身，循环复用
+    if (c && (c < lex->chars || c >= lex->chars + LEX_CHAR_RING))
+        free(c);
+}
+
 // 处理单字符运算符，比如+ - * 、 ( )
 int _lex_op1_ll1(lex_t *lex, lex_word_t **pword, char_t *c0, int type0) {
     // 用C0(已经读出的第一个字符)创建字符串s
@@ -113,7 +207,7 @@ int _lex_op1_ll1(lex_t *lex, lex_word_t **pword, char_t *c0, int type0) {
     // 释放 c0，返回 token
     s = NULL;
     // 释放 c0
-    free(c0);
+    _lex_free_char(lex, c0);
     // 将 c0置为空
     c0 = NULL;
     // 设置词法单元链表的元素为 w 词法单元
@@ -142,7 +236,7 @@ int _lex_op2_ll1(lex_t *lex, lex_word_t **pword, char_t *c0, int type0, char *ch
 
         w->type = types[i];
         lex->pos += c1->len;
-        free(c1);
+        _lex_free_char(lex, c1);
     } else // 如果不匹配：把 c1 推回输入流，保持原样
         _lex_push_char(lex, c1);
     // 最终 token w->text = 单字符或双字符
@@ -151,7 +245,7 @@ int _lex_op2_ll1(lex_t *lex, lex_word_t **pword, char_t *c0, int type0, char *ch
     w->text = s;
     s = NULL;
 
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
 
     *pword = w;
@@ -187,7 +281,7 @@ int _lex_op3_ll1(lex_t *lex, lex_word_t **pword, char_t *c0,
             s = NULL;
             lex->pos += c0->len + c1->len + c2->len;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else { // 否则 → 回退 c2，token 类型 = type1（二字符运算符）
@@ -199,7 +293,7 @@ int _lex_op3_ll1(lex_t *lex, lex_word_t **pword, char_t *c0,
             s = NULL;
             lex->pos += c0->len + c1->len;
         }
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
 
     } else if (ch1_1 == c1->c) { // case2: 如果 c1 == ch1_1
@@ -211,7 +305,7 @@ int _lex_op3_ll1(lex_t *lex, lex_word_t **pword, char_t *c0,
         s = NULL;
         lex->pos += c0->len + c1->len;
 
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
     } else { // case3: 否则
         // 回退 c1，token 类型 = type3（单字符运算符）
@@ -225,7 +319,7 @@ int _lex_op3_ll1(lex_t *lex, lex_word_t **pword, char_t *c0,
         lex->pos += c0->len;
     }
 
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
     *pword = w;
     return 0;
@@ -296,7 +390,7 @@ int _lex_number_base_10(lex_t *lex, lex_word_t **pword, string_t *s) {
         assert(1 == c2->len);
         string_cat_cstr_len(s, c2->utf8, 1);
         lex->pos++;
-        free(c2);
+        _lex_free_char(lex, c2);
         c2 = NULL;
     }
 
@@ -344,7 +438,7 @@ int _lex_number_base_16(lex_t *lex, lex_word_t **pword, string_t *s) {
             string_cat_cstr_len(s, c2->utf8, 1);
             lex->pos++;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else {
@@ -372,7 +466,7 @@ int _lex_number_base_16(lex_t *lex, lex_word_t **pword, string_t *s) {
         string_cat_cstr_len(s, c2->utf8, 1);
 
         lex->pos++;
-        free(c2);
+        _lex_free_char(lex, c2);
         c2 = NULL;
     }
 }
@@ -393,13 +487,13 @@ int _lex_number_base_8(lex_t *lex, lex_word_t **pword, string_t *s) {
 
             value = (value << 3) + c2->c - '0';
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else if ('8' == c2->c || '9' == c2->c) {
             loge("number must be 0-7 when base 8");
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
             return -1;
 
@@ -407,7 +501,7 @@ int _lex_number_base_8(lex_t *lex, lex_word_t **pword, string_t *s) {
             string_cat_cstr_len(s, c2->utf8, 1);
             lex->pos++;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else {
@@ -446,13 +540,13 @@ int _lex_number_base_2(lex_t *lex, lex_word_t **pword, string_t *s) {
 
             value = (value << 1) + c2->c - '0';
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else if (c2->c >= '2' && c2->c <= '9') {
             loge("number must be 0-1 when base 2");
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
             return -1;
 
@@ -461,7 +555,7 @@ int _lex_number_base_2(lex_t *lex, lex_word_t **pword, string_t *s) {
             string_cat_cstr_len(s, c2->utf8, 1);
             lex->pos++;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
         } else {
@@ -495,12 +589,12 @@ int _lex_double(lex_t *lex, lex_word_t **pword, string_t *s) {
             string_cat_cstr_len(s, c2->utf8, 1);
             lex->pos++;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
         } else if ('.' == c2->c) {
             loge("too many '.' for number in file: %s, line: %d\n", lex->file->data, lex->nb_lines);
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
             return -1;
         } else {
@@ -529,14 +623,14 @@ int _lex_dot(lex_t *lex, lex_word_t **pword, char_t *c0) {
 
     lex->pos += c0->len;
 
-    free(c0);
+    _lex_free_char(lex, c0);
     c0 = NULL;
 
     if ('.' == c1->c) {
         string_cat_cstr_len(s, c1->utf8, 1);
         lex->pos++;
 
-        free(c1);
+        _lex_free_char(lex, c1);
         c1 = NULL;
 
         c2 = _lex_pop_char(lex);
@@ -545,7 +639,7 @@ int _lex_dot(lex_t *lex, lex_word_t **pword, char_t *c0) {
             string_cat_cstr_len(s, c2->utf8, 1);
             lex->pos++;
 
-            free(c2);
+            _lex_free_char(lex, c2);
             c2 = NULL;
 
             w = lex_word_alloc(lex->file, lex->nb_lines, lex->pos, LEX_WORD_VAR_ARGS);
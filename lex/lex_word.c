@@ -93,6 +93,7 @@ lex_word_t* lex_word_clone(lex_word_t* w){
         }
     }
 
+    w1->id = w->id;
     w1->line = w->line;
     w1->pos = w->pos;
     return w1;
@@ -208,6 +208,7 @@ struct lex_word_s {
     } data;
 
     string_t *text; // 原始源码里的字符串(比如 123 if x)
+    string_t *id;   // text 驻留后的结果，属于驻留表，不需要释放；名字判等直接比较 id 指针
     string_t *file; // token 所在的源文件名
     int line;       // 所在行号
     int pos;        // 所在列号
@@ -218,6 +219,13 @@ static inline int lex_is_identity(lex_word_t *w) {
     return LEX_WORD_ID == w->type;
 }
 
+// 取 token 文本的驻留字符串，没有的话现在驻留
+static inline string_t *lex_word_id(lex_word_t *w) {
+    if (!w->id)
+        w->id = string_intern(w->text);
+    return w->id;
+}
+
 // 判断 token 是否是 运算符或符号
 static inline int lex_is_operator(lex_word_t *w) {
     return w->type >= LEX_WORD_PLUS && w->type <= LEX_WORD_DOT;
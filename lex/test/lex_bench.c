@@ -0,0 +1,95 @@
+#include "lex.h"
+
+// 词法分析性能测试: 生成一个大文件，统计每秒能切出多少个词法单元
+// 用法: ./a.out [重复次数] [源文件]，给出源文件时直接对该文件计时
+
+static const char *snippet =
+    "struct node_%d {\n"
+    "    int      key;\n"
+    "    uint64_t value;\n"
+    "    struct node_%d* next;\n"
+    "};\n"
+    "\n"
+    "/* sum the list */\n"
+    "static int sum_%d(struct node_%d* head, int limit)\n"
+    "{\n"
+    "    int total = 0;\n"
+    "    int i;\n"
+    "    for (i = 0; i < limit && head; i++) {\n"
+    "        if (head->key >= 0x10)\n"
+    "            total += head->key * 3 + (head->value >> 2);\n"
+    "        else\n"
+    "            total -= 1;\n"
+    "        head = head->next; // next node\n"
+    "    }\n"
+    "    return total;\n"
+    "}\n"
+    "\n";
+
+static int _make_input(const char *path, int n) {
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return -1;
+
+    int i;
+    for (i = 0; i < n; i++)
+        fprintf(fp, snippet, i, i, i, i);
+
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = "/tmp/lex_bench_input.c";
+    int n = 20000;
+
+    if (argc > 1)
+        n = atoi(argv[1]);
+
+    if (argc > 2)
+        path = argv[2];
+    else if (_make_input(path, n) < 0) {
+        loge("create input file '%s' failed\n", path);
+        return -1;
+    }
+
+    lex_t *lex = NULL;
+    lex_word_t *w = NULL;
+
+    int64_t t0 = gettime();
+
+    if (lex_open(&lex, path) < 0) {
+        loge("\n");
+        return -1;
+    }
+
+    int64_t n_words = 0;
+    int n_lines;
+
+    while (1) {
+        if (lex_pop_word(lex, &w) < 0) {
+            loge("\n");
+            return -1;
+        }
+
+        n_words++;
+
+        if (LEX_WORD_EOF == w->type) {
+            lex_word_free(w);
+            break;
+        }
+
+        lex_word_free(w);
+        w = NULL;
+    }
+
+    n_lines = lex->nb_lines;
+    lex_close(lex);
+
+    int64_t t1 = gettime();
+    int64_t us = t1 - t0 > 0 ? t1 - t0 : 1;
+
+    printf("\nfile: %s, lines: %d\n", path, n_lines);
+    printf("words: %ld, time: %ld us, %.2f Mwords/s\n", n_words, us, (double)n_words / us);
+    return 0;
+}
@@ -0,0 +1,77 @@
+.text
+.global _start, main
+.weak   __start_scf_prof, __stop_scf_prof
+.weak   __cxa_atexit, exit
+
+# 插桩编译的程序用它代替 _start.s:
+# 退出时把 scf_prof 段原样写到 scf.prof
+#
+# 链接了 libc 时在 main 之前用 __cxa_atexit() 登记写文件的函数, main 返回后也走 exit(),
+# 所以程序自己调用 exit() 退出时同样有 profile; 没有 libc 时 main 返回后直接写, 再退出
+
+_start:
+	mov  __cxa_atexit@GOTPCREL(%rip), %rax
+	test %rax, %rax
+	jz   5f
+	lea  prof_dump(%rip), %rdi
+	xor  %rsi, %rsi
+	xor  %rdx, %rdx
+	call *%rax
+5:
+	mov  %rsp, %rsi
+	add  $8,   %rsi   # argv
+	mov  %rsi, %rdx
+1:
+	mov  (%rdx), %rdi
+	add  $8,    %rdx  # envp
+	test %rdi,  %rdi
+	jnz  1b
+
+	mov  (%rsp), %rdi # argc
+
+	call main
+	mov  %rax, %rdi
+
+	mov  exit@GOTPCREL(%rip), %rax
+	test %rax, %rax
+	jz   6f
+	call *%rax        # 不返回
+6:
+	push %rdi
+	call prof_dump
+	pop  %rdi
+	mov  $60,  %rax
+	syscall
+
+prof_dump:
+	lea  prof_path(%rip), %rdi
+	mov  $0x241, %rsi # O_WRONLY | O_CREAT | O_TRUNC
+	mov  $0644,  %rdx
+	mov  $2,     %rax # open
+	syscall
+	test %rax,   %rax
+	js   3f
+
+	mov  %rax, %rdi
+	lea  __start_scf_prof(%rip), %rsi
+	lea  __stop_scf_prof(%rip),  %rdx
+	sub  %rsi, %rdx
+2:
+	test %rdx, %rdx
+	jz   4f
+	mov  $1,   %rax   # write
+	syscall
+	test %rax, %rax
+	jle  4f
+	add  %rax, %rsi
+	sub  %rax, %rdx
+	jmp  2b
+4:
+	mov  $3,   %rax   # close
+	syscall
+3:
+	ret
+
+.section .rodata
+prof_path:
+	.asciz "scf.prof"
@@ -89,21 +89,17 @@ static int __eda_bb_mask(function_t* f, ScfEpin* mask, basic_block_t* root, basi
 {
 	basic_block_t* bb;
 	list_t*        l;
-	int i;
 
 	for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
 		bb = list_data(l, basic_block_t, list);
 		bb->visit_flag = 0;
 	}
 
-	for (i = cmp->dominators->size - 1; i >= 0; i--) {
-		bb = cmp->dominators->data[i];
-
-		if (bb->dfo < cmp->dfo) {
-			bb->visit_flag = 1;
-			logw("dom->index: %d, dfo: %d, cmp->index: %d, dfo: %d\n", bb->index, bb->dfo, cmp->index, cmp->dfo);
-			break;
-		}
+	// 直接后支配者
+	bb = cmp->ipdom;
+	if (bb && bb != cmp) {
+		bb->visit_flag = 1;
+		logw("dom->index: %d, dfo: %d, cmp->index: %d, dfo: %d\n", bb->index, bb->dfo, cmp->index, cmp->dfo);
 	}
 
 	cmp->visit_flag = 1;
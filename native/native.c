@@ -1,8 +1,12 @@
 #include "native.h"
+#include "utils_hash.h"
 
 extern native_ops_t native_ops_x64;
 extern native_ops_t native_ops_risc;
 
+// 每个线程当前正在选择指令的后端，线程池里不同的线程用不同的 native_t
+static __thread native_t *native_cur = NULL;
+
 void instruction_print(instruction_t *inst) {
     if (inst->OpCode)
         printf("%s ", inst->OpCode->name);
@@ -67,6 +71,8 @@ int native_open(native_t **pctx, const char *name) {
 
     printf("%s(),%d, error: \n", __func__, __LINE__);
 
+    if (ctx->registers)
+        free(ctx->registers);
     free(ctx);
     ctx = NULL;
     return -1;
@@ -75,7 +81,21 @@ int native_open(native_t **pctx, const char *name) {
 int native_close(native_t *ctx) {
     if (ctx) {
         if (ctx->ops && ctx->ops->close) {
+            native_t *prev = native_switch(ctx);
+
             ctx->ops->close(ctx);
+
+            native_switch(prev);
+        }
+
+        if (ctx->registers) {
+            int i;
+            for (i = 0; i < ctx->nb_registers; i++) {
+                if (ctx->registers[i].dag_nodes)
+                    vector_free(ctx->registers[i].dag_nodes);
+            }
+
+            free(ctx->registers);
         }
 
         free(ctx);
@@ -84,10 +104,428 @@ int native_close(native_t *ctx) {
     return 0;
 }
 
+// 包含基本块的循环 loop 以及它里面的循环一共几层
+// loop_childs 里可能也有隔代的子循环, 取最深的一条路径
+static int __bb_loop_depth(bb_group_t *loop, basic_block_t *bb) {
+    bb_group_t *child;
+
+    int depth = 0;
+    int i;
+
+    if (loop->loop_childs) {
+        for (i = 0; i < loop->loop_childs->size; i++) {
+            child = loop->loop_childs->data[i];
+
+            if (!vector_find(child->body, bb))
+                continue;
+
+            int d = __bb_loop_depth(child, bb);
+            if (d > depth)
+                depth = d;
+        }
+    }
+
+    return depth + 1;
+}
+
+// 基本块所在的循环层数, f->bb_loops 里只有最外层的循环, 内层的要沿 loop_childs 往下找
+static int _bb_loop_depth(function_t *f, basic_block_t *bb) {
+    bb_group_t *loop;
+
+    int depth = 0;
+    int i;
+
+    if (!bb->loop_flag)
+        return 0;
+
+    for (i = 0; i < f->bb_loops->size; i++) {
+        loop = f->bb_loops->data[i];
+
+        if (vector_find(loop->body, bb)) {
+            depth = __bb_loop_depth(loop, bb);
+            break;
+        }
+    }
+
+    if (depth > NATIVE_SPILL_MAX_DEPTH)
+        depth = NATIVE_SPILL_MAX_DEPTH;
+    return depth;
+}
+
+// 非浮点常量溢出以后可以直接用立即数重新加载，不需要保存
+static int _dn_spill_free(dag_node_t *dn) {
+    return dn->var && variable_const(dn->var) && !variable_float(dn->var);
+}
+
+static void _dn_add_spill_cost(dag_node_t *dn, int64_t weight) {
+    if (dn && !_dn_spill_free(dn))
+        dn->spill_cost += weight;
+}
+
+// 按每个 DAG 节点在各基本块里被读写的次数计算溢出代价，循环里的每深一层乘 10
+void native_spill_costs(function_t *f) {
+    basic_block_t *bb;
+    mc_3ac_operand_t *operand;
+    mc_3ac_code_t *c;
+    dag_node_t *dn;
+    list_t *l;
+    list_t *l2;
+
+    int i;
+
+    for (l = list_head(&f->dag_list_head); l != list_sentinel(&f->dag_list_head); l = list_next(l)) {
+        dn = list_data(l, dag_node_t, list);
+        dn->spill_cost = 0;
+    }
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        int64_t weight = 1;
+        int depth = _bb_loop_depth(f, bb);
+
+        while (depth-- > 0)
+            weight *= NATIVE_SPILL_LOOP_WEIGHT;
+
+        for (l2 = list_head(&bb->code_list_head); l2 != list_sentinel(&bb->code_list_head); l2 = list_next(l2)) {
+            c = list_data(l2, mc_3ac_code_t, list);
+
+            if (c->dsts) {
+                for (i = 0; i < c->dsts->size; i++) {
+                    operand = c->dsts->data[i];
+                    if (operand)
+                        _dn_add_spill_cost(operand->dag_node, weight);
+                }
+            }
+
+            if (c->srcs) {
+                for (i = 0; i < c->srcs->size; i++) {
+                    operand = c->srcs->data[i];
+                    if (operand)
+                        _dn_add_spill_cost(operand->dag_node, weight);
+                }
+            }
+        }
+    }
+}
+
+int native_bb_offsets(function_t *f) {
+    basic_block_t *bb;
+    list_t *l;
+
+    int offset = 0;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        bb->code_offset = offset;
+        offset += bb->code_bytes;
+    }
+
+    return offset;
+}
+
+// 一条落空链: 链里除了最后一块都落空到下一块，最后一块以无条件跳转或函数结束收尾，所以链和链之间可以随意排列
+typedef struct {
+    int first; // 在原来的基本块顺序里的下标 [first, last]
+    int last;
+
+    int64_t weight;
+
+    uint32_t cold_flag : 1;
+    uint32_t placed_flag : 1;
+} native_chain_t;
+
+static mc_3ac_code_t *_bb_last_code(basic_block_t *bb) {
+    if (list_empty(&bb->code_list_head))
+        return NULL;
+
+    return list_data(list_tail(&bb->code_list_head), mc_3ac_code_t, list);
+}
+
+static int _bb_chain_end(basic_block_t *bb) {
+    mc_3ac_code_t *c = _bb_last_code(bb);
+
+    return c && (OP_GOTO == c->op->type || OP_3AC_JMP_TABLE == c->op->type || OP_3AC_END == c->op->type);
+}
+
+static inline uint32_t _bb_hash(basic_block_t *bb) {
+    return (uint32_t)(((uintptr_t)bb >> 4) * 2654435761u);
+}
+
+// 有插桩计数时按计数，否则按循环深度估计，出错(core dump)的块和单独成链的释放块是冷的
+static void _chain_weight(function_t *f, vector_t *bbs, native_chain_t *ch) {
+    basic_block_t *bb;
+
+    int profile = f->bb_counts && f->nb_bb_counts == f->nb_basic_blocks;
+    int cleanup = 1;
+    int i;
+
+    ch->weight = 0;
+    ch->cold_flag = 0;
+
+    for (i = ch->first; i <= ch->last; i++) {
+        bb = bbs->data[i];
+
+        int64_t w;
+
+        if (profile) {
+            if (bb->index < 0 || bb->index >= f->nb_bb_counts)
+                continue;
+
+            w = f->bb_counts[bb->index];
+        } else {
+            int depth = _bb_loop_depth(f, bb);
+
+            w = 1;
+            while (depth-- > 0)
+                w *= NATIVE_SPILL_LOOP_WEIGHT;
+
+            if (bb->dump_flag)
+                ch->cold_flag = 1;
+
+            if (!bb->auto_free_flag && !bb->jmp_flag)
+                cleanup = 0;
+        }
+
+        if (ch->weight < w)
+            ch->weight = w;
+    }
+
+    if (profile)
+        ch->cold_flag = 0 == ch->weight;
+    else if (cleanup)
+        ch->cold_flag = 1;
+}
+
+// 在 cur 之后放哪条链: 先放 cur 末尾的跳转目标，这样那条跳转可以去掉，再放 cur 里条件跳转的目标里最热的，最后放剩下的最热的
+static native_chain_t *_chain_next(native_chain_t *chains, int nb_chains, native_chain_t *cur, vector_t *bbs, hash_t *starts) {
+    native_chain_t *ch;
+    native_chain_t *best = NULL;
+    mc_3ac_operand_t *dst;
+    mc_3ac_code_t *c;
+
+    int i;
+
+    for (i = cur->last; i >= cur->first; i--) {
+        c = _bb_last_code(bbs->data[i]);
+
+        if (!c || !type_is_jmp(c->op->type) || !c->dsts)
+            continue;
+
+        dst = c->dsts->data[0];
+
+        ch = hash_find(starts, dst->bb, _bb_hash(dst->bb));
+        if (!ch || ch->placed_flag || ch->cold_flag || ch == chains + nb_chains - 1)
+            continue;
+
+        if (i == cur->last && OP_GOTO == c->op->type)
+            return ch;
+
+        if (!best || best->weight < ch->weight)
+            best = ch;
+    }
+
+    if (best)
+        return best;
+
+    for (i = 1; i < nb_chains - 1; i++) {
+        ch = chains + i;
+
+        if (ch->placed_flag || ch->cold_flag)
+            continue;
+
+        if (!best || best->weight < ch->weight)
+            best = ch;
+    }
+
+    return best;
+}
+
+// 相邻的两条链，前一条末尾跳到后一条开头的无条件跳转已经没用了
+static void _chain_del_jmp(function_t *f, vector_t *bbs, native_chain_t *prev, native_chain_t *next) {
+    basic_block_t *bb = bbs->data[prev->last];
+    mc_3ac_operand_t *dst;
+    mc_3ac_code_t *c;
+
+    c = _bb_last_code(bb);
+    if (!c || OP_GOTO != c->op->type || !c->dsts)
+        return;
+
+    dst = c->dsts->data[0];
+    if (dst->bb != bbs->data[next->first])
+        return;
+
+    if (vector_del(f->jmps, c) < 0)
+        return;
+
+    if (c->instructions)
+        vector_clear(c->instructions, free);
+
+    c->op = mc_3ac_find_operator(OP_3AC_NOP);
+}
+
+int native_bb_layout(function_t *f) {
+    native_chain_t *chains = NULL;
+    native_chain_t *order = NULL;
+    native_chain_t *ch;
+    basic_block_t *bb;
+    vector_t *bbs;
+    list_t *l;
+
+    hash_t starts = {0};
+
+    int nb_chains = 0;
+    int ret = 0;
+    int i;
+    int j;
+
+    bbs = vector_alloc();
+    if (!bbs)
+        return -ENOMEM;
+
+    for (l = list_head(&f->basic_block_list_head); l != list_sentinel(&f->basic_block_list_head); l = list_next(l)) {
+        bb = list_data(l, basic_block_t, list);
+
+        ret = vector_add(bbs, bb);
+        if (ret < 0)
+            goto end;
+
+        if (_bb_chain_end(bb))
+            nb_chains++;
+    }
+
+    if (0 == bbs->size)
+        goto end;
+
+    if (!_bb_chain_end(bbs->data[bbs->size - 1]))
+        nb_chains++;
+
+    chains = calloc(nb_chains, sizeof(native_chain_t));
+    order = calloc(nb_chains, sizeof(native_chain_t));
+    if (!chains || !order) {
+        ret = -ENOMEM;
+        goto end;
+    }
+
+    // 分链，最后一条是函数结束的链，函数收尾的指令要加在最后一个块上，它留在最后
+    for (i = 0, j = 0; i < bbs->size; i++) {
+        ch = chains + j;
+
+        if (i == 0 || _bb_chain_end(bbs->data[i - 1])) {
+            if (i > 0)
+                ch = chains + ++j;
+
+            ch->first = i;
+
+            ret = hash_add(&starts, bbs->data[i], _bb_hash(bbs->data[i]), ch);
+            if (ret < 0)
+                goto end;
+        }
+
+        ch->last = i;
+    }
+    assert(j == nb_chains - 1);
+
+    for (i = 0; i < nb_chains; i++)
+        _chain_weight(f, bbs, chains + i);
+
+    chains[0].cold_flag = 0;
+    chains[nb_chains - 1].cold_flag = 0;
+
+    // 入口链在最前，热链按跳转串起来，冷链放在函数结束的链前面
+    ch = chains;
+    ch->placed_flag = 1;
+    order[0] = *ch;
+    j = 1;
+
+    if (nb_chains > 1) {
+        while ((ch = _chain_next(chains, nb_chains, ch, bbs, &starts))) {
+            ch->placed_flag = 1;
+            order[j++] = *ch;
+        }
+
+        for (i = 1; i < nb_chains - 1; i++) {
+            ch = chains + i;
+
+            if (!ch->placed_flag) {
+                ch->placed_flag = 1;
+                order[j++] = *ch;
+            }
+        }
+
+        order[j++] = chains[nb_chains - 1];
+    }
+    assert(j == nb_chains);
+
+    for (i = 0; i < bbs->size; i++) {
+        bb = bbs->data[i];
+        list_del(&bb->list);
+    }
+
+    for (i = 0; i < nb_chains; i++) {
+        ch = order + i;
+
+        for (j = ch->first; j <= ch->last; j++) {
+            bb = bbs->data[j];
+            list_add_tail(&f->basic_block_list_head, &bb->list);
+        }
+
+        if (i > 0)
+            _chain_del_jmp(f, bbs, order + i - 1, ch);
+    }
+
+end:
+    hash_clear(&starts);
+    free(chains);
+    free(order);
+    vector_free(bbs);
+    return ret;
+}
+
+int native_registers_open(native_t *ctx, const register_t *registers, int nb_registers) {
+    assert(!ctx->registers);
+
+    ctx->registers = malloc(nb_registers * sizeof(register_t));
+    if (!ctx->registers)
+        return -ENOMEM;
+
+    memcpy(ctx->registers, registers, nb_registers * sizeof(register_t));
+
+    int i;
+    for (i = 0; i < nb_registers; i++) {
+        ctx->registers[i].dag_nodes = NULL;
+        ctx->registers[i].updated = 0;
+        ctx->registers[i].used = 0;
+    }
+
+    ctx->nb_registers = nb_registers;
+    return 0;
+}
+
+native_t *native_switch(native_t *ctx) {
+    native_t *prev = native_cur;
+
+    native_cur = ctx;
+    return prev;
+}
+
+native_t *native_current() {
+    return native_cur;
+}
+
 int native_select_inst(native_t *ctx, function_t *f) {
     if (ctx && f) {
-        if (ctx->ops && ctx->ops->select_inst)
-            return ctx->ops->select_inst(ctx, f);
+        native_spill_costs(f);
+
+        if (ctx->ops && ctx->ops->select_inst) {
+            native_t *prev = native_switch(ctx);
+
+            int ret = ctx->ops->select_inst(ctx, f);
+
+            native_switch(prev);
+            return ret;
+        }
     }
 
     printf("%s(),%d, error: \n", __func__, __LINE__);
@@ -86,6 +86,13 @@ typedef struct
 
     void *priv;
 
+    // 寄存器表的副本，dag_nodes、used、updated 是分配寄存器时的状态，
+    // 每个 native_t 一份，不同线程里的 native_t 可以同时选择指令
+    register_t *registers;
+    int nb_registers;
+
+    int linear_scan; // 用线性扫描代替图着色分配寄存器，编译快，代码差一些
+
 } native_t;
 
 struct native_ops_s {
@@ -99,6 +106,9 @@ struct native_ops_s {
 struct regs_ops_s {
     const char *name;
 
+    register_t *registers; // 寄存器表的模板，native_registers_open() 复制到 native_t
+    int nb_registers;
+
     uint32_t *abi_regs;
     uint32_t *abi_float_regs;
     uint32_t *abi_double_regs;
@@ -154,6 +164,7 @@ struct inst_ops_s {
 
     int (*BL)(_3ac_code_t *c, function_t *f, function_t *pf);
     instruction_t *(*BLR)(_3ac_code_t *c, register_t *r);
+    instruction_t *(*BR)(_3ac_code_t *c, register_t *r);
     instruction_t *(*PUSH)(_3ac_code_t *c, register_t *r);
     instruction_t *(*POP)(_3ac_code_t *c, register_t *r);
     instruction_t *(*TEQ)(_3ac_code_t *c, register_t *rs);
@@ -263,4 +274,34 @@ int native_close(native_t *ctx);
 
 int native_select_inst(native_t *ctx, function_t *f);
 
+// 从模板复制一份寄存器表给 ctx，native_close() 时释放
+int native_registers_open(native_t *ctx, const register_t *registers, int nb_registers);
+
+// 设置当前线程正在选择指令的后端，返回原来的，后端的寄存器函数通过它找到寄存器表
+native_t *native_switch(native_t *ctx);
+native_t *native_current();
+
+// 溢出代价 = 使用次数 × 10^循环深度，可以重新生成的常量为 0
+#define NATIVE_SPILL_LOOP_WEIGHT 10
+#define NATIVE_SPILL_MAX_DEPTH 8
+
+void native_spill_costs(function_t *f);
+
+// 按链表顺序累加 code_bytes 算出每个基本块的 code_offset，返回函数体的字节数
+int native_bb_offsets(function_t *f);
+
+// 指令选择之后、算偏移之前重排基本块: 按落空把块分成链，热链沿跳转串在一起，冷链挪到函数末尾，
+// 紧挨着目标的无条件跳转去掉，f->bb_counts 有插桩计数时按计数判断冷热
+int native_bb_layout(function_t *f);
+
+// 选溢出对象时比较 代价 / 冲突数，dn0 更应该溢出时返回 1
+static inline int native_spill_better(dag_node_t *dn0, int degree0, dag_node_t *dn1, int degree1) {
+    int64_t c0 = dn0->spill_cost * degree1;
+    int64_t c1 = dn1->spill_cost * degree0;
+
+    if (c0 != c1)
+        return c0 < c1;
+    return degree0 > degree1;
+}
+
 #endif
\ No newline at end of file
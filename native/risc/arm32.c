@@ -1956,6 +1956,17 @@ instruction_t* arm32_inst_BLR(_3ac_code_t* c, register_t* r)
 	return inst;
 }
 
+instruction_t* arm32_inst_BR(_3ac_code_t* c, register_t* r)
+{
+	instruction_t* inst;
+	uint32_t           opcode;
+
+	opcode = 0xe12fff10 | r->id;
+	inst   = risc_make_inst(c, opcode);
+
+	return inst;
+}
+
 instruction_t* arm32_inst_SETZ(_3ac_code_t* c, register_t* rd)
 {
 	instruction_t* inst;
@@ -2258,6 +2269,7 @@ inst_ops_t  inst_ops_arm32 =
 
 	.BL        = arm32_inst_BL,
 	.BLR       = arm32_inst_BLR,
+	.BR        = arm32_inst_BR,
 	.PUSH      = arm32_inst_PUSH,
 	.POP       = arm32_inst_POP,
 	.TEQ       = arm32_inst_TEQ,
@@ -1332,6 +1332,17 @@ instruction_t* arm64_inst_BLR(_3ac_code_t* c, register_t* r)
 	return inst;
 }
 
+instruction_t* arm64_inst_BR(_3ac_code_t* c, register_t* r)
+{
+	instruction_t* inst;
+	uint32_t           opcode;
+
+	opcode = (0xd61f << 16) | (r->id << 5);
+	inst   = risc_make_inst(c, opcode);
+
+	return inst;
+}
+
 instruction_t* arm64_inst_SETZ(_3ac_code_t* c, register_t* rd)
 {
 	instruction_t* inst;
@@ -1593,6 +1604,7 @@ inst_ops_t  inst_ops_arm64 =
 
 	.BL        = arm64_inst_BL,
 	.BLR       = arm64_inst_BLR,
+	.BR        = arm64_inst_BR,
 	.PUSH      = arm64_inst_PUSH,
 	.POP       = arm64_inst_POP,
 	.TEQ       = arm64_inst_TEQ,
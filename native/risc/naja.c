@@ -1152,6 +1152,17 @@ instruction_t* naja_inst_BLR(_3ac_code_t* c, register_t* r)
 	return inst;
 }
 
+instruction_t* naja_inst_BR(_3ac_code_t* c, register_t* r)
+{
+	instruction_t* inst;
+	uint32_t           opcode;
+
+	opcode = (0xb << 26) | (r->id << 21);
+	inst   = risc_make_inst(c, opcode);
+
+	return inst;
+}
+
 instruction_t* naja_inst_SETZ(_3ac_code_t* c, register_t* rd)
 {
 	instruction_t* inst;
@@ -1421,6 +1432,7 @@ inst_ops_t  inst_ops_naja =
 
 	.BL        = naja_inst_BL,
 	.BLR       = naja_inst_BLR,
+	.BR        = naja_inst_BR,
 	.PUSH      = naja_inst_PUSH,
 	.POP       = naja_inst_POP,
 	.TEQ       = naja_inst_TEQ,
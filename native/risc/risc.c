@@ -58,6 +58,12 @@ int	risc_open(native_t* ctx, const char* arch)
 	if (!risc)
 		return -ENOMEM;
 
+	int ret = native_registers_open(ctx, rops->registers, rops->nb_registers);
+	if (ret < 0) {
+		free(risc);
+		return ret;
+	}
+
 	ctx->iops = iops;
 	ctx->rops = rops;
 	ctx->priv = risc;
@@ -527,7 +533,10 @@ static int _risc_select_bb_regs(basic_block_t* bb, native_t* ctx)
 		goto error;
 	}
 
-	ret = risc_graph_kcolor(g, 16, colors, f);
+	if (ctx->linear_scan)
+		ret = risc_linear_scan(g, colors, &bb, 1, f);
+	else
+		ret = risc_graph_kcolor(g, 16, colors, f);
 	if (ret < 0)
 		goto error;
 
@@ -572,13 +581,23 @@ static int _risc_select_bb_group_regs(bb_group_t* bbg, native_t* ctx)
 			goto error;
 	}
 
+	// 循环的 pre 里有外提的代码，和循环体一起分配寄存器
+	if (!vector_find(bbg->body, bbg->pre)) {
+		ret = _risc_make_bb_rcg(g, bbg->pre, ctx);
+		if (ret < 0)
+			goto error;
+	}
+
 	colors = f->rops->register_colors();
 	if (!colors) {
 		ret = -ENOMEM;
 		goto error;
 	}
 
-	ret = risc_graph_kcolor(g, 16, colors, f);
+	if (ctx->linear_scan)
+		ret = risc_linear_scan(g, colors, (basic_block_t**)bbg->body->data, bbg->body->size, f);
+	else
+		ret = risc_graph_kcolor(g, 16, colors, f);
 	if (ret < 0)
 		goto error;
 
@@ -629,39 +648,26 @@ static int _risc_make_insts_for_list(native_t* ctx, basic_block_t* bb, int bb_of
 	return bb_offset;
 }
 
+// RISC 的指令都是定长的，不用松弛，块的位置用前缀和一次算出来
 static void _risc_set_offset_for_jmps(native_t* ctx, function_t* f)
 {
 	int i;
 
+	native_bb_offsets(f);
+
 	for (i = 0; i < f->jmps->size; i++) {
-		_3ac_code_t*    c      = f->jmps->data[i];
+		mc_3ac_code_t*    c      = f->jmps->data[i];
 
 		assert(c->instructions && 1 == c->instructions->size);
 
-		_3ac_operand_t* dst    = c->dsts->data[0];
+		mc_3ac_operand_t* dst    = c->dsts->data[0];
 		basic_block_t* cur_bb = c->basic_block;
 		basic_block_t* dst_bb = dst->bb;
 
 		instruction_t* inst   = c->instructions->data[0];
-		basic_block_t* bb     = NULL;
-		list_t*        l      = NULL;
-		int32_t            bytes  = 0;
-
-		if (cur_bb->index < dst_bb->index) {
-			for (l = &cur_bb->list; l != &dst_bb->list; l = list_next(l)) {
 
-				bb     = list_data(l, basic_block_t, list);
-
-				bytes += bb->code_bytes;
-			}
-		} else {
-			for (l = &dst_bb->list; l != &cur_bb->list; l = list_next(l)) {
-
-				bb     = list_data(l, basic_block_t, list);
-
-				bytes -= bb->code_bytes;
-			}
-		}
+		// 位移从跳转所在块的开头算起，跳转单独占一个块
+		int32_t bytes = dst_bb->code_offset - cur_bb->code_offset;
 
 		assert(0 == (bytes & 0x3));
 
@@ -671,28 +677,19 @@ static void _risc_set_offset_for_jmps(native_t* ctx, function_t* f)
 
 static void _risc_set_offset_for_relas(native_t* ctx, function_t* f, vector_t* relas)
 {
+	native_bb_offsets(f);
+
 	int i;
 	for (i = 0; i < relas->size; i++) {
 
 		rela_t*        rela   = relas->data[i];
-		_3ac_code_t*    c      = rela->code;
+		mc_3ac_code_t*    c      = rela->code;
 		instruction_t* inst   = rela->inst;
 		basic_block_t* cur_bb = c->basic_block;
 
 		instruction_t* inst2;
-		basic_block_t* bb;
-		list_t*        l;
-
-		int bytes = f->init_code_bytes;
 
-		for (l = list_head(&f->basic_block_list_head); l != &cur_bb->list;
-				l = list_next(l)) {
-
-			bb     = list_data(l, basic_block_t, list);
-			bytes += bb->code_bytes;
-		}
-
-		bytes += c->bb_offset;
+		int bytes = f->init_code_bytes + cur_bb->code_offset + c->bb_offset;
 
 		int j;
 		for (j = 0; j < c->instructions->size; j++) {
@@ -871,6 +868,9 @@ static void _risc_bbg_fix_loads(bb_group_t* bbg)
 			c  = list_data(l, _3ac_code_t, list);
 			l  = list_next(l);
 
+			if (!c->dsts)
+				continue;
+
 			dst = c->dsts->data[0];
 
 			if (dst->dag_node == dn) {
@@ -76,6 +76,7 @@ int risc_select(native_t* ctx);
 int risc_optimize_peephole(native_t* ctx, function_t* f);
 
 int risc_graph_kcolor(graph_t* graph, int k, vector_t* colors, function_t* f);
+int risc_linear_scan(graph_t* graph, vector_t* colors, basic_block_t** bbs, int nb_bbs, function_t* f);
 
 
 intptr_t risc_bb_find_color (vector_t* dn_colors, dag_node_t* dn);
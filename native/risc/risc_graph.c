@@ -247,10 +247,10 @@ static int _risc_kcolor_find_not_neighbor(graph_t* graph, int k, graph_node_t**
 	return -1;
 }
 
-static graph_node_t* _risc_max_neighbors(graph_t* graph)
+// 溢出 代价 / 冲突数 最小的节点，代价相同时溢出冲突多的
+static graph_node_t* _risc_spill_candidate(graph_t* graph)
 {
-	graph_node_t* node_max = NULL;
-	int max = 0;
+	graph_node_t* node_min = NULL;
 	int i;
 	for (i = 0; i < graph->nodes->size; i++) {
 		graph_node_t* node = graph->nodes->data[i];
@@ -261,20 +261,27 @@ static graph_node_t* _risc_max_neighbors(graph_t* graph)
 			continue;
 		}
 
-		if (!node_max || max < node->neighbors->size) {
-			node_max = node;
-			max      = node->neighbors->size;
+		if (!node_min) {
+			node_min = node;
+			continue;
 		}
+
+		risc_rcg_node_t* rn_min = node_min->data;
+
+		if (native_spill_better(rn->dag_node, node->neighbors->size, rn_min->dag_node, node_min->neighbors->size))
+			node_min = node;
 	}
 
-	risc_rcg_node_t*   rn   = node_max->data;
+	risc_rcg_node_t*   rn   = node_min->data;
 
 	if (rn->dag_node->var->w)
-		logi("max_neighbors: %d, %s\n", max, rn->dag_node->var->w->text->data);
+		logi("spill: %s, cost: %ld, neighbors: %d\n",
+				rn->dag_node->var->w->text->data, rn->dag_node->spill_cost, node_min->neighbors->size);
 	else
-		logi("max_neighbors: %d, v_%p\n", max, rn->dag_node->var);
+		logi("spill: v_%p, cost: %ld, neighbors: %d\n",
+				rn->dag_node->var, rn->dag_node->spill_cost, node_min->neighbors->size);
 
-	return node_max;
+	return node_min;
 }
 
 static void _risc_kcolor_process_conflict(graph_t* graph, function_t* f)
@@ -368,7 +375,7 @@ static int _risc_graph_kcolor(graph_t* graph, int k, vector_t* colors, function_
 	assert(graph->nodes->size > 0);
 	assert(graph->nodes->size >= k);
 
-	graph_node_t* node_max = NULL;
+	graph_node_t* node_spill = NULL;
 	graph_node_t* node0    = NULL;
 	graph_node_t* node1    = NULL;
 
@@ -452,19 +459,19 @@ static int _risc_graph_kcolor(graph_t* graph, int k, vector_t* colors, function_
 		colors2 = NULL;
 	} else {
 overflow:
-		node_max = _risc_max_neighbors(graph);
-		assert(node_max);
+		node_spill = _risc_spill_candidate(graph);
+		assert(node_spill);
 
-		ret = graph_delete_node(graph, node_max);
+		ret = graph_delete_node(graph, node_spill);
 		if (ret < 0)
 			goto error;
-		node_max->color = -1;
+		node_spill->color = -1;
 
 		ret = risc_graph_kcolor(graph, k, colors, f);
 		if (ret < 0)
 			goto error;
 
-		ret = graph_add_node(graph, node_max);
+		ret = graph_add_node(graph, node_spill);
 		if (ret < 0)
 			goto error;
 	}
@@ -500,3 +507,245 @@ int risc_graph_kcolor(graph_t* graph, int k, vector_t* colors, function_t* f)
 }
 
 
+
+// 线性扫描：按活跃区间的起点依次分配，冲突关系仍然用寄存器冲突图里的边
+typedef struct {
+	graph_node_t* node;
+	int           start;
+	int           end;
+} risc_interval_t;
+
+static uint32_t _risc_scan_hash(dag_node_t* dn)
+{
+	return (uint32_t)(((uintptr_t)dn >> 4) * 2654435761u);
+}
+
+static void _risc_scan_touch(hash_t* h, dag_node_t* dn, int pos)
+{
+	if (!dn)
+		return;
+
+	risc_interval_t* it = hash_find(h, dn, _risc_scan_hash(dn));
+	if (!it)
+		return;
+
+	if (it->start < 0)
+		it->start = pos;
+	it->end = pos;
+}
+
+static int _risc_interval_cmp(const void* v0, const void* v1)
+{
+	const risc_interval_t* it0 = v0;
+	const risc_interval_t* it1 = v1;
+
+	if (it0->start != it1->start)
+		return it0->start < it1->start ? -1 : 1;
+
+	if (it0->end != it1->end)
+		return it0->end > it1->end ? -1 : 1;
+	return 0;
+}
+
+// 按代码顺序给每个变量算出第一次和最后一次活跃的位置
+static int _risc_scan_intervals(risc_interval_t* intervals, int n, basic_block_t** bbs, int nb_bbs)
+{
+	hash_t h;
+	hash_init(&h);
+
+	int pos = 0;
+	int ret = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		risc_rcg_node_t* rn = intervals[i].node->data;
+
+		ret = hash_add(&h, rn->dag_node, _risc_scan_hash(rn->dag_node), &intervals[i]);
+		if (ret < 0)
+			goto end;
+	}
+
+	for (i = 0; i < nb_bbs; i++) {
+		list_t* l;
+
+		for (l = list_head(&bbs[i]->code_list_head); l != list_sentinel(&bbs[i]->code_list_head); l = list_next(l)) {
+			mc_3ac_code_t*    c = list_data(l, mc_3ac_code_t, list);
+			mc_3ac_operand_t* operand;
+			dn_status_t*    ds;
+
+			if (c->active_vars) {
+				for (j = 0; j < c->active_vars->size; j++) {
+					ds = c->active_vars->data[j];
+
+					if (ds->active)
+						_risc_scan_touch(&h, ds->dag_node, pos);
+				}
+			}
+
+			if (c->srcs) {
+				for (j = 0; j < c->srcs->size; j++) {
+					operand = c->srcs->data[j];
+					_risc_scan_touch(&h, operand->dag_node, pos);
+				}
+			}
+
+			if (c->dsts) {
+				for (j = 0; j < c->dsts->size; j++) {
+					operand = c->dsts->data[j];
+					_risc_scan_touch(&h, operand->dag_node, pos);
+				}
+			}
+
+			pos++;
+		}
+	}
+
+	// 代码里没出现的(比如参数)看作整段都活跃
+	for (i = 0; i < n; i++) {
+		if (intervals[i].start < 0) {
+			intervals[i].start = 0;
+			intervals[i].end   = pos;
+		}
+	}
+
+end:
+	hash_clear(&h);
+	return ret;
+}
+
+static intptr_t _risc_scan_select(graph_node_t* node, vector_t* colors, function_t* f)
+{
+	risc_rcg_node_t* rn = node->data;
+
+	int bytes = f->rops->variable_size(rn->dag_node->var);
+	int type  = variable_float(rn->dag_node->var);
+	int i;
+	int j;
+
+	for (i = 0; i < colors->size; i++) {
+		intptr_t c = (intptr_t)(colors->data[i]);
+
+		if (bytes != RISC_COLOR_BYTES(c) || type != RISC_COLOR_TYPE(c))
+			continue;
+
+		for (j = 0; j < node->neighbors->size; j++) {
+			graph_node_t* neighbor = node->neighbors->data[j];
+
+			if (neighbor->color > 0 && f->rops->color_conflict(c, neighbor->color))
+				break;
+		}
+
+		if (j == node->neighbors->size)
+			return c;
+	}
+
+	return 0;
+}
+
+// 已经分到寄存器的邻居里溢出最便宜的，比 node 还贵时返回 NULL
+static graph_node_t* _risc_scan_victim(graph_node_t* node)
+{
+	risc_rcg_node_t* rn     = node->data;
+	graph_node_t*   victim = NULL;
+
+	int j;
+	for (j = 0; j < node->neighbors->size; j++) {
+		graph_node_t*   neighbor = node->neighbors->data[j];
+		risc_rcg_node_t* rn2      = neighbor->data;
+
+		if (neighbor->color <= 0 || rn2->reg || !rn2->dag_node)
+			continue;
+
+		if (variable_float(rn2->dag_node->var) != variable_float(rn->dag_node->var))
+			continue;
+
+		if (!victim) {
+			victim = neighbor;
+			continue;
+		}
+
+		risc_rcg_node_t* rn_victim = victim->data;
+
+		if (native_spill_better(rn2->dag_node, neighbor->neighbors->size, rn_victim->dag_node, victim->neighbors->size))
+			victim = neighbor;
+	}
+
+	if (victim) {
+		risc_rcg_node_t* rn_victim = victim->data;
+
+		if (!native_spill_better(rn_victim->dag_node, victim->neighbors->size, rn->dag_node, node->neighbors->size))
+			victim = NULL;
+	}
+
+	return victim;
+}
+
+int risc_linear_scan(graph_t* graph, vector_t* colors, basic_block_t** bbs, int nb_bbs, function_t* f)
+{
+	if (!graph || !colors || 0 == colors->size || !bbs) {
+		loge("\n");
+		return -EINVAL;
+	}
+
+	_risc_kcolor_process_conflict(graph, f);
+
+	risc_interval_t* intervals = calloc(graph->nodes->size + 1, sizeof(risc_interval_t));
+	if (!intervals)
+		return -ENOMEM;
+
+	int n = 0;
+	int i;
+
+	for (i = 0; i < graph->nodes->size; i++) {
+		graph_node_t*   node = graph->nodes->data[i];
+		risc_rcg_node_t* rn   = node->data;
+
+		if (rn->reg || !rn->dag_node) {
+			assert(node->color > 0);
+			continue;
+		}
+
+		node->color = 0;
+
+		intervals[n].node  = node;
+		intervals[n].start = -1;
+		intervals[n].end   = -1;
+		n++;
+	}
+
+	int ret = _risc_scan_intervals(intervals, n, bbs, nb_bbs);
+	if (ret < 0) {
+		free(intervals);
+		return ret;
+	}
+
+	qsort(intervals, n, sizeof(risc_interval_t), _risc_interval_cmp);
+
+	for (i = 0; i < n; i++) {
+		graph_node_t* node = intervals[i].node;
+
+		node->color = _risc_scan_select(node, colors, f);
+		if (node->color > 0)
+			continue;
+
+		// 没有空闲的寄存器，看能不能让更便宜的邻居溢出
+		graph_node_t* victim = _risc_scan_victim(node);
+		if (victim) {
+			intptr_t color = victim->color;
+
+			victim->color = -1;
+
+			node->color = _risc_scan_select(node, colors, f);
+			if (node->color > 0)
+				continue;
+
+			victim->color = color;
+		}
+
+		node->color = -1;
+	}
+
+	free(intervals);
+	return 0;
+}
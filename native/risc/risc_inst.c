@@ -3777,6 +3777,123 @@ static int _risc_inst_nop_handler(native_t* ctx, _3ac_code_t* c)
 	return 0;
 }
 
+static int _risc_inst_count_handler(native_t* ctx, _3ac_code_t* c)
+{
+	if (!c->srcs || c->srcs->size != 1)
+		return -EINVAL;
+
+	risc_context_t* risc = ctx->priv;
+	function_t*     f    = risc->f;
+	_3ac_operand_t* src  = c->srcs->data[0];
+
+	if (!src || !src->dag_node)
+		return -EINVAL;
+
+	variable_t*     v    = src->dag_node->var;
+	instruction_t*  inst = NULL;
+
+	register_t*     x0   = f->rops->find_register("x0");
+	register_t*     x1   = f->rops->find_register("x1");
+
+	// 32 位的后端只加计数器的低 4 字节
+	int32_t offset = c->basic_block->index << 3;
+	int     size   = x1->bytes;
+
+	if (!c->instructions) {
+		c->instructions = vector_alloc();
+		if (!c->instructions)
+			return -ENOMEM;
+	}
+
+	int ret = f->rops->overflow_reg(x0, c, f);
+	if (ret < 0)
+		return ret;
+
+	ret = f->rops->overflow_reg(x1, c, f);
+	if (ret < 0)
+		return ret;
+
+	ret = ctx->iops->ADR2G(c, f, x0, v);
+	if (ret < 0)
+		return ret;
+
+	ret = ctx->iops->P2G(c, f, x1, x0, offset, size);
+	if (ret < 0)
+		return ret;
+
+	inst = ctx->iops->ADD_IMM(c, f, x1, x1, 1);
+	RISC_INST_ADD_CHECK(c->instructions, inst);
+
+	return ctx->iops->G2P(c, f, x1, x0, offset, size);
+}
+
+static int _risc_inst_jmp_table_handler(native_t* ctx, _3ac_code_t* c)
+{
+	if (!c->srcs || c->srcs->size != 1 || !c->jmp_table)
+		return -EINVAL;
+
+	risc_context_t* risc = ctx->priv;
+	function_t*     f    = risc->f;
+	_3ac_operand_t* src  = c->srcs->data[0];
+
+	if (!src || !src->dag_node)
+		return -EINVAL;
+
+	variable_t*     v    = c->jmp_table->var;
+	instruction_t*  inst = NULL;
+	register_t*     rs   = NULL;
+	register_t*     rt   = f->rops->find_register("x0");
+	sib_t           sib  = {0};
+
+	int size = variable_size(src->dag_node->var);
+
+	if (!c->instructions) {
+		c->instructions = vector_alloc();
+		if (!c->instructions)
+			return -ENOMEM;
+	}
+
+	RISC_SELECT_REG_CHECK(&rs, src->dag_node, c, f, 1);
+
+	// 下标已经和表长比较过，高位清零后当作整个寄存器
+	if (size < 4) {
+		inst = ctx->iops->MOVZX(c, rs, rs, size);
+		RISC_INST_ADD_CHECK(c->instructions, inst);
+
+	} else if (4 == size && f->rops->MAX_BYTES > 4) {
+		rs   = f->rops->find_register_color_bytes(rs->color, 4);
+		inst = ctx->iops->MOV_G(c, rs, rs);
+		RISC_INST_ADD_CHECK(c->instructions, inst);
+	}
+	rs = f->rops->find_register_color_bytes(rs->color, f->rops->MAX_BYTES);
+
+	if (f->rops->color_conflict(rt->color, rs->color))
+		rt = f->rops->find_register("x1");
+
+	int ret = f->rops->overflow_reg(rt, c, f);
+	if (ret < 0)
+		return ret;
+
+	// 表项是目标的地址，和寄存器一样宽
+	ret = ctx->iops->ADR2G(c, f, rt, v);
+	if (ret < 0)
+		return ret;
+
+	sib.base  = rt;
+	sib.index = rs;
+	sib.scale = rt->bytes;
+	sib.disp  = 0;
+	sib.size  = rt->bytes;
+
+	ret = ctx->iops->SIB2G(c, f, rt, &sib);
+	if (ret < 0)
+		return ret;
+
+	inst = ctx->iops->BR(c, rt);
+	RISC_INST_ADD_CHECK(c->instructions, inst);
+	return 0;
+}
+
 static int _risc_inst_end_handler(native_t* ctx, _3ac_code_t* c)
 {
 	risc_context_t* risc  = ctx->priv;
@@ -5717,6 +5834,9 @@ static risc_inst_handler_pt  risc_inst_handlers[N__3ac_OPS] =
 	[OP_3AC_JAE     ]  =  _risc_inst_jae_handler,
 	[OP_3AC_JBE     ]  =  _risc_inst_jbe_handler,
 
+	[OP_3AC_COUNT   ]  =  _risc_inst_count_handler,
+	[OP_3AC_JMP_TABLE]  =  _risc_inst_jmp_table_handler,
+
 	[OP_3AC_NOP     ]  =  _risc_inst_nop_handler,
 	[OP_3AC_END     ]  =  _risc_inst_end_handler,
 
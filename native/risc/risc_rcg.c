@@ -951,6 +951,18 @@ static int _risc_rcg_nop_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
 {
 	return 0;
 }
+static int _risc_rcg_count_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
+{
+	return 0;
+}
+static int _risc_rcg_jmp_table_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
+{
+	int ret = _risc_rcg_make2(c, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	return risc_rcg_make(c, g, NULL, NULL);
+}
 static int _risc_rcg_end_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
 {
 	return 0;
@@ -1214,6 +1226,9 @@ static risc_rcg_handler_pt  risc_rcg_handlers[N__3ac_OPS] =
 	[OP_3AC_RESAVE  ]  =  _risc_rcg_save_handler,
 	[OP_3AC_RELOAD  ]  =  _risc_rcg_load_handler,
 
+	[OP_3AC_COUNT   ]  =  _risc_rcg_count_handler,
+	[OP_3AC_JMP_TABLE]  =  _risc_rcg_jmp_table_handler,
+
 	[OP_3AC_NOP     ]  =  _risc_rcg_nop_handler,
 	[OP_3AC_END     ]  =  _risc_rcg_end_handler,
 
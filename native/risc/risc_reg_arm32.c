@@ -5,7 +5,8 @@
 #define RISC_REG_LR 14
 #define RISC_REG_PC 15
 
-register_t	arm32_registers[] = {
+// 寄存器表的模板，分配寄存器时的状态在每个 native_t 自己的副本里
+static register_t	arm32_registers_tmpl[] = {
 
 	{0, 1, "b0",    RISC_COLOR(0, 0, 0x1),  NULL, 0, 0},
 	{0, 2, "h0",    RISC_COLOR(0, 0, 0x3),  NULL, 0, 0},
@@ -132,6 +133,9 @@ register_t	arm32_registers[] = {
 	{15, 8, "d15",  RISC_COLOR(1, 15, 0xff), NULL, 0, 0},
 };
 
+#define ARM32_NB_REGS    (sizeof(arm32_registers_tmpl) / sizeof(arm32_registers_tmpl[0]))
+#define arm32_registers (native_current()->registers)
+
 static uint32_t arm32_abi_regs[] =
 {
 	RISC_REG_X0,
@@ -245,7 +249,7 @@ static int arm32_variable_size(variable_t* v)
 register_t* arm32_find_register(const char* name)
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -258,7 +262,7 @@ register_t* arm32_find_register(const char* name)
 register_t* arm32_find_register_type_id_bytes(uint32_t type, uint32_t id, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -271,7 +275,7 @@ register_t* arm32_find_register_type_id_bytes(uint32_t type, uint32_t id, int by
 register_t* arm32_find_register_color(intptr_t color)
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -284,7 +288,7 @@ register_t* arm32_find_register_color(intptr_t color)
 register_t* arm32_find_register_color_bytes(intptr_t color, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -301,7 +305,7 @@ vector_t* arm32_register_colors()
 		return NULL;
 
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -335,7 +339,7 @@ int arm32_reg_cached_vars(register_t* r)
 	int nb_vars = 0;
 	int i;
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r2 = &(arm32_registers[i]);
 
@@ -357,7 +361,7 @@ int arm32_reg_cached_vars(register_t* r)
 int arm32_registers_init()
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -382,7 +386,7 @@ int arm32_registers_init()
 void arm32_registers_clear()
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -446,7 +450,7 @@ int arm32_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb
 	for (j = 0; j < nb_regs; j++) {
 		r2 = arm32_find_register_type_id_bytes(0, regs[j], f->rops->MAX_BYTES);
 
-		for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+		for (i = 0; i < ARM32_NB_REGS; i++) {
 			r  = &(arm32_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -462,7 +466,7 @@ int arm32_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb
 				break;
 		}
 
-		if (i == sizeof(arm32_registers) / sizeof(arm32_registers[0]))
+		if (i == ARM32_NB_REGS)
 			continue;
 
 		if (stack_size > 0) {
@@ -519,7 +523,7 @@ int arm32_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 	for (j = nb_regs - 1; j >= 0; j--) {
 		r2 = regs[j];
 
-		for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+		for (i = 0; i < ARM32_NB_REGS; i++) {
 			r  = &(arm32_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -535,7 +539,7 @@ int arm32_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 				break;
 		}
 
-		if (i == sizeof(arm32_registers) / sizeof(arm32_registers[0]))
+		if (i == ARM32_NB_REGS)
 			continue;
 
 		for (i = 0; i < nb_updated; i++) {
@@ -560,7 +564,7 @@ int arm32_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 int arm32_registers_reset()
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -600,7 +604,7 @@ int arm32_registers_reset()
 int arm32_overflow_reg(register_t* r, _3ac_code_t* c, function_t* f)
 {
 	int i;
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r2 = &(arm32_registers[i]);
 
@@ -632,7 +636,7 @@ int arm32_overflow_reg2(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		r2 = &(arm32_registers[i]);
 
@@ -675,7 +679,7 @@ int arm32_overflow_reg3(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_
 	int j;
 	int ret;
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		r2 = &(arm32_registers[i]);
 
@@ -737,7 +741,7 @@ int arm32_reg_used(register_t* r, dag_node_t* dn)
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		r2 = &(arm32_registers[i]);
 
@@ -764,7 +768,7 @@ register_t* arm32_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 {
 	vector_t*       neighbors = NULL;
 	graph_node_t*   gn        = NULL;
-	register_t*     free_regs[sizeof(arm32_registers) / sizeof(arm32_registers[0])];
+	register_t*     free_regs[ARM32_NB_REGS];
 
 	int nb_free_regs = 0;
 	int bytes        = 4;
@@ -786,7 +790,7 @@ register_t* arm32_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 	else
 		neighbors = gn->neighbors;
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -828,7 +832,7 @@ register_t* arm32_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 	if (nb_free_regs > 0)
 		return risc_reg_cached_min_vars(free_regs, nb_free_regs);
 
-	for (i = 0; i < sizeof(arm32_registers) / sizeof(arm32_registers[0]); i++) {
+	for (i = 0; i < ARM32_NB_REGS; i++) {
 
 		register_t*	r = &(arm32_registers[i]);
 
@@ -1086,7 +1090,7 @@ int arm32_push_callee_regs(_3ac_code_t* c, function_t* f)
 	register_t*    r2;
 	register_t*    r;
 
-	int N = sizeof(arm32_registers) / sizeof(arm32_registers[0]);
+	int N = ARM32_NB_REGS;
 	int i;
 	int j;
 
@@ -1119,7 +1123,7 @@ int arm32_pop_callee_regs(_3ac_code_t* c, function_t* f)
 	register_t*    r2;
 	register_t*    r;
 
-	int N = sizeof(arm32_registers) / sizeof(arm32_registers[0]);
+	int N = ARM32_NB_REGS;
 	int i;
 	int j;
 
@@ -1148,6 +1152,9 @@ regs_ops_t  regs_ops_arm32 =
 {
 	.name                        = "arm32",
 
+	.registers                   = arm32_registers_tmpl,
+	.nb_registers                = ARM32_NB_REGS,
+
 	.abi_regs                    = arm32_abi_regs,
 	.abi_float_regs              = arm32_abi_float_regs,
 	.abi_double_regs             = arm32_abi_double_regs,
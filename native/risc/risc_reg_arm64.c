@@ -4,7 +4,8 @@
 #define RISC_REG_LR 30
 #define RISC_REG_SP 31
 
-register_t	arm64_registers[] = {
+// 寄存器表的模板，分配寄存器时的状态在每个 native_t 自己的副本里
+static register_t	arm64_registers_tmpl[] = {
 
 	{0, 4, "w0",    RISC_COLOR(0, 0, 0xf),  NULL, 0, 0},
 	{0, 8, "x0",    RISC_COLOR(0, 0, 0xff), NULL, 0, 0},
@@ -235,6 +236,9 @@ register_t	arm64_registers[] = {
 	{31, 8, "d31",    RISC_COLOR(1, 31, 0xff), NULL, 0, 0},
 };
 
+#define ARM64_NB_REGS    (sizeof(arm64_registers_tmpl) / sizeof(arm64_registers_tmpl[0]))
+#define arm64_registers (native_current()->registers)
+
 static uint32_t arm64_abi_regs[] =
 {
 	RISC_REG_X0,
@@ -325,7 +329,7 @@ static int arm64_variable_size(variable_t* v)
 register_t* arm64_find_register(const char* name)
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -338,7 +342,7 @@ register_t* arm64_find_register(const char* name)
 register_t* arm64_find_register_type_id_bytes(uint32_t type, uint32_t id, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -351,7 +355,7 @@ register_t* arm64_find_register_type_id_bytes(uint32_t type, uint32_t id, int by
 register_t* arm64_find_register_color(intptr_t color)
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -364,7 +368,7 @@ register_t* arm64_find_register_color(intptr_t color)
 register_t* arm64_find_register_color_bytes(intptr_t color, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -381,7 +385,7 @@ vector_t* arm64_register_colors()
 		return NULL;
 
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -416,7 +420,7 @@ int arm64_reg_cached_vars(register_t* r)
 	int nb_vars = 0;
 	int i;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r2 = &(arm64_registers[i]);
 
@@ -439,7 +443,7 @@ int arm64_reg_cached_vars(register_t* r)
 int arm64_registers_init()
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -465,7 +469,7 @@ int arm64_registers_init()
 void arm64_registers_clear()
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -530,7 +534,7 @@ int arm64_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb
 	for (j = 0; j < nb_regs; j++) {
 		r2 = arm64_find_register_type_id_bytes(0, regs[j], 8);
 
-		for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+		for (i = 0; i < ARM64_NB_REGS; i++) {
 			r  = &(arm64_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -547,7 +551,7 @@ int arm64_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb
 				break;
 		}
 
-		if (i == sizeof(arm64_registers) / sizeof(arm64_registers[0]))
+		if (i == ARM64_NB_REGS)
 			continue;
 
 		if (stack_size > 0) {
@@ -603,7 +607,7 @@ int arm64_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 	for (j = nb_regs - 1; j >= 0; j--) {
 		r2 = regs[j];
 
-		for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+		for (i = 0; i < ARM64_NB_REGS; i++) {
 			r  = &(arm64_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -620,7 +624,7 @@ int arm64_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 				break;
 		}
 
-		if (i == sizeof(arm64_registers) / sizeof(arm64_registers[0]))
+		if (i == ARM64_NB_REGS)
 			continue;
 
 		for (i = 0; i < nb_updated; i++) {
@@ -645,7 +649,7 @@ int arm64_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs
 int arm64_registers_reset()
 {
 	int i;
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -687,7 +691,7 @@ int arm64_overflow_reg(register_t* r, _3ac_code_t* c, function_t* f)
 {
 	int i;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r2 = &(arm64_registers[i]);
 
@@ -720,7 +724,7 @@ int arm64_overflow_reg2(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		r2 = &(arm64_registers[i]);
 
@@ -762,7 +766,7 @@ int arm64_overflow_reg3(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_
 	int j;
 	int ret;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		r2 = &(arm64_registers[i]);
 
@@ -825,7 +829,7 @@ int arm64_reg_used(register_t* r, dag_node_t* dn)
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		r2 = &(arm64_registers[i]);
 
@@ -854,7 +858,7 @@ register_t* arm64_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 	vector_t*       neighbors = NULL;
 	graph_node_t*   gn        = NULL;
 
-	register_t* free_regs[sizeof(arm64_registers) / sizeof(arm64_registers[0])];
+	register_t* free_regs[ARM64_NB_REGS];
 
 	int nb_free_regs = 0;
 	int bytes        = 8;
@@ -875,7 +879,7 @@ register_t* arm64_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 	else
 		neighbors = gn->neighbors;
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -915,7 +919,7 @@ register_t* arm64_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_f
 	if (nb_free_regs > 0)
 		return risc_reg_cached_min_vars(free_regs, nb_free_regs);
 
-	for (i = 0; i < sizeof(arm64_registers) / sizeof(arm64_registers[0]); i++) {
+	for (i = 0; i < ARM64_NB_REGS; i++) {
 
 		register_t*	r = &(arm64_registers[i]);
 
@@ -1110,6 +1114,9 @@ regs_ops_t  regs_ops_arm64 =
 {
 	.name                        = "arm64",
 
+	.registers                   = arm64_registers_tmpl,
+	.nb_registers                = ARM64_NB_REGS,
+
 	.abi_regs                    = arm64_abi_regs,
 	.abi_float_regs              = arm64_abi_float_regs,
 	.abi_ret_regs                = arm64_abi_ret_regs,
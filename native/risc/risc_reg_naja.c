@@ -5,7 +5,8 @@
 #define RISC_REG_SP   30
 #define RISC_REG_NULL 31
 
-register_t	naja_registers[] = {
+// 寄存器表的模板，分配寄存器时的状态在每个 native_t 自己的副本里
+static register_t	naja_registers_tmpl[] = {
 
 	{0, 4, "w0",    RISC_COLOR(0, 0, 0xf),  NULL, 0, 0},
 	{0, 8, "x0",    RISC_COLOR(0, 0, 0xff), NULL, 0, 0},
@@ -234,6 +235,9 @@ register_t	naja_registers[] = {
 	{31, 8, "d31",    RISC_COLOR(1, 31, 0xff), NULL, 0, 0},
 };
 
+#define NAJA_NB_REGS    (sizeof(naja_registers_tmpl) / sizeof(naja_registers_tmpl[0]))
+#define naja_registers (native_current()->registers)
+
 static uint32_t naja_abi_regs[] =
 {
 	RISC_REG_X0,
@@ -323,7 +327,7 @@ static int naja_variable_size(variable_t* v)
 register_t* naja_find_register(const char* name)
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -336,7 +340,7 @@ register_t* naja_find_register(const char* name)
 register_t* naja_find_register_type_id_bytes(uint32_t type, uint32_t id, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -349,7 +353,7 @@ register_t* naja_find_register_type_id_bytes(uint32_t type, uint32_t id, int byt
 register_t* naja_find_register_color(intptr_t color)
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -362,7 +366,7 @@ register_t* naja_find_register_color(intptr_t color)
 register_t* naja_find_register_color_bytes(intptr_t color, int bytes)
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -379,7 +383,7 @@ vector_t* naja_register_colors()
 		return NULL;
 
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -414,7 +418,7 @@ int naja_reg_cached_vars(register_t* r)
 	int nb_vars = 0;
 	int i;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r2 = &(naja_registers[i]);
 
@@ -437,7 +441,7 @@ int naja_reg_cached_vars(register_t* r)
 int naja_registers_init()
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -463,7 +467,7 @@ int naja_registers_init()
 void naja_registers_clear()
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -528,7 +532,7 @@ int naja_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb_
 	for (j = 0; j < nb_regs; j++) {
 		r2 = naja_find_register_type_id_bytes(0, regs[j], 8);
 
-		for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+		for (i = 0; i < NAJA_NB_REGS; i++) {
 			r  = &(naja_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -545,7 +549,7 @@ int naja_caller_save_regs(_3ac_code_t* c, function_t* f, uint32_t* regs, int nb_
 				break;
 		}
 
-		if (i == sizeof(naja_registers) / sizeof(naja_registers[0]))
+		if (i == NAJA_NB_REGS)
 			continue;
 
 		if (stack_size > 0) {
@@ -601,7 +605,7 @@ int naja_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs,
 	for (j = nb_regs - 1; j >= 0; j--) {
 		r2 = regs[j];
 
-		for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+		for (i = 0; i < NAJA_NB_REGS; i++) {
 			r  = &(naja_registers[i]);
 
 			if (RISC_REG_SP == r->id
@@ -618,7 +622,7 @@ int naja_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs,
 				break;
 		}
 
-		if (i == sizeof(naja_registers) / sizeof(naja_registers[0]))
+		if (i == NAJA_NB_REGS)
 			continue;
 
 		for (i = 0; i < nb_updated; i++) {
@@ -643,7 +647,7 @@ int naja_pop_regs(_3ac_code_t* c, function_t* f, register_t** regs, int nb_regs,
 int naja_registers_reset()
 {
 	int i;
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -685,7 +689,7 @@ int naja_overflow_reg(register_t* r, _3ac_code_t* c, function_t* f)
 {
 	int i;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r2 = &(naja_registers[i]);
 
@@ -718,7 +722,7 @@ int naja_overflow_reg2(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_t
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		r2 = &(naja_registers[i]);
 
@@ -760,7 +764,7 @@ int naja_overflow_reg3(register_t* r, dag_node_t* dn, _3ac_code_t* c, function_t
 	int j;
 	int ret;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		r2 = &(naja_registers[i]);
 
@@ -823,7 +827,7 @@ int naja_reg_used(register_t* r, dag_node_t* dn)
 	int i;
 	int j;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		r2 = &(naja_registers[i]);
 
@@ -852,7 +856,7 @@ register_t* naja_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_fl
 	vector_t*       neighbors = NULL;
 	graph_node_t*   gn        = NULL;
 
-	register_t* free_regs[sizeof(naja_registers) / sizeof(naja_registers[0])];
+	register_t* free_regs[NAJA_NB_REGS];
 
 	int nb_free_regs = 0;
 	int bytes        = 8;
@@ -873,7 +877,7 @@ register_t* naja_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_fl
 	else
 		neighbors = gn->neighbors;
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -913,7 +917,7 @@ register_t* naja_select_overflowed_reg(dag_node_t* dn, _3ac_code_t* c, int is_fl
 	if (nb_free_regs > 0)
 		return risc_reg_cached_min_vars(free_regs, nb_free_regs);
 
-	for (i = 0; i < sizeof(naja_registers) / sizeof(naja_registers[0]); i++) {
+	for (i = 0; i < NAJA_NB_REGS; i++) {
 
 		register_t*	r = &(naja_registers[i]);
 
@@ -1108,6 +1112,9 @@ regs_ops_t  regs_ops_naja =
 {
 	.name                        = "naja",
 
+	.registers                   = naja_registers_tmpl,
+	.nb_registers                = NAJA_NB_REGS,
+
 	.abi_regs                    = naja_abi_regs,
 	.abi_float_regs              = naja_abi_float_regs,
 	.abi_ret_regs                = naja_abi_ret_regs,
@@ -10,6 +10,12 @@ int x64_open(native_t *ctx, const char *arch) {
     if (!x64)
         return -ENOMEM;
 
+    int ret = x64_registers_open(ctx);
+    if (ret < 0) {
+        free(x64);
+        return ret;
+    }
+
     ctx->priv = x64;
     return 0;
 }
@@ -535,7 +541,10 @@ static int _x64_select_bb_regs(basic_block_t *bb, native_t *ctx) {
         goto error;
     }
 
-    ret = x64_graph_kcolor(g, 16, colors);
+    if (ctx->linear_scan)
+        ret = x64_linear_scan(g, colors, &bb, 1);
+    else
+        ret = x64_graph_kcolor(g, 16, colors);
     if (ret < 0)
         goto error;
 
@@ -578,13 +587,23 @@ static int _x64_select_bb_group_regs(bb_group_t *bbg, native_t *ctx) {
             goto error;
     }
 
+    // 循环的 pre 里有外提的代码，和循环体一起分配寄存器
+    if (!vector_find(bbg->body, bbg->pre)) {
+        ret = _x64_make_bb_rcg(g, bbg->pre, ctx);
+        if (ret < 0)
+            goto error;
+    }
+
     colors = x64_register_colors();
     if (!colors) {
         ret = -ENOMEM;
         goto error;
     }
 
-    ret = x64_graph_kcolor(g, 16, colors);
+    if (ctx->linear_scan)
+        ret = x64_linear_scan(g, colors, (basic_block_t **)bbg->body->data, bbg->body->size);
+    else
+        ret = x64_graph_kcolor(g, 16, colors);
     if (ret < 0)
         goto error;
 
@@ -631,83 +650,95 @@ static int _x64_make_insts_for_list(native_t *ctx, list_t *h, int bb_offset) {
     return bb_offset;
 }
 
-static void _x64_set_offset_for_jmps(native_t *ctx, function_t *f) {
-    while (1) {
-        int drop_bytes = 0;
-        int i;
+// 跳转到目标块的相对位移，从跳转指令的下一条算起，跳转指令在它所在块的末尾
+static int32_t _x64_jmp_offset(mc_3ac_code_t *c) {
+    mc_3ac_operand_t *dst = c->dsts->data[0];
+    basic_block_t *cur_bb = c->basic_block;
+    basic_block_t *dst_bb = dst->bb;
 
-        for (i = 0; i < f->jmps->size; i++) {
-            3ac_code_t *c = f->jmps->data[i];
+    return dst_bb->code_offset - (cur_bb->code_offset + cur_bb->code_bytes);
+}
 
-            3ac_operand_t *dst = c->dsts->data[0];
-            basic_block_t *cur_bb = c->basic_block;
-            basic_block_t *dst_bb = dst->bb;
+// 用 nb_bytes 字节的位移重新编码跳转，长度的变化记到所在的块上
+static void _x64_jmp_encode(mc_3ac_code_t *c, int32_t bytes, int nb_bytes) {
+    assert(c->instructions && 1 == c->instructions->size);
 
-            basic_block_t *bb = NULL;
-            list_t *l = NULL;
-            int32_t bytes = 0;
+    instruction_t *inst = c->instructions->data[0];
+    x64_OpCode_t *jcc = x64_find_OpCode(inst->OpCode->type, nb_bytes, nb_bytes, X64_I);
 
-            if (cur_bb->index < dst_bb->index) {
-                for (l = list_next(&cur_bb->list); l != &dst_bb->list; l = list_next(l)) {
-                    bb = list_data(l, basic_block_t, list);
+    int old_len = inst->len;
+    x64_make_inst_I2(inst, jcc, (uint8_t *)&bytes, nb_bytes);
+    int diff = inst->len - old_len;
 
-                    bytes += bb->code_bytes;
-                }
-            } else {
-                for (l = &cur_bb->list; l != list_prev(&dst_bb->list); l = list_prev(l)) {
-                    bb = list_data(l, basic_block_t, list);
+    c->basic_block->code_bytes += diff;
+    c->inst_bytes += diff;
+}
 
-                    bytes -= bb->code_bytes;
-                }
-            }
+/*
+ * 先把所有跳转都编码成短跳转，再反复把位移放不下的加长，
+ * 跳转只会变长不会变短，所以一定会停下来，每一轮用前缀和算块的位置，是 O(块数 + 跳转数)
+ */
+static void _x64_set_offset_for_jmps(native_t *ctx, function_t *f) {
+    if (0 == f->jmps->size)
+        return;
 
-            assert(c->instructions && 1 == c->instructions->size);
+    uint8_t *sizes = calloc(f->jmps->size, sizeof(uint8_t));
+    assert(sizes);
 
-            int nb_bytes;
-            if (-128 <= bytes && bytes <= 127)
-                nb_bytes = 1;
-            else
-                nb_bytes = 4;
+    int i;
+    for (i = 0; i < f->jmps->size; i++) {
+        _x64_jmp_encode(f->jmps->data[i], 0, 1);
+        sizes[i] = 1;
+    }
 
-            instruction_t *inst = c->instructions->data[0];
-            x64_OpCode_t *jcc = x64_find_OpCode(inst->OpCode->type, nb_bytes, nb_bytes, X64_I);
+    while (1) {
+        int nb_grown = 0;
+
+        native_bb_offsets(f);
+
+        for (i = 0; i < f->jmps->size; i++) {
+            mc_3ac_code_t *c = f->jmps->data[i];
+
+            if (4 == sizes[i])
+                continue;
 
-            int old_len = inst->len;
-            x64_make_inst_I2(inst, jcc, (uint8_t *)&bytes, nb_bytes);
-            int diff = old_len - inst->len;
-            assert(diff >= 0);
+            int32_t bytes = _x64_jmp_offset(c);
 
-            cur_bb->code_bytes -= diff;
-            c->inst_bytes -= diff;
-            drop_bytes += diff;
+            if (-128 <= bytes && bytes <= 127)
+                continue;
+
+            _x64_jmp_encode(c, 0, 4);
+            sizes[i] = 4;
+            nb_grown++;
         }
 
-        if (0 == drop_bytes)
+        if (0 == nb_grown)
             break;
     }
+
+    // 长度都定下来了，填上最终的位移
+    for (i = 0; i < f->jmps->size; i++) {
+        mc_3ac_code_t *c = f->jmps->data[i];
+
+        _x64_jmp_encode(c, _x64_jmp_offset(c), sizes[i]);
+    }
+
+    free(sizes);
 }
 
 static void _x64_set_offset_for_relas(native_t *ctx, function_t *f, vector_t *relas) {
+    native_bb_offsets(f);
+
     int i;
     for (i = 0; i < relas->size; i++) {
         rela_t *rela = relas->data[i];
-        3ac_code_t *c = rela->code;
+        mc_3ac_code_t *c = rela->code;
         instruction_t *inst = rela->inst;
         basic_block_t *cur_bb = c->basic_block;
 
         instruction_t *inst2;
-        basic_block_t *bb;
-        list_t *l;
-
-        int bytes = f->init_code_bytes;
-
-        for (l = list_head(&f->basic_block_list_head); l != &cur_bb->list;
-             l = list_next(l)) {
-            bb = list_data(l, basic_block_t, list);
-            bytes += bb->code_bytes;
-        }
 
-        bytes += c->bb_offset;
+        int bytes = f->init_code_bytes + cur_bb->code_offset + c->bb_offset;
 
         int j;
         for (j = 0; j < c->instructions->size; j++) {
@@ -887,6 +918,9 @@ static void _x64_bbg_fix_loads(bb_group_t *bbg) {
             c = list_data(l, 3ac_code_t, list);
             l = list_next(l);
 
+            if (!c->dsts)
+                continue;
+
             dst = c->dsts->data[0];
 
             if (dst->dag_node == dn) {
@@ -1054,6 +1088,10 @@ int _x64_select_inst(native_t *ctx) {
         return -1;
     }
 #endif
+    ret = native_bb_layout(f);
+    if (ret < 0)
+        return ret;
+
     _x64_set_offsets(f);
 
     _x64_set_offset_for_jmps(ctx, f);
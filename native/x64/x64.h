@@ -73,6 +73,7 @@ int x64_select(native_t *ctx);
 int x64_optimize_peephole(native_t *ctx, function_t *f);
 
 int x64_graph_kcolor(graph_t *graph, int k, vector_t *colors);
+int x64_linear_scan(graph_t *graph, vector_t *colors, basic_block_t **bbs, int nb_bbs);
 
 intptr_t x64_bb_find_color(vector_t *dn_colors, dag_node_t *dn);
 int x64_save_bb_colors(vector_t *dn_colors, bb_group_t *bbg, basic_block_t *bb);
@@ -248,10 +248,10 @@ static int _x64_kcolor_find_not_neighbor(graph_t* graph, int k, graph_node_t** p
 	return -1;
 }
 
-static graph_node_t* _x64_max_neighbors(graph_t* graph)
+// 溢出 代价 / 冲突数 最小的节点，代价相同时溢出冲突多的
+static graph_node_t* _x64_spill_candidate(graph_t* graph)
 {
-	graph_node_t* node_max = NULL;
-	int max = 0;
+	graph_node_t* node_min = NULL;
 	int i;
 	for (i = 0; i < graph->nodes->size; i++) {
 		graph_node_t* node = graph->nodes->data[i];
@@ -262,20 +262,27 @@ static graph_node_t* _x64_max_neighbors(graph_t* graph)
 			continue;
 		}
 
-		if (!node_max || max < node->neighbors->size) {
-			node_max = node;
-			max      = node->neighbors->size;
+		if (!node_min) {
+			node_min = node;
+			continue;
 		}
+
+		x64_rcg_node_t* rn_min = node_min->data;
+
+		if (native_spill_better(rn->dag_node, node->neighbors->size, rn_min->dag_node, node_min->neighbors->size))
+			node_min = node;
 	}
 
-	x64_rcg_node_t*   rn   = node_max->data;
+	x64_rcg_node_t*   rn   = node_min->data;
 
 	if (rn->dag_node->var->w)
-		logd("max_neighbors: %d, %s\n", max, rn->dag_node->var->w->text->data);
+		logd("spill: %s, cost: %ld, neighbors: %d\n",
+				rn->dag_node->var->w->text->data, rn->dag_node->spill_cost, node_min->neighbors->size);
 	else
-		logd("max_neighbors: %d, v_%p\n", max, rn->dag_node->var);
+		logd("spill: v_%p, cost: %ld, neighbors: %d\n",
+				rn->dag_node->var, rn->dag_node->spill_cost, node_min->neighbors->size);
 
-	return node_max;
+	return node_min;
 }
 
 static void _x64_kcolor_process_conflict(graph_t* graph)
@@ -369,7 +376,7 @@ static int _x64_graph_kcolor(graph_t* graph, int k, vector_t* colors)
 	assert(graph->nodes->size > 0);
 	assert(graph->nodes->size >= k);
 
-	graph_node_t* node_max = NULL;
+	graph_node_t* node_spill = NULL;
 	graph_node_t* node0    = NULL;
 	graph_node_t* node1    = NULL;
 
@@ -453,19 +460,19 @@ static int _x64_graph_kcolor(graph_t* graph, int k, vector_t* colors)
 		colors2 = NULL;
 	} else {
 overflow:
-		node_max = _x64_max_neighbors(graph);
-		assert(node_max);
+		node_spill = _x64_spill_candidate(graph);
+		assert(node_spill);
 
-		ret = graph_delete_node(graph, node_max);
+		ret = graph_delete_node(graph, node_spill);
 		if (ret < 0)
 			goto error;
-		node_max->color = -1;
+		node_spill->color = -1;
 
 		ret = x64_graph_kcolor(graph, k, colors);
 		if (ret < 0)
 			goto error;
 
-		ret = graph_add_node(graph, node_max);
+		ret = graph_add_node(graph, node_spill);
 		if (ret < 0)
 			goto error;
 	}
@@ -503,3 +510,245 @@ int x64_graph_kcolor(graph_t* graph, int k, vector_t* colors)
 
 
 
+
+// 线性扫描：按活跃区间的起点依次分配，冲突关系仍然用寄存器冲突图里的边
+typedef struct {
+	graph_node_t* node;
+	int           start;
+	int           end;
+} x64_interval_t;
+
+static uint32_t _x64_scan_hash(dag_node_t* dn)
+{
+	return (uint32_t)(((uintptr_t)dn >> 4) * 2654435761u);
+}
+
+static void _x64_scan_touch(hash_t* h, dag_node_t* dn, int pos)
+{
+	if (!dn)
+		return;
+
+	x64_interval_t* it = hash_find(h, dn, _x64_scan_hash(dn));
+	if (!it)
+		return;
+
+	if (it->start < 0)
+		it->start = pos;
+	it->end = pos;
+}
+
+static int _x64_interval_cmp(const void* v0, const void* v1)
+{
+	const x64_interval_t* it0 = v0;
+	const x64_interval_t* it1 = v1;
+
+	if (it0->start != it1->start)
+		return it0->start < it1->start ? -1 : 1;
+
+	if (it0->end != it1->end)
+		return it0->end > it1->end ? -1 : 1;
+	return 0;
+}
+
+// 按代码顺序给每个变量算出第一次和最后一次活跃的位置
+static int _x64_scan_intervals(x64_interval_t* intervals, int n, basic_block_t** bbs, int nb_bbs)
+{
+	hash_t h;
+	hash_init(&h);
+
+	int pos = 0;
+	int ret = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		x64_rcg_node_t* rn = intervals[i].node->data;
+
+		ret = hash_add(&h, rn->dag_node, _x64_scan_hash(rn->dag_node), &intervals[i]);
+		if (ret < 0)
+			goto end;
+	}
+
+	for (i = 0; i < nb_bbs; i++) {
+		list_t* l;
+
+		for (l = list_head(&bbs[i]->code_list_head); l != list_sentinel(&bbs[i]->code_list_head); l = list_next(l)) {
+			mc_3ac_code_t*    c = list_data(l, mc_3ac_code_t, list);
+			mc_3ac_operand_t* operand;
+			dn_status_t*    ds;
+
+			if (c->active_vars) {
+				for (j = 0; j < c->active_vars->size; j++) {
+					ds = c->active_vars->data[j];
+
+					if (ds->active)
+						_x64_scan_touch(&h, ds->dag_node, pos);
+				}
+			}
+
+			if (c->srcs) {
+				for (j = 0; j < c->srcs->size; j++) {
+					operand = c->srcs->data[j];
+					_x64_scan_touch(&h, operand->dag_node, pos);
+				}
+			}
+
+			if (c->dsts) {
+				for (j = 0; j < c->dsts->size; j++) {
+					operand = c->dsts->data[j];
+					_x64_scan_touch(&h, operand->dag_node, pos);
+				}
+			}
+
+			pos++;
+		}
+	}
+
+	// 代码里没出现的(比如参数)看作整段都活跃
+	for (i = 0; i < n; i++) {
+		if (intervals[i].start < 0) {
+			intervals[i].start = 0;
+			intervals[i].end   = pos;
+		}
+	}
+
+end:
+	hash_clear(&h);
+	return ret;
+}
+
+static intptr_t _x64_scan_select(graph_node_t* node, vector_t* colors)
+{
+	x64_rcg_node_t* rn = node->data;
+
+	int bytes = x64_variable_size(rn->dag_node->var);
+	int type  = variable_float(rn->dag_node->var);
+	int i;
+	int j;
+
+	for (i = 0; i < colors->size; i++) {
+		intptr_t c = (intptr_t)(colors->data[i]);
+
+		if (bytes != X64_COLOR_BYTES(c) || type != X64_COLOR_TYPE(c))
+			continue;
+
+		for (j = 0; j < node->neighbors->size; j++) {
+			graph_node_t* neighbor = node->neighbors->data[j];
+
+			if (neighbor->color > 0 && X64_COLOR_CONFLICT(c, neighbor->color))
+				break;
+		}
+
+		if (j == node->neighbors->size)
+			return c;
+	}
+
+	return 0;
+}
+
+// 已经分到寄存器的邻居里溢出最便宜的，比 node 还贵时返回 NULL
+static graph_node_t* _x64_scan_victim(graph_node_t* node)
+{
+	x64_rcg_node_t* rn     = node->data;
+	graph_node_t*   victim = NULL;
+
+	int j;
+	for (j = 0; j < node->neighbors->size; j++) {
+		graph_node_t*   neighbor = node->neighbors->data[j];
+		x64_rcg_node_t* rn2      = neighbor->data;
+
+		if (neighbor->color <= 0 || rn2->reg || !rn2->dag_node)
+			continue;
+
+		if (variable_float(rn2->dag_node->var) != variable_float(rn->dag_node->var))
+			continue;
+
+		if (!victim) {
+			victim = neighbor;
+			continue;
+		}
+
+		x64_rcg_node_t* rn_victim = victim->data;
+
+		if (native_spill_better(rn2->dag_node, neighbor->neighbors->size, rn_victim->dag_node, victim->neighbors->size))
+			victim = neighbor;
+	}
+
+	if (victim) {
+		x64_rcg_node_t* rn_victim = victim->data;
+
+		if (!native_spill_better(rn_victim->dag_node, victim->neighbors->size, rn->dag_node, node->neighbors->size))
+			victim = NULL;
+	}
+
+	return victim;
+}
+
+int x64_linear_scan(graph_t* graph, vector_t* colors, basic_block_t** bbs, int nb_bbs)
+{
+	if (!graph || !colors || 0 == colors->size || !bbs) {
+		loge("\n");
+		return -EINVAL;
+	}
+
+	_x64_kcolor_process_conflict(graph);
+
+	x64_interval_t* intervals = calloc(graph->nodes->size + 1, sizeof(x64_interval_t));
+	if (!intervals)
+		return -ENOMEM;
+
+	int n = 0;
+	int i;
+
+	for (i = 0; i < graph->nodes->size; i++) {
+		graph_node_t*   node = graph->nodes->data[i];
+		x64_rcg_node_t* rn   = node->data;
+
+		if (rn->reg || !rn->dag_node) {
+			assert(node->color > 0);
+			continue;
+		}
+
+		node->color = 0;
+
+		intervals[n].node  = node;
+		intervals[n].start = -1;
+		intervals[n].end   = -1;
+		n++;
+	}
+
+	int ret = _x64_scan_intervals(intervals, n, bbs, nb_bbs);
+	if (ret < 0) {
+		free(intervals);
+		return ret;
+	}
+
+	qsort(intervals, n, sizeof(x64_interval_t), _x64_interval_cmp);
+
+	for (i = 0; i < n; i++) {
+		graph_node_t* node = intervals[i].node;
+
+		node->color = _x64_scan_select(node, colors);
+		if (node->color > 0)
+			continue;
+
+		// 没有空闲的寄存器，看能不能让更便宜的邻居溢出
+		graph_node_t* victim = _x64_scan_victim(node);
+		if (victim) {
+			intptr_t color = victim->color;
+
+			victim->color = -1;
+
+			node->color = _x64_scan_select(node, colors);
+			if (node->color > 0)
+				continue;
+
+			victim->color = color;
+		}
+
+		node->color = -1;
+	}
+
+	free(intervals);
+	return 0;
+}
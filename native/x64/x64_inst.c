@@ -1805,6 +1805,105 @@ static int _x64_inst_nop_handler(native_t* ctx, _3ac_code_t* c)
 	return 0;
 }
 
+static int _x64_inst_count_handler(native_t* ctx, _3ac_code_t* c)
+{
+	if (!c->srcs || c->srcs->size != 1)
+		return -EINVAL;
+
+	x64_context_t*  x64  = ctx->priv;
+	function_t*     f    = x64->f;
+	_3ac_operand_t* src  = c->srcs->data[0];
+
+	if (!src || !src->dag_node)
+		return -EINVAL;
+
+	variable_t*     v    = src->dag_node->var;
+	x64_OpCode_t*   inc;
+	instruction_t*  inst = NULL;
+	rela_t*         rela = NULL;
+
+	if (!c->instructions) {
+		c->instructions = vector_alloc();
+		if (!c->instructions)
+			return -ENOMEM;
+	}
+
+	// incq counters + 8 * index(%rip), 不占用寄存器
+	inc  = x64_find_OpCode(X64_INC, 8, 8, X64_E);
+	inst = x64_make_inst_M(&rela, inc, v, NULL);
+	X64_INST_ADD_CHECK(c->instructions, inst);
+	if (!rela) {
+		loge("\n");
+		return -EINVAL;
+	}
+	X64_RELA_ADD_CHECK(f->data_relas, rela, c, v, NULL);
+
+	rela->addend += c->basic_block->index << 3;
+	return 0;
+}
+
+static int _x64_inst_jmp_table_handler(native_t* ctx, _3ac_code_t* c)
+{
+	if (!c->srcs || c->srcs->size != 1 || !c->jmp_table)
+		return -EINVAL;
+
+	x64_context_t*  x64  = ctx->priv;
+	function_t*     f    = x64->f;
+	_3ac_operand_t* src  = c->srcs->data[0];
+
+	if (!src || !src->dag_node)
+		return -EINVAL;
+
+	variable_t*     v    = c->jmp_table->var;
+	x64_OpCode_t*   lea  = x64_find_OpCode(X64_LEA, 8, 8, X64_E2G);
+	x64_OpCode_t*   jmp  = x64_find_OpCode(X64_JMP, 8, 8, X64_E);
+	x64_OpCode_t*   movx;
+	instruction_t*  inst = NULL;
+	register_t*     rs   = NULL;
+	register_t*     rt   = NULL;
+	rela_t*         rela = NULL;
+
+	if (!c->instructions) {
+		c->instructions = vector_alloc();
+		if (!c->instructions)
+			return -ENOMEM;
+	}
+
+	X64_SELECT_REG_CHECK(&rs, src->dag_node, c, f, 1);
+
+	// 下标已经和表长比较过，高位清零后当作 64 位
+	if (rs->bytes < 4) {
+		movx = x64_find_OpCode(X64_MOVZX, rs->bytes, 4, X64_E2G);
+		inst = x64_make_inst_E2G(movx, x64_find_register_color_bytes(rs->color, 4), rs);
+		X64_INST_ADD_CHECK(c->instructions, inst);
+
+	} else if (4 == rs->bytes) {
+		movx = x64_find_OpCode(X64_MOV, 4, 4, X64_E2G);
+		inst = x64_make_inst_E2G(movx, rs, rs);
+		X64_INST_ADD_CHECK(c->instructions, inst);
+	}
+	rs = x64_find_register_color_bytes(rs->color, 8);
+
+	rt = x64_find_register_type_id_bytes(0, X64_REG_RAX, 8);
+	if (X64_COLOR_CONFLICT(rt->color, rs->color))
+		rt = x64_find_register_type_id_bytes(0, X64_REG_RCX, 8);
+
+	int ret = x64_overflow_reg(rt, c, f);
+	if (ret < 0) {
+		loge("\n");
+		return ret;
+	}
+
+	// lea table(%rip), rt; jmp *(rt, rs, 8)
+	inst = x64_make_inst_M2G(&rela, lea, rt, NULL, v);
+	X64_INST_ADD_CHECK(c->instructions, inst);
+	X64_RELA_ADD_CHECK(f->data_relas, rela, c, v, NULL);
+
+	inst = x64_make_inst_SIB(jmp, rt, rs, 8, 0, 8);
+	X64_INST_ADD_CHECK(c->instructions, inst);
+	return 0;
+}
+
 static int _x64_inst_end_handler(native_t* ctx, _3ac_code_t* c)
 {
 	if (!c->instructions) {
@@ -2427,6 +2526,9 @@ static x64_inst_handler_pt  x64_inst_handlers[] =
 	[OP_3AC_JAE     ]  =  _x64_inst_jae_handler,
 	[OP_3AC_JBE     ]  =  _x64_inst_jbe_handler,
 
+	[OP_3AC_COUNT   ]  =  _x64_inst_count_handler,
+	[OP_3AC_JMP_TABLE]  =  _x64_inst_jmp_table_handler,
+
 	[OP_3AC_NOP     ]  =  _x64_inst_nop_handler,
 	[OP_3AC_END     ]  =  _x64_inst_end_handler,
 
@@ -1080,6 +1080,18 @@ static int _x64_rcg_nop_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
 {
 	return 0;
 }
+static int _x64_rcg_count_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
+{
+	return 0;
+}
+static int _x64_rcg_jmp_table_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
+{
+	int ret = _x64_rcg_make2(c, NULL, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	return _x64_rcg_make(c, g, NULL, NULL, NULL);
+}
 static int _x64_rcg_end_handler(native_t* ctx, _3ac_code_t* c, graph_t* g)
 {
 	return 0;
@@ -1347,6 +1359,9 @@ static x64_rcg_handler_pt  x64_rcg_handlers[N_3AC_OPS] =
 	[OP_3AC_RESAVE  ]  =  _x64_rcg_save_handler,
 	[OP_3AC_RELOAD  ]  =  _x64_rcg_load_handler,
 
+	[OP_3AC_COUNT   ]  =  _x64_rcg_count_handler,
+	[OP_3AC_JMP_TABLE]  =  _x64_rcg_jmp_table_handler,
+
 	[OP_3AC_NOP     ]  =  _x64_rcg_nop_handler,
 	[OP_3AC_END     ]  =  _x64_rcg_end_handler,
 
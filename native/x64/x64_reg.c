@@ -1,6 +1,8 @@
 #include "x64.h"
 
-register_t x64_registers[] = {
+// 寄存器表的模板，分配寄存器时的状态在每个 native_t 自己的副本里，
+// 这里的函数都通过 native_current() 找到当前线程的那一份
+static register_t x64_registers_tmpl[] = {
     {0, 1, "al", X64_COLOR(0, 0, 0x1), NULL, 0},
     {0, 2, "ax", X64_COLOR(0, 0, 0x3), NULL, 0},
     {0, 4, "eax", X64_COLOR(0, 0, 0xf), NULL, 0},
@@ -111,11 +113,18 @@ register_t x64_registers[] = {
     {0xf, 8, "rip", X64_COLOR(0, 7, 0xff), NULL, 0},
 };
 
+#define X64_NB_REGS (sizeof(x64_registers_tmpl) / sizeof(x64_registers_tmpl[0]))
+#define x64_registers (native_current()->registers)
+
+int x64_registers_open(native_t *ctx) {
+    return native_registers_open(ctx, x64_registers_tmpl, X64_NB_REGS);
+}
+
 int x64_reg_cached_vars(register_t *r) {
     int nb_vars = 0;
     int i;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r2 = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r2->color) && (X64_REG_RSP == r2->id || X64_REG_RBP == r2->id))
@@ -132,7 +141,7 @@ int x64_reg_cached_vars(register_t *r) {
 
 int x64_registers_init() {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -152,7 +161,7 @@ int x64_registers_init() {
 
 void x64_registers_clear() {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -174,7 +183,7 @@ void x64_registers_print() {
     int i;
     int j;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -220,7 +229,7 @@ int x64_caller_save_regs(_3ac_code_t * c, const char *regs[], int nb_regs, int s
     for (j = 0; j < nb_regs; j++) {
         r2 = x64_find_register(regs[j]);
 
-        for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+        for (i = 0; i < X64_NB_REGS; i++) {
             r = &(x64_registers[i]);
 
             if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -250,7 +259,7 @@ int x64_caller_save_regs(_3ac_code_t * c, const char *regs[], int nb_regs, int s
             }
         }
 
-        if (i == sizeof(x64_registers) / sizeof(x64_registers[0]))
+        if (i == X64_NB_REGS)
             continue;
 
         if (X64_COLOR_TYPE(r2->color)) {
@@ -324,7 +333,7 @@ int x64_pop_regs(vector_t *instructions, register_t **regs, int nb_regs, registe
     for (j = nb_regs - 1; j >= 0; j--) {
         r2 = regs[j];
 
-        for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+        for (i = 0; i < X64_NB_REGS; i++) {
             r = &(x64_registers[i]);
 
             if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -337,7 +346,7 @@ int x64_pop_regs(vector_t *instructions, register_t **regs, int nb_regs, registe
                 break;
         }
 
-        if (i == sizeof(x64_registers) / sizeof(x64_registers[0]))
+        if (i == X64_NB_REGS)
             continue;
 
         for (i = 0; i < nb_updated; i++) {
@@ -366,7 +375,7 @@ int x64_pop_regs(vector_t *instructions, register_t **regs, int nb_regs, registe
 
 int x64_registers_reset() {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -400,7 +409,7 @@ int x64_registers_reset() {
 
 register_t *x64_find_register(const char *name) {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!strcmp(r->name, name))
@@ -411,7 +420,7 @@ register_t *x64_find_register(const char *name) {
 
 register_t *x64_find_register_type_id_bytes(uint32_t type, uint32_t id, int bytes) {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (X64_COLOR_TYPE(r->color) == type && r->id == id && r->bytes == bytes)
@@ -422,7 +431,7 @@ register_t *x64_find_register_type_id_bytes(uint32_t type, uint32_t id, int byte
 
 register_t *x64_find_register_color(intptr_t color) {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (r->color == color)
@@ -433,7 +442,7 @@ register_t *x64_find_register_color(intptr_t color) {
 
 register_t *x64_find_register_color_bytes(intptr_t color, int bytes) {
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (X64_COLOR_CONFLICT(r->color, color) && r->bytes == bytes)
@@ -448,7 +457,7 @@ vector_t *x64_register_colors() {
         return NULL;
 
     int i;
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -582,7 +591,7 @@ int x64_save_reg(register_t *r, _3ac_code_t * c, function_t *f) {
 int x64_overflow_reg(register_t *r, _3ac_code_t * c, function_t *f) {
     int i;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r2 = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r2->color) && (X64_REG_RSP == r2->id || X64_REG_RBP == r2->id))
@@ -609,7 +618,7 @@ int x64_overflow_reg2(register_t *r, dag_node_t *dn, _3ac_code_t * c, function_t
     int i;
     int j;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         r2 = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r2->color) && (X64_REG_RSP == r2->id || X64_REG_RBP == r2->id))
@@ -643,7 +652,7 @@ int x64_reg_used(register_t *r, dag_node_t *dn) {
     int i;
     int j;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         r2 = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r2->color) && (X64_REG_RSP == r2->id || X64_REG_RBP == r2->id))
@@ -662,25 +671,57 @@ int x64_reg_used(register_t *r, dag_node_t *dn) {
     return 0;
 }
 
+// 寄存器 r 和与它重叠的寄存器里缓存的变量的溢出代价之和
+static int64_t _x64_reg_cached_cost(register_t *r) {
+    register_t *r2;
+    dag_node_t *dn;
+
+    int64_t cost = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < X64_NB_REGS; i++) {
+        r2 = &(x64_registers[i]);
+
+        if (!X64_COLOR_TYPE(r2->color) && (X64_REG_RSP == r2->id || X64_REG_RBP == r2->id))
+            continue;
+
+        if (!X64_COLOR_CONFLICT(r->color, r2->color))
+            continue;
+
+        for (j = 0; j < r2->dag_nodes->size; j++) {
+            dn = r2->dag_nodes->data[j];
+            cost += dn->spill_cost;
+        }
+    }
+
+    return cost;
+}
+
+// 选溢出代价最小的寄存器，代价相同时选缓存变量少的
 static register_t *_x64_reg_cached_min_vars(register_t **regs, int nb_regs) {
     register_t *r_min = NULL;
 
+    int64_t min_cost = 0;
     int min = 0;
     int i;
 
     for (i = 0; i < nb_regs; i++) {
         register_t *r = regs[i];
 
+        int64_t cost = _x64_reg_cached_cost(r);
         int nb_vars = x64_reg_cached_vars(r);
 
         if (!r_min) {
             r_min = r;
+            min_cost = cost;
             min = nb_vars;
             continue;
         }
 
-        if (min > nb_vars) {
+        if (min_cost > cost || (min_cost == cost && min > nb_vars)) {
             r_min = r;
+            min_cost = cost;
             min = nb_vars;
         }
     }
@@ -692,7 +733,7 @@ register_t *x64_select_overflowed_reg(dag_node_t *dn, _3ac_code_t * c) {
     vector_t *neighbors = NULL;
     graph_node_t *gn = NULL;
 
-    register_t *free_regs[sizeof(x64_registers) / sizeof(x64_registers[0])];
+    register_t *free_regs[X64_NB_REGS];
 
     int nb_free_regs = 0;
     int is_float = variable_float(dn->var);
@@ -711,7 +752,7 @@ register_t *x64_select_overflowed_reg(dag_node_t *dn, _3ac_code_t * c) {
     else
         neighbors = gn->neighbors;
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -754,7 +795,7 @@ register_t *x64_select_overflowed_reg(dag_node_t *dn, _3ac_code_t * c) {
     if (nb_free_regs > 0)
         return _x64_reg_cached_min_vars(free_regs, nb_free_regs);
 
-    for (i = 0; i < sizeof(x64_registers) / sizeof(x64_registers[0]); i++) {
+    for (i = 0; i < X64_NB_REGS; i++) {
         register_t *r = &(x64_registers[i]);
 
         if (!X64_COLOR_TYPE(r->color) && (X64_REG_RSP == r->id || X64_REG_RBP == r->id))
@@ -802,9 +843,12 @@ register_t *x64_select_overflowed_reg(dag_node_t *dn, _3ac_code_t * c) {
                 continue;
         }
 
-        return r;
+        free_regs[nb_free_regs++] = r;
     }
 
+    // 都有冲突时，溢出代价最小的那个让出来
+    if (nb_free_regs > 0)
+        return _x64_reg_cached_min_vars(free_regs, nb_free_regs);
     return NULL;
 }
 
@@ -1290,7 +1334,7 @@ int x64_push_callee_regs(_3ac_code_t * c, function_t *f) {
     register_t *r2;
     register_t *r;
 
-    int N = sizeof(x64_registers) / sizeof(x64_registers[0]);
+    int N = X64_NB_REGS;
     int i;
     int j;
 
@@ -1324,7 +1368,7 @@ int x64_pop_callee_regs(_3ac_code_t * c, function_t *f) {
     register_t *r2;
     register_t *r;
 
-    int N = sizeof(x64_registers) / sizeof(x64_registers[0]);
+    int N = X64_NB_REGS;
     int i;
     int j;
 
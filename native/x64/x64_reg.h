@@ -117,6 +117,9 @@ static inline int x64_variable_size(variable_t *v) {
 
 typedef iint (*x64_sib_fill_pt)(x64_sib_t *sib, dag_node_t *base, dag_node_t *index, _3ac_code_t *c, function_t *f);
 
+// 给 ctx 复制一份寄存器表，每个 native_t 的寄存器状态互不影响
+int x64_registers_open(native_t *ctx);
+
 int x64_registers_init();
 int x64_registers_reset();
 int x64_registers_clear();
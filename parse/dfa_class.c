@@ -76,7 +76,10 @@ static int _class_action_identity(dfa_t* dfa, vector_t* words, void* data)
 		// 标记该节点为 class 类型
 		t->node.class_flag = 1;
 		// 将该类型注册到当前作用域的符号表中
-		scope_push_type(parse->ast->current_block->scope, t);
+		if (scope_push_type(parse->ast->current_block->scope, t) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 		// 把类型节点挂到当前语法树的块节点下（AST 建立父子关系）
 		node_add_child((node_t*)parse->ast->current_block, (node_t*)t);
 	}
@@ -71,7 +71,10 @@ static int _enum_action_type(dfa_t* dfa, vector_t* words, void* data)
 		// 增加结构体计数并将类型推入作用域
 		parse->ast->nb_structs++;
 		t->node.enum_flag = 1;
-		scope_push_type(parse->ast->root_block->scope, t);
+		if (scope_push_type(parse->ast->root_block->scope, t) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 	}
 
 	// 将当前枚举类型标记为正在解析的类型
@@ -125,7 +128,10 @@ static int _enum_action_lb(dfa_t* dfa, vector_t* words, void* data)
 		// 增加结构体计数并将匿名类型推入作用域
 		parse->ast->nb_structs++;
 		t->node.enum_flag = 1;
-		scope_push_type(parse->ast->root_block->scope, t);
+		if (scope_push_type(parse->ast->root_block->scope, t) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 
 		md->current_enum = w;// 标记当前枚举类型
 	}
@@ -194,7 +200,10 @@ static int _enum_action_var(dfa_t* dfa, vector_t* words, void* data)
 	}
 
 	// 将变量推入作用域
-	scope_push_var(parse->ast->root_block->scope, v);
+	if (scope_push_var(parse->ast->root_block->scope, v) < 0) {
+		loge("\n");
+		return DFA_ERROR;
+	}
 
 	// 设置当前变量为已定义的枚举变量
 	md->current_v = v;
@@ -134,7 +134,10 @@ int _function_add_function(dfa_t* dfa, dfa_data_t* d)
 	}
 
 	// 将函数加入当前作用域
-	scope_push_function(ast->current_block->scope, f);
+	if (scope_push_function(ast->current_block->scope, f) < 0) {
+		loge("\n");
+		return DFA_ERROR;
+	}
 
 	// 将函数节点添加到当前代码块
 	node_add_child((node_t*)ast->current_block, (node_t*)f);
@@ -198,7 +201,10 @@ int _function_add_arg(dfa_t* dfa, dfa_data_t* d)
 			if (!arg)
 				return DFA_ERROR;
 
-			scope_push_var(d->current_function->scope, arg);
+			if (scope_push_var(d->current_function->scope, arg) < 0) {
+				loge("\n");
+				return DFA_ERROR;
+			}
 		} else {
 			// 如果有当前变量，处理该变量
 			arg = d->current_var;
@@ -417,7 +423,10 @@ static int _function_action_rp(dfa_t* dfa, vector_t* words, void* data)
 		}
 	} else {
 		// 如果没有找到同名函数，则将当前函数加入作用域
-		scope_push_function(fd->parent_block->scope, f);
+		if (scope_push_function(fd->parent_block->scope, f) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 		// 将函数节点添加到父块
 		node_add_child((node_t*)fd->parent_block, (node_t*)f);
 	}
@@ -34,7 +34,10 @@ static int _label_action_colon(dfa_t* dfa, vector_t* words, void* data)
 	node_add_child((node_t*)parse->ast->current_block, n);
 
 	// 把 label 注册到当前 block 的 scope 中，便于 later lookup（例如 goto）
-	scope_push_label(parse->ast->current_block->scope, l);
+	if (scope_push_label(parse->ast->current_block->scope, l) < 0) {
+		loge("\n");
+		return DFA_ERROR;
+	}
 
 	// 表示该语法分支成功结束
 	return DFA_OK;
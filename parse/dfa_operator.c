@@ -173,7 +173,10 @@ int _operator_add_arg(dfa_t* dfa, dfa_data_t* d)
 
 		/* 把参数加入函数参数列表并注册到函数局部 scope 中 */
 		vector_add(d->current_function->argv, arg);
-		scope_push_var(d->current_function->scope, arg);
+		if (scope_push_var(d->current_function->scope, arg) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 
 		/* 增加引用计数并设置参数标识（防止被过早释放） */
 		arg->refs++;
@@ -48,7 +48,10 @@ static int _union_action_identity(dfa_t *dfa, vector_t *words, void *data) {
 
         parse->ast->nb_structs++;                                         // AST 中结构体计数加 1
         t->node.union_flag = 1;                                           // 标记为 union
-        scope_push_type(parse->ast->current_block->scope, t);             // 将类型加入当前作用域
+        if (scope_push_type(parse->ast->current_block->scope, t) < 0) { // 将类型加入当前作用域
+            loge("\n");
+            return DFA_ERROR;
+        }
         node_add_child((node_t *)parse->ast->current_block, (node_t *)t); // 加入 AST 树
     }
 
@@ -85,7 +88,10 @@ static int _union_action_lb(dfa_t *dfa, vector_t *words, void *data) {
 
         parse->ast->nb_structs++;
         t->node.union_flag = 1;
-        scope_push_type(parse->ast->current_block->scope, t);             // 入当前作用域
+        if (scope_push_type(parse->ast->current_block->scope, t) < 0) { // 入当前作用域
+            loge("\n");
+            return DFA_ERROR;
+        }
         node_add_child((node_t *)parse->ast->current_block, (node_t *)t); // 加入 AST 树
     }
 
@@ -199,7 +205,10 @@ static int _union_action_var(dfa_t *dfa, vector_t *words, void *data) {
     }
 
     // 将变量加入当前 block 的作用域
-    scope_push_var(parse->ast->current_block->scope, var);
+    if (scope_push_var(parse->ast->current_block->scope, var) < 0) {
+        loge("\n");
+        return DFA_ERROR;
+    }
 
     logi("union var: '%s', type: %d, size: %d\n", w->text->data, var->type, var->size);
 
@@ -186,7 +186,10 @@ static int _var_add_var(dfa_t* dfa, dfa_data_t* d)
 				v->extern_flag, v->static_flag);
 		
 		// 将变量假如当前作用域
-		scope_push_var(parse->ast->current_block->scope, v);
+		if (scope_push_var(parse->ast->current_block->scope, v) < 0) {
+			loge("\n");
+			return DFA_ERROR;
+		}
 
 		// 更新 dfa_data_t 的当前变量信息
 		d->current_var   = v;
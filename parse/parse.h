@@ -5,6 +5,7 @@
 #include "ast.h"
 #include "dfa.h"
 #include "utils_stack.h"
+#include "utils_arena.h"
 #include "dwarf.h"
 
 /*
@@ -38,6 +39,9 @@ typedef struct dfa_data_s dfa_data_t;
 // .debug_str 段：存放调试信息中使用的字符串（如变量名、函数名）
 #define SHNDX_DEBUG_STR 7
 
+// scf_prof 段：插桩编译时各函数的基本块执行计数器
+#define SHNDX_PROF 8
+
 /*          解析器核心结构体            */
 
 // parse_s 表示整个解析器(parser)的上下文
@@ -54,6 +58,15 @@ struct parse_s {
     vector_t *global_consts; // 全局常量表
 
     dwarf_t *debug; // 调试信息
+
+    int nb_jobs; // 中端和后端按函数并行的线程数(-j)，<= 1 时串行
+    int linear_scan; // 后端用线性扫描分配寄存器(快速编译)，否则用图着色
+
+    int inline_growth;   // 内联使整个程序的三地址码增长的上限(百分比)，0 时用默认值
+    int instrument;      // 插桩编译，每个基本块开头给计数器 +1，退出时由运行时写出计数
+    const char *bb_profile; // 插桩编译的程序写出的 scf.prof，内联、基本块和函数的排布按里面的计数，NULL 时用静态估计
+
+    arena_t *arena; // 不属于某一个函数的中间表示(全局优化器生成的)从这里分配
 };
 
 // 表示数组下标或索引
@@ -0,0 +1,70 @@
+#include "utils_arena.h"
+
+typedef struct
+{
+	int    i;
+	double d;
+	void*  p;
+}obj_t;
+
+int main()
+{
+	arena_t* a = NULL;
+
+	int ret = arena_open(&a, 1024);
+	assert(0 == ret);
+
+	obj_t* objs[1000];
+	int i;
+
+	// 没有当前 arena 时从堆上分配
+	assert(NULL == arena_current());
+
+	obj_t* heap = arena_calloc(1, sizeof(obj_t));
+	assert(heap);
+	assert(0 == heap->i && NULL == heap->p);
+
+	arena_t* prev = arena_switch(a);
+	assert(NULL == prev);
+	assert(a == arena_current());
+
+	for (i = 0; i < 1000; i++) {
+		objs[i] = arena_calloc(1, sizeof(obj_t));
+		assert(objs[i]);
+		assert(0 == ((uintptr_t)objs[i] & 0xf));
+		assert(0 == objs[i]->i && NULL == objs[i]->p);
+
+		objs[i]->i = i;
+		objs[i]->d = i * 0.5;
+	}
+
+	// 大对象单独占一块
+	char* big = arena_calloc(4096, 1);
+	assert(big);
+	memset(big, 0xff, 4096);
+
+	for (i = 0; i < 1000; i++) {
+		assert(objs[i]->i == i);
+		assert(objs[i]->d == i * 0.5);
+	}
+
+	for (i = 0; i < 500; i++)
+		arena_free(objs[i]);
+
+	assert(1001 == a->nb_objects);
+	assert(500  == a->nb_frees);
+	assert(a->nb_bytes >= 1000 * sizeof(obj_t) + 4096);
+	assert(a->nb_reserved >= a->nb_bytes);
+
+	arena_print(a, "test");
+
+	prev = arena_switch(NULL);
+	assert(a == prev);
+
+	// 堆上的对象真正释放
+	arena_free(heap);
+	arena_free(NULL);
+
+	arena_close(a);
+	return 0;
+}
@@ -0,0 +1,67 @@
+#include "../utils_bitset.h"
+
+int main() {
+    bitset_t a;
+    bitset_t b;
+
+    bitset_init(&a);
+    bitset_init(&b);
+
+    int ret = bitset_reset(&a, 200);
+    assert(0 == ret);
+
+    int i;
+    for (i = 0; i < 200; i += 3) {
+        ret = bitset_add(&a, i);
+        assert(1 == ret);
+    }
+
+    // b 不预留空间，按需变长
+    for (i = 0; i < 200; i += 5) {
+        ret = bitset_add(&b, i);
+        assert(1 == ret);
+    }
+
+    assert(67 == bitset_count(&a));
+    assert(40 == bitset_count(&b));
+    assert(0 == bitset_add(&b, 195));
+
+    // a |= b，新加入的是 5 的倍数但不是 3 的倍数
+    ret = bitset_or(&a, &b);
+    printf("or: %d\n", ret);
+    assert(40 - 14 == ret);
+    assert(0 == bitset_or(&a, &b));
+
+    // a &= ~b，只剩 3 的倍数但不是 5 的倍数
+    bitset_andnot(&a, &b);
+    bitset_for_each(&a, i) {
+        assert(0 == i % 3 && 0 != i % 5);
+    }
+    assert(67 - 14 == bitset_count(&a));
+
+    bitset_t c;
+    bitset_init(&c);
+
+    ret = bitset_copy(&c, &a);
+    assert(0 == ret && 0 == bitset_or(&c, &a) && bitset_count(&c) == bitset_count(&a));
+    bitset_clear(&c);
+
+    assert(198 == bitset_next(&a, 197));
+    assert(-1 == bitset_next(&a, 199));
+    assert(0 == bitset_test(&a, 100000));
+
+    ret = bitset_add(&a, 1000);
+    assert(1 == ret && bitset_test(&a, 1000) && 1000 == bitset_next(&a, 199));
+
+    bitset_del(&a, 1000);
+    assert(-1 == bitset_next(&a, 199));
+
+    ret = bitset_reset(&a, 10);
+    assert(0 == ret && 0 == bitset_count(&a) && -1 == bitset_next(&a, 0));
+
+    bitset_clear(&a);
+    bitset_clear(&b);
+
+    printf("bitset ok\n");
+    return 0;
+}
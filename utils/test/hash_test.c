@@ -0,0 +1,41 @@
+#include "../utils_hash.h"
+
+int main() {
+    hash_t h;
+    hash_init(&h);
+
+    const char *keys[4] = {"a", "b", "c", "d"};
+    intptr_t i;
+
+    // 所有值的哈希都相同，全部挤在同一条探测序列上，并且多次扩容
+    for (i = 1; i <= 100; i++) {
+        int ret = hash_add(&h, keys[i % 4], 7, (void *)i);
+        assert(0 == ret);
+    }
+    printf("capacity: %d, size: %d\n", h.capacity, h.size);
+
+    // 同一个键的值按插入顺序返回
+    intptr_t prev = 0;
+    void *data;
+    int pos = -1;
+    int n = 0;
+
+    while ((data = hash_next(&h, keys[1], 7, &pos))) {
+        assert((intptr_t)data > prev);
+        prev = (intptr_t)data;
+        n++;
+    }
+    printf("key: %s, n: %d, first: %ld, last: %ld\n", keys[1], n,
+           (intptr_t)hash_find(&h, keys[1], 7), (intptr_t)hash_find_last(&h, keys[1], 7));
+    assert(25 == n);
+    assert(1 == (intptr_t)hash_find(&h, keys[1], 7));
+    assert(97 == (intptr_t)hash_find_last(&h, keys[1], 7));
+
+    assert(0 == hash_del(&h, keys[1], 7, (void *)1));
+    assert(5 == (intptr_t)hash_find(&h, keys[1], 7));
+    assert(NULL == hash_find(&h, "e", 7));
+
+    hash_clear(&h);
+    printf("ok\n");
+    return 0;
+}
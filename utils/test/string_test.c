@@ -41,9 +41,18 @@ int main(int argc, char* argv[])
 		printf("i: %d, offset: %d\n", i, offset);
 	}
 
+	string_t* i0 = string_intern(s4);
+	string_t* i1 = string_intern_cstr("hello, world!");
+	string_t* i2 = string_intern_cstr_len("hello, world!!", 5);
+	printf("intern: %p, %p, %p, same: %d, hash: %#x\n", i0, i1, i2, i0 == i1, string_intern_hash(i0));
+	assert(i0 == i1);
+	assert(i0 != i2);
+	assert(!string_cmp_cstr(i2, "hello"));
+
 	string_free(s0);
 	string_free(s1);
 	string_free(s2);
 	string_free(s3);
+	string_intern_clear();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "utils_thread_pool.h"
+
+#define N 10000
+
+static int results[N];
+
+static int _square(void* arg, int i)
+{
+	int* base = arg;
+
+	results[i] = *base + i * i;
+	return 0;
+}
+
+static int _fail(void* arg, int i)
+{
+	if (i == 77)
+		return -EINVAL;
+	return 0;
+}
+
+int main()
+{
+	thread_pool_t* pool = NULL;
+
+	int ret = thread_pool_open(&pool, 8);
+	assert(0 == ret);
+
+	int round;
+	for (round = 0; round < 100; round++) {
+		int base = round;
+
+		ret = thread_pool_for(pool, N, _square, &base);
+		assert(0 == ret);
+
+		int i;
+		for (i = 0; i < N; i++)
+			assert(results[i] == round + i * i);
+	}
+
+	ret = thread_pool_for(pool, N, _fail, NULL);
+	assert(-EINVAL == ret);
+
+	ret = thread_pool_for(pool, 0, _fail, NULL);
+	assert(0 == ret);
+
+	thread_pool_close(pool);
+
+	// 只有调用线程时退化成串行
+	ret = thread_pool_open(&pool, 1);
+	assert(0 == ret);
+
+	int base = 1;
+	ret = thread_pool_for(pool, N, _square, &base);
+	assert(0 == ret && results[N - 1] == 1 + (N - 1) * (N - 1));
+
+	thread_pool_close(pool);
+
+	printf("thread pool ok\n");
+	return 0;
+}
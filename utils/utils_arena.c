@@ -0,0 +1,161 @@
+#include "utils_arena.h"
+
+// arena_calloc() 分配的对象前面的头，记录来源，arena_free() 据此决定是否真正释放
+typedef struct
+{
+	arena_t* arena;// NULL 表示在堆上
+	size_t size;// 含对象头的字节数
+}arena_obj_t;
+
+#define ARENA_ALIGN(size) (((size) + 15) & ~(size_t)15)
+
+// 每个线程一个当前 arena，线程池里不同的线程编译不同的函数
+static __thread arena_t* arena_cur = NULL;
+
+int arena_open(arena_t** pa, size_t block_size)
+{
+	if (!pa)
+		return -EINVAL;
+
+	arena_t* a = calloc(1, sizeof(arena_t));
+	if (!a)
+		return -ENOMEM;
+
+	a->block_size = block_size > 0 ? ARENA_ALIGN(block_size) : ARENA_BLOCK_SIZE;
+
+	*pa = a;
+	return 0;
+}
+
+void arena_close(arena_t* a)
+{
+	if (!a)
+		return;
+
+	assert(arena_cur != a);
+
+	while (a->blocks) {
+		arena_block_t* b = a->blocks;
+
+		a->blocks = b->next;
+		free(b);
+	}
+
+	free(a);
+}
+
+static arena_block_t* _arena_add_block(arena_t* a, size_t size)
+{
+	arena_block_t* b = malloc(sizeof(arena_block_t) + size);
+	if (!b)
+		return NULL;
+
+	b->size = size;
+	b->used = 0;
+
+	a->nb_reserved += sizeof(arena_block_t) + size;
+	a->nb_blocks++;
+	return b;
+}
+
+void* arena_alloc(arena_t* a, size_t size)
+{
+	arena_block_t* b = a->blocks;
+
+	size = ARENA_ALIGN(size);
+
+	if (!b || b->used + size > b->size) {
+		// 大对象单独占一块，挂在当前块后面，当前块剩下的空间还能继续用
+		if (size > a->block_size / 4) {
+			b = _arena_add_block(a, size);
+			if (!b)
+				return NULL;
+
+			if (a->blocks) {
+				b->next = a->blocks->next;
+				a->blocks->next = b;
+			} else {
+				b->next = NULL;
+				a->blocks = b;
+			}
+		} else {
+			b = _arena_add_block(a, a->block_size);
+			if (!b)
+				return NULL;
+
+			b->next   = a->blocks;
+			a->blocks = b;
+		}
+	}
+
+	void* p = b->data + b->used;
+	b->used += size;
+
+	a->nb_objects++;
+	a->nb_bytes += size;
+
+	memset(p, 0, size);
+	return p;
+}
+
+arena_t* arena_switch(arena_t* a)
+{
+	arena_t* prev = arena_cur;
+
+	arena_cur = a;
+	return prev;
+}
+
+arena_t* arena_current()
+{
+	return arena_cur;
+}
+
+void* arena_calloc(size_t nmemb, size_t size)
+{
+	if (size > 0 && nmemb > (SIZE_MAX - sizeof(arena_obj_t)) / size)
+		return NULL;
+
+	size = sizeof(arena_obj_t) + nmemb * size;
+
+	arena_obj_t* obj;
+
+	if (arena_cur)
+		obj = arena_alloc(arena_cur, size);
+	else
+		obj = calloc(1, size);
+
+	if (!obj)
+		return NULL;
+
+	obj->arena = arena_cur;
+	obj->size  = size;
+	return obj + 1;
+}
+
+void arena_free(void* p)
+{
+	if (!p)
+		return;
+
+	arena_obj_t* obj = (arena_obj_t*)p - 1;
+
+	if (!obj->arena) {
+		free(obj);
+		return;
+	}
+
+	// 对象可能在别的线程里释放，只有计数需要原子操作
+	__sync_fetch_and_add(&obj->arena->nb_frees, 1);
+	__sync_fetch_and_add(&obj->arena->nb_freed_bytes, (int64_t)ARENA_ALIGN(obj->size));
+}
+
+// 只在 DEBUG 编译时输出
+void arena_print(const arena_t* a, const char* name)
+{
+	if (!a)
+		return;
+
+	logd("arena: %s, objects: %ld, bytes: %ld, frees: %ld, freed bytes: %ld, blocks: %d, reserved: %ld\n",
+			name, a->nb_objects, a->nb_bytes, a->nb_frees, a->nb_freed_bytes, a->nb_blocks, a->nb_reserved);
+}
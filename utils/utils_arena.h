@@ -0,0 +1,54 @@
+#ifndef UTILS_ARENA_H
+#define UTILS_ARENA_H
+
+#include "utils_def.h"
+
+// 区域分配器：对象从大块内存里顺序切出来，单个释放不归还，arena_close() 时整体释放，
+// 用于生命周期和一次编译(一个函数、一次解析)相同的中间表示
+typedef struct arena_block_s arena_block_t;
+
+struct arena_block_s
+{
+	arena_block_t* next;
+	size_t size;// data 的字节数
+	size_t used;// 已经切出去的字节数
+	uint8_t data[] __attribute__((aligned(16)));
+};
+
+typedef struct
+{
+	arena_block_t* blocks;// 当前块在表头
+	size_t block_size;// 普通块的大小，大对象单独占一块
+
+	// 统计，用于估计块的大小
+	int64_t nb_objects;// 分配过的对象个数
+	int64_t nb_bytes;// 分配过的字节数(含对象头)
+	int64_t nb_frees;// 释放过的对象个数(内存不归还)
+	int64_t nb_freed_bytes;
+	int64_t nb_reserved;// 向系统申请的字节数
+	int nb_blocks;
+}arena_t;
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// block_size 为 0 时用 ARENA_BLOCK_SIZE
+int arena_open(arena_t** pa, size_t block_size);
+
+// 释放所有块，从这个 arena 分配的对象全部失效
+void arena_close(arena_t* a);
+
+// 从 a 分配清零的内存，16 字节对齐
+void* arena_alloc(arena_t* a, size_t size);
+
+// 设置当前线程的 arena，返回原来的，a 为 NULL 时回到堆上分配
+arena_t* arena_switch(arena_t* a);
+arena_t* arena_current();
+
+// calloc() / free() 的替代：从当前线程的 arena 分配，没有 arena 时从堆上分配，
+// arena_free() 只真正释放堆上的对象，所以同一种对象不管从哪里分配都用它释放
+void* arena_calloc(size_t nmemb, size_t size);
+void  arena_free(void* p);
+
+void  arena_print(const arena_t* a, const char* name);
+
+#endif
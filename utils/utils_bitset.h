@@ -0,0 +1,162 @@
+#ifndef UTILS_BITSET_H
+#define UTILS_BITSET_H
+
+#include "utils_def.h"
+
+// 位集合，元素是从 0 开始的稠密编号，按需变长，并、差都按 64 位一字处理
+typedef struct
+{
+    int nb_words;// words 的长度
+    uint64_t* words;
+}bitset_t;
+
+#define BITSET_WORD_BITS 64
+
+// 初始化为空集合(也可以直接清零)
+static inline void bitset_init(bitset_t* s){
+    s->nb_words = 0;
+    s->words = NULL;
+}
+
+static inline void bitset_clear(bitset_t* s){
+    if (s->words)
+        free(s->words);
+
+    bitset_init(s);
+}
+
+// 保证能放下 [0, nb_bits) 之内的元素，已有元素不变
+static inline int bitset_resize(bitset_t* s, int nb_bits){
+    int nb_words = (nb_bits + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+
+    if (nb_words > s->nb_words)
+    {
+        uint64_t* words = realloc(s->words, nb_words * sizeof(uint64_t));
+        if (!words)
+            return -ENOMEM;
+
+        memset(words + s->nb_words, 0, (nb_words - s->nb_words) * sizeof(uint64_t));
+
+        s->words = words;
+        s->nb_words = nb_words;
+    }
+
+    return 0;
+}
+
+// 清空集合，并预留 [0, nb_bits) 的空间
+static inline int bitset_reset(bitset_t* s, int nb_bits){
+    if (s->nb_words > 0)
+        memset(s->words, 0, s->nb_words * sizeof(uint64_t));
+
+    return bitset_resize(s, nb_bits);
+}
+
+static inline int bitset_test(const bitset_t* s, int i){
+    assert(i >= 0);
+
+    if (i / BITSET_WORD_BITS >= s->nb_words)
+        return 0;
+
+    return (s->words[i / BITSET_WORD_BITS] >> (i % BITSET_WORD_BITS)) & 0x1;
+}
+
+// 加入元素 i，原来不在集合里返回 1，已经在返回 0
+static inline int bitset_add(bitset_t* s, int i){
+    assert(i >= 0);
+
+    if (bitset_test(s, i))
+        return 0;
+
+    int ret = bitset_resize(s, i + 1);
+    if (ret < 0)
+        return ret;
+
+    s->words[i / BITSET_WORD_BITS] |= 1ULL << (i % BITSET_WORD_BITS);
+    return 1;
+}
+
+static inline void bitset_del(bitset_t* s, int i){
+    assert(i >= 0);
+
+    if (i / BITSET_WORD_BITS < s->nb_words)
+        s->words[i / BITSET_WORD_BITS] &= ~(1ULL << (i % BITSET_WORD_BITS));
+}
+
+// dst = src
+static inline int bitset_copy(bitset_t* dst, const bitset_t* src){
+    int ret = bitset_reset(dst, src->nb_words * BITSET_WORD_BITS);
+    if (ret < 0)
+        return ret;
+
+    if (src->nb_words > 0)
+        memcpy(dst->words, src->words, src->nb_words * sizeof(uint64_t));
+    return 0;
+}
+
+// dst |= src，返回新加入 dst 的元素个数
+static inline int bitset_or(bitset_t* dst, const bitset_t* src){
+    int ret = bitset_resize(dst, src->nb_words * BITSET_WORD_BITS);
+    if (ret < 0)
+        return ret;
+
+    int count = 0;
+    int i;
+
+    for (i = 0; i < src->nb_words; i++)
+    {
+        uint64_t w = src->words[i] & ~dst->words[i];
+
+        if (w)
+        {
+            count += __builtin_popcountll(w);
+            dst->words[i] |= w;
+        }
+    }
+
+    return count;
+}
+
+// dst &= ~src
+static inline void bitset_andnot(bitset_t* dst, const bitset_t* src){
+    int n = dst->nb_words < src->nb_words ? dst->nb_words : src->nb_words;
+    int i;
+
+    for (i = 0; i < n; i++)
+        dst->words[i] &= ~src->words[i];
+}
+
+static inline int bitset_count(const bitset_t* s){
+    int count = 0;
+    int i;
+
+    for (i = 0; i < s->nb_words; i++)
+        count += __builtin_popcountll(s->words[i]);
+    return count;
+}
+
+// 从 i 开始找下一个在集合里的元素，没有返回 -1
+static inline int bitset_next(const bitset_t* s, int i){
+    int k = i / BITSET_WORD_BITS;
+
+    if (k >= s->nb_words)
+        return -1;
+
+    uint64_t w = s->words[k] & (~0ULL << (i % BITSET_WORD_BITS));
+
+    while (!w)
+    {
+        if (++k >= s->nb_words)
+            return -1;
+
+        w = s->words[k];
+    }
+
+    return k * BITSET_WORD_BITS + __builtin_ctzll(w);
+}
+
+// 按从小到大的顺序遍历集合里的元素
+#define bitset_for_each(s, i) \
+    for (i = bitset_next(s, 0); i >= 0; i = bitset_next(s, i + 1))
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef UTILS_HASH_H
+#define UTILS_HASH_H
+
+#include "utils_def.h"
+
+// 开放地址(线性探测)哈希表，键是指针(通常是驻留字符串)，同一个键可以有多个值，
+// 同一个键的值按插入顺序排在探测序列上
+typedef struct
+{
+    const void* key;// 键，NULL 表示空槽
+    void* data;// 值
+    uint32_t hash;// 键的哈希值
+}hash_slot_t;
+
+typedef struct
+{
+    int capacity;// 槽位数，总是 2 的幂
+    int size;// 已用槽位数(含删除标记)
+    hash_slot_t* slots;// 槽位
+}hash_t;
+
+#define HASH_INIT_CAPACITY 16
+
+// 删除标记，探测时跳过，但不终止探测
+#define HASH_DELETED ((const void*)-1)
+
+// 初始化(也可以直接 calloc / 清零)
+static inline void hash_init(hash_t* h){
+    h->capacity = 0;
+    h->size = 0;
+    h->slots = NULL;
+}
+
+// 释放槽位，值由调用者自己管理
+static inline void hash_clear(hash_t* h){
+    if (h->slots)
+        free(h->slots);
+
+    hash_init(h);
+}
+
+// 扩容并去掉删除标记，同一个键的值保持原来的相对顺序
+static inline int hash_grow(hash_t* h){
+    int capacity = h->capacity > 0 ? h->capacity * 2 : HASH_INIT_CAPACITY;
+
+    hash_slot_t* slots = calloc(capacity, sizeof(hash_slot_t));
+    if (!slots)
+        return -ENOMEM;
+
+    // 从一个空槽之后开始遍历，探测序列绕回表头的部分不会被提前，
+    // 同一个键的值按原来的先后顺序重新插入
+    int i0 = 0;
+    while (i0 < h->capacity && h->slots[i0].key)
+        i0++;
+
+    int i;
+    for (i = 1; i <= h->capacity; i++)
+    {
+        hash_slot_t* s = &h->slots[(i0 + i) & (h->capacity - 1)];
+
+        if (!s->key || HASH_DELETED == s->key)
+            continue;
+
+        int j = s->hash & (capacity - 1);
+        while (slots[j].key)
+            j = (j + 1) & (capacity - 1);
+
+        slots[j] = *s;
+    }
+
+    int size = 0;
+    for (i = 0; i < capacity; i++)
+    {
+        if (slots[i].key)
+            size++;
+    }
+
+    free(h->slots);
+    h->slots = slots;
+    h->capacity = capacity;
+    h->size = size;
+    return 0;
+}
+
+// 插入，不检查重复，新值总是排在同键旧值的后面
+static inline int hash_add(hash_t* h, const void* key, uint32_t hash, void* data){
+    assert(key && HASH_DELETED != key);
+
+    // 装载因子不超过 1/2
+    if ((h->size + 1) * 2 > h->capacity)
+    {
+        int ret = hash_grow(h);
+        if (ret < 0)
+            return ret;
+    }
+
+    int i = hash & (h->capacity - 1);
+    while (h->slots[i].key)
+        i = (i + 1) & (h->capacity - 1);
+
+    h->slots[i].key = key;
+    h->slots[i].data = data;
+    h->slots[i].hash = hash;
+    h->size++;
+    return 0;
+}
+
+// 从 *ppos 开始找下一个键为 key 的值，*ppos 初始为 -1，找不到返回 NULL
+static inline void* hash_next(const hash_t* h, const void* key, uint32_t hash, int* ppos){
+    if (0 == h->capacity)
+        return NULL;
+
+    int mask = h->capacity - 1;
+    int i;
+
+    if (*ppos < 0)
+        i = hash & mask;
+    else
+        i = (*ppos + 1) & mask;
+
+    while (h->slots[i].key)
+    {
+        if (key == h->slots[i].key)
+        {
+            *ppos = i;
+            return h->slots[i].data;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return NULL;
+}
+
+// 找最早插入的值
+static inline void* hash_find(const hash_t* h, const void* key, uint32_t hash){
+    int pos = -1;
+    return hash_next(h, key, hash, &pos);
+}
+
+// 找最后插入的值
+static inline void* hash_find_last(const hash_t* h, const void* key, uint32_t hash){
+    void* last = NULL;
+    void* data;
+    int pos = -1;
+
+    while ((data = hash_next(h, key, hash, &pos)))
+        last = data;
+    return last;
+}
+
+// 删除键为 key、值为 data 的项
+static inline int hash_del(hash_t* h, const void* key, uint32_t hash, void* data){
+    int pos = -1;
+    void* d;
+
+    while ((d = hash_next(h, key, hash, &pos)))
+    {
+        if (d == data)
+        {
+            h->slots[pos].key = HASH_DELETED;
+            h->slots[pos].data = NULL;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "utils_string.h"
+#include <pthread.h>
 
 #define STRING_NUMBER_INC 4
 
@@ -342,13 +343,189 @@ int string_get_offset(string_t* str, const char* data, size_t len)
 	return ret;
 }
 
+// 字符串驻留: 相同内容的字符串全局只存一份，并带有预先算好的哈希值，
+// 判断两个驻留字符串是否相等只需比较指针
+typedef struct string_intern_s string_intern_t;
 
+struct string_intern_s {
+    string_intern_t* next; // 同一个桶里的下一个
+    uint32_t hash;         // 预先算好的哈希值
+    string_t s;            // s.data 指向紧跟在结构体后面的内容
+};
 
+#define STRING_INTERN_INIT 1024
 
+static string_intern_t** intern_buckets = NULL;
+static uint32_t intern_capacity = 0;
+static uint32_t intern_count = 0;
 
+// 中端按函数并行时多个线程会同时驻留名字，查找和插入都要加锁
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// FNV-1a 哈希
+uint32_t string_hash_cstr_len(const char* str, size_t len)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (uint8_t)str[i];
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+// 桶数组翻倍，驻留字符串本身不移动，已经拿到的指针依然有效
+static int _string_intern_grow()
+{
+	uint32_t capacity = intern_capacity > 0 ? intern_capacity * 2 : STRING_INTERN_INIT;
+
+	string_intern_t** buckets = calloc(capacity, sizeof(string_intern_t*));
+	if (!buckets)
+		return -ENOMEM;
+
+	uint32_t i;
+	for (i = 0; i < intern_capacity; i++) {
+		string_intern_t* si;
+
+		while ((si = intern_buckets[i])) {
+			intern_buckets[i] = si->next;
+
+			si->next = buckets[si->hash & (capacity - 1)];
+			buckets[si->hash & (capacity - 1)] = si;
+		}
+	}
+
+	free(intern_buckets);
+	intern_buckets  = buckets;
+	intern_capacity = capacity;
+	return 0;
+}
+
+// 在驻留表里找，调用者持有锁
+static string_intern_t* _string_intern_lookup(const char* str, size_t len, uint32_t h)
+{
+	string_intern_t* si;
+
+	if (0 == intern_capacity)
+		return NULL;
+
+	for (si = intern_buckets[h & (intern_capacity - 1)]; si; si = si->next) {
+
+		if (si->hash == h && si->s.len == len && !memcmp(si->s.data, str, len))
+			return si;
+	}
+
+	return NULL;
+}
+
+// 驻留一个字符串，返回的 string_t 属于驻留表，调用者不能修改或释放
+string_t* string_intern_cstr_len(const char* str, size_t len)
+{
+	if (!str)
+		return NULL;
+
+	uint32_t h = string_hash_cstr_len(str, len);
+	string_intern_t* si;
+
+	pthread_mutex_lock(&intern_mutex);
+
+	si = _string_intern_lookup(str, len, h);
+	if (si) {
+		pthread_mutex_unlock(&intern_mutex);
+		return &si->s;
+	}
+
+	if (intern_count >= intern_capacity / 2) {
+		if (_string_intern_grow() < 0) {
+			pthread_mutex_unlock(&intern_mutex);
+			return NULL;
+		}
+	}
+
+	si = malloc(sizeof(string_intern_t) + len + 1);
+	if (!si) {
+		pthread_mutex_unlock(&intern_mutex);
+		return NULL;
+	}
+
+	si->hash       = h;
+	si->s.capacity = -1;
+	si->s.len      = len;
+	si->s.data     = (char*)(si + 1);
+
+	memcpy(si->s.data, str, len);
+	si->s.data[len] = '\0';
+
+	si->next = intern_buckets[h & (intern_capacity - 1)];
+	intern_buckets[h & (intern_capacity - 1)] = si;
+	intern_count++;
+
+	pthread_mutex_unlock(&intern_mutex);
+	return &si->s;
+}
 
+// 只查不插入，没驻留过时返回 NULL: 符号的名字在建符号时都驻留过，查不到说明没有这个名字的符号
+// 查找用它，查不到的名字不会一直留在驻留表里，也不会因为内存不足返回 NULL
+string_t* string_intern_find_cstr_len(const char* str, size_t len)
+{
+	if (!str)
+		return NULL;
+
+	uint32_t h = string_hash_cstr_len(str, len);
 
+	pthread_mutex_lock(&intern_mutex);
 
+	string_intern_t* si = _string_intern_lookup(str, len, h);
 
+	pthread_mutex_unlock(&intern_mutex);
+
+	return si ? &si->s : NULL;
+}
+
+string_t* string_intern_find_cstr(const char* str)
+{
+	if (!str)
+		return NULL;
+	return string_intern_find_cstr_len(str, strlen(str));
+}
 
+string_t* string_intern_cstr(const char* str)
+{
+	if (!str)
+		return NULL;
+	return string_intern_cstr_len(str, strlen(str));
+}
+
+string_t* string_intern(const string_t* s)
+{
+	if (!s)
+		return NULL;
+	return string_intern_cstr_len(s->data, s->len);
+}
+
+// 驻留字符串预先算好的哈希值
+uint32_t string_intern_hash(const string_t* s)
+{
+	return object_of(s, string_intern_t, s)->hash;
+}
+
+// 清空驻留表，之后之前返回的所有驻留字符串都失效
+void string_intern_clear()
+{
+	uint32_t i;
+	for (i = 0; i < intern_capacity; i++) {
+		string_intern_t* si;
+
+		while ((si = intern_buckets[i])) {
+			intern_buckets[i] = si->next;
+			free(si);
+		}
+	}
+
+	free(intern_buckets);
+	intern_buckets  = NULL;
+	intern_capacity = 0;
+	intern_count    = 0;
+}
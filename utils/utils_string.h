@@ -37,6 +37,21 @@ int string_match_kmp_cstr_len(const string_t* T,const uint8_t* P,size_t Plen,vec
 
 int string_get_offset(string_t* str,const char* data,size_t len);
 
+// 字符串驻留: 相同内容只存一份，驻留字符串之间判等只需比较指针
+// 返回的 string_t 属于驻留表，不能修改，也不能 string_free
+uint32_t string_hash_cstr_len(const char* str,size_t len);
+
+string_t* string_intern(const string_t* s);
+string_t* string_intern_cstr(const char* str);
+string_t* string_intern_cstr_len(const char* str,size_t len);
+
+string_t* string_intern_find_cstr(const char* str);
+string_t* string_intern_find_cstr_len(const char* str,size_t len);
+
+uint32_t string_intern_hash(const string_t* s);
+
+void string_intern_clear();
+
 #endif
 
 
@@ -0,0 +1,149 @@
+#include "utils_thread_pool.h"
+
+// 不断领取任务直到这一批领完或者有任务出错
+static void _thread_pool_run(thread_pool_t* pool)
+{
+	while (1) {
+		pthread_mutex_lock(&pool->mutex);
+
+		if (pool->next >= pool->n || pool->error < 0) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+
+		thread_pool_func_pt func = pool->func;
+		void*               arg  = pool->arg;
+		int                 i    = pool->next++;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		int ret = func(arg, i);
+		if (ret < 0) {
+			pthread_mutex_lock(&pool->mutex);
+			if (0 == pool->error)
+				pool->error = ret;
+			pthread_mutex_unlock(&pool->mutex);
+		}
+	}
+}
+
+static void* _thread_pool_worker(void* arg)
+{
+	thread_pool_t* pool = arg;
+	uint64_t generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (1) {
+		while (!pool->quit && generation == pool->generation)
+			pthread_cond_wait(&pool->start, &pool->mutex);
+
+		if (pool->quit)
+			break;
+
+		generation = pool->generation;
+		pool->nb_active++;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		_thread_pool_run(pool);
+
+		pthread_mutex_lock(&pool->mutex);
+
+		if (0 == --pool->nb_active)
+			pthread_cond_signal(&pool->done);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+int thread_pool_open(thread_pool_t** ppool, int nb_jobs)
+{
+	if (!ppool || nb_jobs < 1)
+		return -EINVAL;
+
+	thread_pool_t* pool = calloc(1, sizeof(thread_pool_t));
+	if (!pool)
+		return -ENOMEM;
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init (&pool->start, NULL);
+	pthread_cond_init (&pool->done,  NULL);
+
+	if (nb_jobs > 1) {
+		pool->threads = calloc(nb_jobs - 1, sizeof(pthread_t));
+		if (!pool->threads) {
+			thread_pool_close(pool);
+			return -ENOMEM;
+		}
+
+		while (pool->nb_threads < nb_jobs - 1) {
+			if (pthread_create(&pool->threads[pool->nb_threads], NULL, _thread_pool_worker, pool)) {
+				thread_pool_close(pool);
+				return -ENOMEM;
+			}
+
+			pool->nb_threads++;
+		}
+	}
+
+	*ppool = pool;
+	return 0;
+}
+
+void thread_pool_close(thread_pool_t* pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+
+	int i;
+	for (i = 0; i < pool->nb_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy (&pool->done);
+	pthread_cond_destroy (&pool->start);
+	pthread_mutex_destroy(&pool->mutex);
+
+	free(pool->threads);
+	free(pool);
+}
+
+int thread_pool_for(thread_pool_t* pool, int n, thread_pool_func_pt func, void* arg)
+{
+	if (!pool || !func)
+		return -EINVAL;
+
+	if (n <= 0)
+		return 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	pool->func  = func;
+	pool->arg   = arg;
+	pool->n     = n;
+	pool->next  = 0;
+	pool->error = 0;
+	pool->generation++;
+
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+
+	_thread_pool_run(pool);
+
+	// 晚醒的工作线程只会看到任务已经领完，不会再调用 func
+	pthread_mutex_lock(&pool->mutex);
+
+	while (pool->nb_active > 0)
+		pthread_cond_wait(&pool->done, &pool->mutex);
+
+	int ret = pool->error;
+
+	pthread_mutex_unlock(&pool->mutex);
+	return ret;
+}
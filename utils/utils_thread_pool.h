@@ -0,0 +1,39 @@
+#ifndef UTILS_THREAD_POOL_H
+#define UTILS_THREAD_POOL_H
+
+#include "utils_def.h"
+#include <pthread.h>
+
+// 对第 i 个任务调用的函数，返回负数表示出错
+typedef int (*thread_pool_func_pt)(void* arg, int i);
+
+// 固定线程数的线程池，一次只跑一批下标为 [0, n) 的任务，
+// 调用 thread_pool_for() 的线程自己也参与执行，全部完成后才返回
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t start;// 有新的一批任务
+    pthread_cond_t done;// 工作线程都空闲了
+
+    pthread_t* threads;
+    int nb_threads;
+
+    thread_pool_func_pt func;// 当前这批任务
+    void* arg;
+    int n;// 任务个数
+    int next;// 下一个还没领取的任务下标
+    int error;// 第一个出错任务的返回值
+
+    int nb_active;// 正在领取任务的工作线程数
+    uint64_t generation;// 每提交一批加 1，工作线程据此判断有没有新任务
+    int quit;
+}thread_pool_t;
+
+// nb_jobs 是包括调用线程在内的总并发数，会额外创建 nb_jobs - 1 个工作线程
+int thread_pool_open(thread_pool_t** ppool, int nb_jobs);
+void thread_pool_close(thread_pool_t* pool);
+
+// 并行执行 func(arg, 0) ... func(arg, n - 1)，某个任务出错后不再领取新任务，返回该错误
+int thread_pool_for(thread_pool_t* pool, int n, thread_pool_func_pt func, void* arg);
+
+#endif